@@ -0,0 +1,42 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "bench.hpp"
+
+// Counting replacements of the global allocation functions. Only linked into
+// proto_bench, every other form of new and delete forwards to these.
+namespace {
+std::atomic<u64> g_allocs{0};
+}  // namespace
+
+void *operator new(std::size_t size) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    if (void *ptr = std::malloc(size ? size : 1)) return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+
+void operator delete(void *ptr, std::size_t) noexcept { std::free(ptr); }
+
+// std::pmr::new_delete_resource allocates through the aligned forms.
+void *operator new(std::size_t size, std::align_val_t align) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    auto alignment = static_cast<std::size_t>(align);
+    size = (size + alignment - 1) / alignment * alignment;
+    if (void *ptr = std::aligned_alloc(alignment, size ? size : alignment)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr, std::align_val_t) noexcept { std::free(ptr); }
+
+void operator delete(void *ptr, std::size_t, std::align_val_t) noexcept {
+    std::free(ptr);
+}
+
+namespace bench {
+u64 AllocCount() { return g_allocs.load(std::memory_order_relaxed); }
+}  // namespace bench
@@ -0,0 +1,129 @@
+#include "../common/proto/arena.hpp"
+#include "../common/proto/request.hpp"
+
+#include "bench.hpp"
+#include "samples.hpp"
+
+namespace bench {
+namespace {
+// Frame size of the server, see MAX_SEND_SIZE in tcp.hpp.
+constexpr usize FRAME_SIZE = 2048;
+
+void PackFrames(const proto::Response &resp) {
+    usize cursor = 0;
+    while (cursor < resp.entryCount()) {
+        usize size;
+        auto frame = resp.packChunk(&size, proto::BYTE_ORDER_NETWORK,
+                                    FRAME_SIZE, &cursor, proto::LAYOUT_PACKED);
+        Consume(frame);
+    }
+}
+
+// Serving builds the response from the OS data and packs it into frames,
+// parsing is what the client does with every frame.
+template <typename T, typename Source>
+void RunServe(const std::string &name, const T &sample, const Source &src) {
+    proto::Arena arena;
+    usize packed_size;
+    auto packed = sample.pack(&packed_size, proto::BYTE_ORDER_NETWORK);
+
+    auto serve_heap = [&] {
+        auto resp = new T(src);
+        PackFrames(*resp);
+        delete resp;
+    };
+    auto serve_arena = [&] {
+        auto resp = arena.make<T>(src, arena.resource());
+        PackFrames(*resp);
+        std::destroy_at(resp);
+        arena.reset();
+    };
+    auto parse_heap = [&] {
+        proto::PackCtx ctx(packed.get(), proto::BYTE_ORDER_NETWORK);
+        ctx.pop<proto::ResponseType>();
+        ERR err;
+        auto resp = new T(&ctx, &err);
+        Consume(resp->entryCount());
+        delete resp;
+    };
+    auto parse_arena = [&] {
+        {
+            proto::PackCtx ctx(packed.get(), proto::BYTE_ORDER_NETWORK,
+                               arena.resource());
+            ctx.pop<proto::ResponseType>();
+            ERR err;
+            auto resp = arena.make<T>(&ctx, &err);
+            Consume(resp->entryCount());
+            std::destroy_at(resp);
+        }
+        arena.reset();
+    };
+
+    Report("arena/" + name,
+           {
+               {"serve_heap_allocs_per_op", AllocsPerOp(serve_heap)},
+               {"serve_arena_allocs_per_op", AllocsPerOp(serve_arena)},
+               {"serve_heap_ns_per_op", MeasureNs(serve_heap)},
+               {"serve_arena_ns_per_op", MeasureNs(serve_arena)},
+               {"parse_heap_allocs_per_op", AllocsPerOp(parse_heap)},
+               {"parse_arena_allocs_per_op", AllocsPerOp(parse_arena)},
+               {"parse_heap_ns_per_op", MeasureNs(parse_heap)},
+               {"parse_arena_ns_per_op", MeasureNs(parse_arena)},
+           });
+}
+
+// What the server does with every request frame, a bulk request is the one
+// with the most strings in it.
+void RunRequest() {
+    std::vector<std::wstring> paths;
+    for (int i = 0; i < 32; i++) {
+        paths.push_back(L"C:\\Users\\bench\\Documents\\project\\file" +
+                        std::to_wstring(i) + L".txt");
+    }
+    proto::Request req(proto::REQ_RIGHTS_BULK, paths, 2);
+    proto::Filter::Parse("mask has write_dac && sid == S-1-1-0",
+                         proto::FILTER_TARGET_ACE, &req.filter);
+    usize packed_size;
+    auto packed = req.pack(&packed_size, proto::BYTE_ORDER_NETWORK);
+
+    proto::Arena arena;
+    auto parse_heap = [&] {
+        proto::Request parsed(packed.get(), proto::BYTE_ORDER_NETWORK);
+        Consume(parsed.paths.size());
+    };
+    auto parse_arena = [&] {
+        {
+            proto::Request parsed(packed.get(), proto::BYTE_ORDER_NETWORK,
+                                  arena.resource());
+            Consume(parsed.paths.size());
+        }
+        arena.reset();
+    };
+
+    Report("arena/request",
+           {
+               {"parse_heap_allocs_per_op", AllocsPerOp(parse_heap)},
+               {"parse_arena_allocs_per_op", AllocsPerOp(parse_arena)},
+               {"parse_heap_ns_per_op", MeasureNs(parse_heap)},
+               {"parse_arena_ns_per_op", MeasureNs(parse_arena)},
+           });
+}
+}  // namespace
+
+void RunArena() {
+    for (const auto &sample : SampleResponses()) {
+        if (auto drives = dynamic_cast<const proto::DrivesResponse *>(
+                sample.resp.get())) {
+            RunServe(sample.name, *drives,
+                     std::span<const DriveInfo>(drives->drives));
+        } else if (auto rights = dynamic_cast<const proto::RightsResponse *>(
+                       sample.resp.get())) {
+            RunServe(sample.name, *rights, rights->rights_info);
+        } else if (auto owner = dynamic_cast<const proto::OwnerResponse *>(
+                       sample.resp.get())) {
+            RunServe(sample.name, *owner, owner->info);
+        }
+    }
+    RunRequest();
+}
+}  // namespace bench
@@ -0,0 +1,14 @@
+#include "bench.hpp"
+
+#include <cstdio>
+
+namespace bench {
+void Report(const std::string &name, std::initializer_list<Field> fields) {
+    printf("{\"bench\":\"%s\"", name.c_str());
+    for (const auto &[key, val] : fields) {
+        printf(",\"%s\":%.3f", key, val);
+    }
+    printf("}\n");
+    fflush(stdout);
+}
+}  // namespace bench
@@ -0,0 +1,91 @@
+#ifndef BSIT_3_BENCH_HPP
+#define BSIT_3_BENCH_HPP
+
+#include <chrono>
+#include <initializer_list>
+#include <string>
+#include <utility>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include "../common/alias.hpp"
+
+namespace bench {
+constexpr auto MIN_DURATION = std::chrono::milliseconds(200);
+
+using Field = std::pair<const char *, double>;
+
+// Keeps the optimizer from dropping a result that is otherwise unused: val
+// has to be computed and in a register or memory at this point.
+template <typename T>
+void Consume(const T &val) {
+#if defined(_MSC_VER)
+    static const void *volatile sink;
+    sink = &val;
+    _ReadWriteBarrier();
+#else
+    asm volatile("" : : "r,m"(val) : "memory");
+#endif
+}
+
+// Calls fn in growing batches until MIN_DURATION has passed and returns the
+// mean time of a single call in nanoseconds.
+template <typename F>
+double MeasureNs(F &&fn) {
+    using clock = std::chrono::steady_clock;
+    u64 iterations = 0;
+    u64 batch = 1;
+    auto start = clock::now();
+    auto elapsed = clock::duration::zero();
+    while (elapsed < MIN_DURATION) {
+        for (u64 i = 0; i < batch; i++) {
+            fn();
+        }
+        iterations += batch;
+        batch *= 2;
+        elapsed = clock::now() - start;
+    }
+    return std::chrono::duration<double, std::nano>(elapsed).count() /
+           static_cast<double>(iterations);
+}
+
+// Number of global operator new calls so far, see alloc.cpp.
+u64 AllocCount();
+
+// Mean number of heap allocations of a single call to fn.
+template <typename F>
+double AllocsPerOp(F &&fn) {
+    constexpr u64 ITERATIONS = 100;
+    fn();
+    u64 before = AllocCount();
+    for (u64 i = 0; i < ITERATIONS; i++) {
+        fn();
+    }
+    return static_cast<double>(AllocCount() - before) / ITERATIONS;
+}
+
+// Prints one JSON object per line so results can be diffed and plotted.
+void Report(const std::string &name, std::initializer_list<Field> fields);
+
+void RunProto();
+
+void RunOs();
+
+void RunBulk();
+
+void RunWalk();
+
+void RunCompression();
+
+void RunLayout();
+
+void RunArena();
+
+void RunUtf();
+
+void RunCrypto();
+}  // namespace bench
+
+#endif
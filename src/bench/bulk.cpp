@@ -0,0 +1,176 @@
+#include <condition_variable>
+#include <mutex>
+
+#include "../common/utf/utf.hpp"
+#include "../server/os_utils/fake.hpp"
+#include "../server/server/acl_table.hpp"
+#include "../server/server/bulk_pool.hpp"
+
+#include "bench.hpp"
+
+namespace bench {
+namespace {
+constexpr u8 DEPTH = 2;
+
+// Answers one bulk request over the synthetic tree the way the I/O loop
+// does: wait for a notify, take a batch, until the job is done. bytes, if
+// given, adds up the packed responses.
+void Walk(server::tcp::BulkPool *pool, proto::Arena *arena, usize *paths,
+          const proto::Filter &filter = {}, usize *bytes = nullptr) {
+    std::mutex lock;
+    std::condition_variable ready;
+    bool notified = false;
+    auto notify = [&] {
+        std::lock_guard guard(lock);
+        notified = true;
+        ready.notify_one();
+    };
+
+    const std::vector<std::wstring> roots = {L"C:\\bench"};
+    proto::Request req(proto::REQ_RIGHTS_BULK, roots, DEPTH);
+    req.filter = filter;
+    server::tcp::BulkJob *job = pool->Submit(req, notify);
+    *paths = 0;
+    if (bytes) *bytes = 0;
+    bool done = false;
+    while (!done) {
+        {
+            std::unique_lock guard(lock);
+            ready.wait(guard, [&] { return notified; });
+            notified = false;
+        }
+        while (proto::Response *resp = pool->Take(job, arena, &done)) {
+            *paths += static_cast<proto::BulkRightsResponse *>(resp)
+                          ->results.size();
+            if (bytes) {
+                usize size;
+                resp->pack(&size, proto::BYTE_ORDER_NETWORK);
+                *bytes += size;
+            }
+            std::destroy_at(resp);
+            arena->reset();
+            if (done) break;
+        }
+    }
+    pool->Release(job);
+}
+
+void RunWorkers(const char *name, u32 workers, double *paths_per_s) {
+    server::tcp::BulkPool pool(workers);
+    proto::Arena arena;
+    usize paths = 0;
+    double ns = MeasureNs([&] { Walk(&pool, &arena, &paths); });
+    *paths_per_s = static_cast<double>(paths) * 1e9 / ns;
+    Report(std::string("bulk/") + name,
+           {{"workers", static_cast<double>(workers)},
+            {"paths", static_cast<double>(paths)},
+            {"ns_per_op", ns},
+            {"paths_per_s", *paths_per_s}});
+}
+// Packed size of a bulk rights stream over paths of the synthetic provider,
+// which hands out one of FakeConfig::owners ACLs, with the ACLs shared
+// against one ACL per path as if they were all different.
+void RunAclTable() {
+    constexpr usize PATHS = 1024;
+    os_utils::FakeProvider fake(os_utils::FakeConfig{});
+    std::vector<std::pair<std::wstring, AccessRightsInfo>> looked_up;
+    for (usize i = 0; i < PATHS; i++) {
+        std::wstring path = L"C:\\bench\\file" + std::to_wstring(i);
+        ERR err;
+        AccessRightsInfo rights = fake.GetAccessInfo(path, &err);
+        looked_up.emplace_back(std::move(path), std::move(rights));
+    }
+
+    auto packed = [&](bool shared) {
+        server::tcp::AclTable table;
+        std::vector<SharedAcl> acls;
+        std::vector<PathAclInfo> results;
+        for (const auto &[path, rights] : looked_up) {
+            bool added = true;
+            u32 acl = shared ? table.Intern(rights, &added)
+                             : static_cast<u32>(acls.size());
+            if (added) acls.push_back({acl, rights});
+            std::string utf8;
+            utils::utf::ToUtf8(path, &utf8);
+            results.push_back({std::move(utf8), ERR_Ok, acl});
+        }
+        proto::BulkRightsResponse resp(std::move(acls), std::move(results));
+        usize size;
+        resp.pack(&size, proto::BYTE_ORDER_NETWORK);
+        return static_cast<double>(size);
+    };
+
+    double unshared = packed(false);
+    double shared = packed(true);
+    server::tcp::AclTable table;
+    bool added;
+    const AccessRightsInfo &rights = looked_up.front().second;
+    Report("bulk/acl_table",
+           {{"paths", static_cast<double>(PATHS)},
+            {"unshared_bytes_per_path", unshared / PATHS},
+            {"bytes_per_path", shared / PATHS},
+            {"ratio", unshared / shared},
+            {"intern_ns", MeasureNs([&] {
+                 Consume(table.Intern(rights, &added));
+             })}});
+}
+
+// Paths and bytes of a bulk rights stream with and without a filter that
+// keeps the ACEs letting one user change permissions, and the cost of
+// evaluating it.
+void RunFilter() {
+    proto::Filter filter;
+    ERR err = proto::Filter::Parse(
+        "type == allowed && mask has write_dac && "
+        "sid == S-1-5-21-3623811015-3361044348-30300820-1000",
+        proto::FILTER_TARGET_ACE, &filter);
+    if (err != ERR_Ok) return;
+
+    server::tcp::BulkPool pool(server::tcp::BulkPool::DefaultWorkers());
+    proto::Arena arena;
+    usize all_paths;
+    usize all_bytes;
+    Walk(&pool, &arena, &all_paths, {}, &all_bytes);
+    usize paths;
+    usize bytes;
+    Walk(&pool, &arena, &paths, filter, &bytes);
+
+    os_utils::FakeProvider fake(os_utils::FakeConfig{});
+    AccessRightsInfo rights = fake.GetAccessInfo(L"C:\\bench", &err);
+    double eval_ns = MeasureNs([&] {
+        for (const auto &ace : rights.entries) {
+            Consume(filter.Match(ace));
+        }
+    });
+    Report("bulk/filter",
+           {{"unfiltered_paths", static_cast<double>(all_paths)},
+            {"paths", static_cast<double>(paths)},
+            {"unfiltered_bytes", static_cast<double>(all_bytes)},
+            {"bytes", static_cast<double>(bytes)},
+            {"ratio", static_cast<double>(all_bytes) / bytes},
+            {"eval_ns_per_ace", eval_ns / rights.entries.size()}});
+}
+}  // namespace
+
+// A depth 2 walk over a backend as slow as a remote file system, served by
+// a single worker against the default pool.
+void RunBulk() {
+    os_utils::FakeConfig cfg;
+    cfg.latency = std::chrono::microseconds(100);
+    os_utils::FakeProvider fake(cfg);
+    os_utils::FakeProvider unthrottled(os_utils::FakeConfig{});
+    os_utils::Provider *host = os_utils::g_provider;
+    os_utils::g_provider = &fake;
+
+    double serial;
+    double parallel;
+    RunWorkers("serial", 1, &serial);
+    RunWorkers("pool", server::tcp::BulkPool::DefaultWorkers(), &parallel);
+    Report("bulk/speedup", {{"speedup", parallel / serial}});
+
+    os_utils::g_provider = &unthrottled;
+    RunFilter();
+    os_utils::g_provider = host;
+    RunAclTable();
+}
+}  // namespace bench
@@ -0,0 +1,42 @@
+#include "../common/proto/compression/compression.hpp"
+
+#include "bench.hpp"
+#include "samples.hpp"
+
+namespace bench {
+void RunCompression() {
+    for (const auto &sample : SampleResponses()) {
+        usize raw_size;
+        auto raw = sample.resp->pack(&raw_size, proto::BYTE_ORDER_NETWORK);
+        usize compressed_size;
+        auto compressed = proto::compression::Compress(raw.get(), raw_size,
+                                                       &compressed_size);
+
+        double compress_ns = MeasureNs([&] {
+            usize size;
+            auto res = proto::compression::Compress(raw.get(), raw_size, &size);
+            Consume(res);
+        });
+        double decompress_ns = MeasureNs([&] {
+            usize size;
+            auto res = proto::compression::Decompress(compressed.get(),
+                                                      compressed_size, &size);
+            Consume(res);
+        });
+
+        Report("compression/" + sample.name,
+               {
+                   {"raw_bytes", static_cast<double>(raw_size)},
+                   {"compressed_bytes", static_cast<double>(compressed_size)},
+                   {"ratio", static_cast<double>(raw_size) /
+                                 static_cast<double>(compressed_size)},
+                   {"above_threshold",
+                    raw_size > proto::compression::COMPRESSION_THRESHOLD},
+                   {"compress_ns_per_op", compress_ns},
+                   {"compress_bytes_per_s", raw_size * 1e9 / compress_ns},
+                   {"decompress_ns_per_op", decompress_ns},
+                   {"decompress_bytes_per_s", raw_size * 1e9 / decompress_ns},
+               });
+    }
+}
+}  // namespace bench
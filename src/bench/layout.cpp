@@ -0,0 +1,49 @@
+#include "../common/proto/flat.hpp"
+
+#include "bench.hpp"
+#include "samples.hpp"
+
+namespace bench {
+// Reading the free bytes of the middle drive: full decode of the packed
+// layout against an in-place read of the flat one.
+void RunLayout() {
+    for (const auto &sample : SampleResponses()) {
+        auto drives = dynamic_cast<const proto::DrivesResponse *>(
+            sample.resp.get());
+        if (!drives) continue;
+        usize middle = drives->entryCount() / 2;
+
+        for (auto order :
+             {proto::BYTE_ORDER_NETWORK, proto::BYTE_ORDER_NATIVE}) {
+            usize packed_size;
+            auto packed = drives->pack(&packed_size, order);
+            usize flat_size;
+            usize cursor = 0;
+            auto flat = drives->packChunk(&flat_size, order, usize_max, &cursor,
+                                          proto::LAYOUT_FLAT);
+
+            double decode_ns = MeasureNs([&] {
+                proto::PackCtx ctx(packed.get(), order);
+                ctx.pop<proto::ResponseType>();
+                ERR err;
+                proto::DrivesResponse resp(&ctx, &err);
+                Consume(resp.drives[middle].free_bytes);
+            });
+            double view_ns = MeasureNs([&] {
+                proto::flat::View view(flat.get(), flat_size, order);
+                Consume(view.at<proto::flat::DriveView>(middle).freeBytes());
+            });
+
+            Report("layout/" + sample.name +
+                       (order == proto::BYTE_ORDER_NATIVE ? "/native"
+                                                          : "/network"),
+                   {
+                       {"packed_bytes", static_cast<double>(packed_size)},
+                       {"flat_bytes", static_cast<double>(flat_size)},
+                       {"decode_ns_per_op", decode_ns},
+                       {"flat_field_ns_per_op", view_ns},
+                   });
+        }
+    }
+}
+}  // namespace bench
@@ -0,0 +1,23 @@
+#include <cstdio>
+
+#include "bench.hpp"
+
+int main() {
+    // Numbers of an unoptimized build say nothing about a release.
+#if defined(_DEBUG) || (defined(__GNUC__) && !defined(__OPTIMIZE__))
+    fprintf(stderr, "[-] proto_bench needs an optimized build, configure "
+                    "with -DCMAKE_BUILD_TYPE=Release\n");
+    return 1;
+#endif
+    bench::RunProto();
+    bench::RunOs();
+    bench::RunBulk();
+    bench::RunWalk();
+    bench::RunCompression();
+    bench::RunLayout();
+    bench::RunArena();
+    bench::RunUtf();
+    bench::RunCrypto();
+
+    return 0;
+}
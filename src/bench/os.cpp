@@ -0,0 +1,140 @@
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+#include "../server/os_utils/fake.hpp"
+#include "../server/os_utils/info_cache.hpp"
+#include "../server/os_utils/name_cache.hpp"
+
+#include "bench.hpp"
+
+namespace bench {
+namespace {
+void RunProvider(os_utils::Provider *provider) {
+    std::string prefix = std::string("os/") + provider->Name() + "/";
+    const std::wstring path = L".";
+    ERR err;
+
+    auto meminfo = [&] { Consume(provider->GetMeminfo()); };
+    auto uptime = [&] { Consume(provider->GetUptimeMs()); };
+    auto drives = [&] { Consume(provider->GetDrives()); };
+    auto rights = [&] { Consume(provider->GetAccessInfo(path, &err)); };
+    auto owner = [&] { Consume(provider->GetOwnerInfo(path, &err)); };
+
+    Report(prefix + "meminfo", {{"ns_per_op", MeasureNs(meminfo)},
+                                {"allocs_per_op", AllocsPerOp(meminfo)}});
+    Report(prefix + "uptime", {{"ns_per_op", MeasureNs(uptime)},
+                               {"allocs_per_op", AllocsPerOp(uptime)}});
+    Report(prefix + "drives",
+           {{"entries", static_cast<double>(provider->GetDrives().size())},
+            {"ns_per_op", MeasureNs(drives)},
+            {"allocs_per_op", AllocsPerOp(drives)}});
+    Report(prefix + "rights",
+           {{"entries",
+             static_cast<double>(
+                 provider->GetAccessInfo(path, &err).entries.size())},
+            {"ns_per_op", MeasureNs(rights)},
+            {"allocs_per_op", AllocsPerOp(rights)}});
+    Report(prefix + "owner", {{"ns_per_op", MeasureNs(owner)},
+                              {"allocs_per_op", AllocsPerOp(owner)}});
+}
+
+// A resolver as slow as a directory round trip against the cached lookup.
+void RunNameCache() {
+    auto resolve = [](const os_utils::Sid &sid, os_utils::AccountName *res) {
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+        res->name = "user" + std::to_string(sid[0]);
+        res->domain = "BENCH";
+        return true;
+    };
+    os_utils::NameCache cache(resolve);
+
+    os_utils::Sid sid{};
+    os_utils::AccountName account;
+    auto uncached = [&] { Consume(resolve(sid, &account)); };
+    auto cached = [&] { Consume(cache.Lookup(sid, &account)); };
+
+    double uncachedNs = MeasureNs(uncached);
+    double cachedNs = MeasureNs(cached);
+    auto stats = cache.GetStats();
+    Report("os/name_cache",
+           {{"uncached_ns_per_op", uncachedNs},
+            {"ns_per_op", cachedNs},
+            {"allocs_per_op", AllocsPerOp(cached)},
+            {"hit_rate", static_cast<double>(stats.hits) /
+                             static_cast<double>(stats.hits + stats.misses)},
+            {"speedup", uncachedNs / cachedNs}});
+}
+
+// Repeated single path lookups on the host provider, and how long a change
+// takes to reach the cache through the watcher of the provider.
+void RunInfoCache(os_utils::Provider *provider) {
+    std::string prefix = std::string("os/") + provider->Name() + "/";
+    os_utils::InfoCache cache(provider);
+    const std::wstring path = L".";
+    ERR err;
+
+    double uncachedNs =
+        MeasureNs([&] { Consume(provider->GetAccessInfo(path, &err)); });
+    auto cached = [&] { Consume(cache.GetAccessInfo(path, &err)); };
+    double cachedNs = MeasureNs(cached);
+    double ownerNs =
+        MeasureNs([&] { Consume(cache.GetOwnerInfo(path, &err)); });
+    auto stats = cache.GetStats();
+    Report(prefix + "info_cache",
+           {{"uncached_ns_per_op", uncachedNs},
+            {"ns_per_op", cachedNs},
+            {"owner_ns_per_op", ownerNs},
+            {"allocs_per_op", AllocsPerOp(cached)},
+            {"hit_rate", static_cast<double>(stats.hits) /
+                             static_cast<double>(stats.hits + stats.misses)},
+            {"speedup", uncachedNs / cachedNs}});
+
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    fs::path file = fs::temp_directory_path(ec) / "bsit3_info_cache";
+    std::ofstream(file).put('x');
+    if (!fs::exists(file, ec)) {
+        return;
+    }
+    constexpr int ROUNDS = 20;
+    constexpr auto DEADLINE = std::chrono::seconds(1);
+    using clock = std::chrono::steady_clock;
+    auto perms = fs::perms::owner_read | fs::perms::owner_write;
+    double total = 0;
+    int seen = 0;
+    for (int i = 0; i < ROUNDS; i++) {
+        Consume(cache.GetAccessInfo(file.wstring(), &err));
+        auto before = cache.GetStats().invalidations;
+        perms ^= fs::perms::group_read;
+        auto start = clock::now();
+        fs::permissions(file, perms, ec);
+        while (cache.GetStats().invalidations == before &&
+               clock::now() - start < DEADLINE) {
+            std::this_thread::yield();
+        }
+        if (cache.GetStats().invalidations != before) {
+            total += std::chrono::duration<double, std::micro>(clock::now() -
+                                                               start)
+                         .count();
+            seen++;
+        }
+    }
+    fs::remove(file, ec);
+    Report(prefix + "info_cache_invalidate",
+           {{"rounds", ROUNDS},
+            {"notified", static_cast<double>(seen)},
+            {"us_to_invalidate", seen ? total / seen : 0}});
+}
+}  // namespace
+
+// The host provider against the synthetic one with the default model.
+void RunOs() {
+    os_utils::init();
+    RunProvider(os_utils::g_provider);
+    RunInfoCache(os_utils::g_provider);
+    os_utils::FakeProvider fake(os_utils::FakeConfig{});
+    RunProvider(&fake);
+    RunNameCache();
+}
+}  // namespace bench
@@ -0,0 +1,162 @@
+#include "../common/proto/handshake.hpp"
+#include "../common/proto/proto.hpp"
+
+#include "bench.hpp"
+#include "samples.hpp"
+
+namespace bench {
+namespace {
+// Frame size of the server, see MAX_SEND_SIZE in tcp.hpp.
+constexpr usize FRAME_SIZE = 2048;
+constexpr usize PACK_VALUES = 64;
+constexpr usize PACK_BYTES = 256;
+
+// Features of a plaintext connection in the given byte order, so framing is
+// measured without the cipher (see crypto.cpp for that part).
+u32 FramingFeatures(proto::ByteOrder order) {
+    u32 features = proto::FEATURE_PLAINTEXT;
+    if (order == proto::BYTE_ORDER_NATIVE) {
+        features |= proto::FEATURE_LITTLE_ENDIAN | proto::FEATURE_BIG_ENDIAN;
+    }
+    return features;
+}
+
+const char *OrderName(proto::ByteOrder order) {
+    return order == proto::BYTE_ORDER_NATIVE ? "native" : "network";
+}
+
+// The scalar and array mix the response constructors push and pop.
+void RunPackCtx(proto::ByteOrder order) {
+    u8 bytes[PACK_BYTES];
+    for (usize i = 0; i < sizeof(bytes); i++) {
+        bytes[i] = static_cast<u8>(i);
+    }
+    auto push = [&](usize *size) {
+        proto::PackCtx ctx(order);
+        for (usize i = 0; i < PACK_VALUES; i++) {
+            ctx.push(static_cast<u32>(i));
+            ctx.push(static_cast<u64>(i) << 32);
+        }
+        ctx.push(bytes, sizeof(bytes));
+        return ctx.pack(size);
+    };
+    usize packed_size;
+    auto packed = push(&packed_size);
+
+    auto push_op = [&] {
+        usize size;
+        auto res = push(&size);
+        Consume(res);
+    };
+    auto pop_op = [&] {
+        proto::PackCtx ctx(packed.get(), order);
+        u64 sum = 0;
+        for (usize i = 0; i < PACK_VALUES; i++) {
+            sum += ctx.pop<u32>();
+            sum += ctx.pop<u64>();
+        }
+        usize size;
+        auto res = ctx.pop<u8>(&size);
+        Consume(sum);
+        Consume(res);
+    };
+    double push_ns = MeasureNs(push_op);
+    double pop_ns = MeasureNs(pop_op);
+
+    Report(std::string("proto/pack_ctx/") + OrderName(order),
+           {
+               {"bytes", static_cast<double>(packed_size)},
+               {"push_ns_per_op", push_ns},
+               {"push_bytes_per_s", packed_size * 1e9 / push_ns},
+               {"pop_ns_per_op", pop_ns},
+               {"pop_bytes_per_s", packed_size * 1e9 / pop_ns},
+               {"push_allocs_per_op", AllocsPerOp(push_op)},
+               {"pop_allocs_per_op", AllocsPerOp(pop_op)},
+           });
+}
+
+// Sending frames the response the way the server streams it, receiving
+// parses every frame into a message and the message into a response.
+void RunFraming(const Sample &sample, proto::ByteOrder order) {
+    u32 features = FramingFeatures(order);
+    auto frame = [&] {
+        std::vector<proto::Message> frames;
+        usize cursor = 0;
+        do {
+            frames.emplace_back(sample.resp.get(),
+                                proto::MESSAGE_ENCRYPTION_NONE, nullptr,
+                                features, FRAME_SIZE, &cursor);
+        } while (cursor < sample.resp->entryCount());
+        return frames;
+    };
+    auto frames = frame();
+    usize wire_size = 0;
+    for (const auto &msg : frames) {
+        wire_size += msg.size();
+    }
+    auto receive = [&] {
+        std::vector<proto::Message> received;
+        for (const auto &msg : frames) {
+            received.emplace_back(nullptr, msg.buf(), features);
+        }
+        return received;
+    };
+    auto received = receive();
+
+    bool ok = true;
+    for (auto &msg : received) {
+        ERR err;
+        std::unique_ptr<proto::Response> resp(proto::ParseResponse(&msg, &err));
+        ok &= err == ERR_Ok && resp;
+    }
+
+    auto frame_op = [&] {
+        auto res = frame();
+        Consume(res);
+    };
+    auto receive_op = [&] {
+        auto res = receive();
+        Consume(res);
+    };
+    auto parse_op = [&] {
+        for (auto &msg : received) {
+            ERR err;
+            std::unique_ptr<proto::Response> resp(
+                proto::ParseResponse(&msg, &err));
+            Consume(resp);
+        }
+    };
+    double frame_ns = MeasureNs(frame_op);
+    double receive_ns = MeasureNs(receive_op);
+    double parse_ns = MeasureNs(parse_op);
+
+    Report("proto/message/" + sample.name + "/" + OrderName(order),
+           {
+               {"ok", ok},
+               {"frames", static_cast<double>(frames.size())},
+               {"wire_bytes", static_cast<double>(wire_size)},
+               {"frame_ns_per_op", frame_ns},
+               {"frame_bytes_per_s", wire_size * 1e9 / frame_ns},
+               {"receive_ns_per_op", receive_ns},
+               {"receive_bytes_per_s", wire_size * 1e9 / receive_ns},
+               {"parse_response_ns_per_op", parse_ns},
+               {"parse_response_bytes_per_s", wire_size * 1e9 / parse_ns},
+               {"frame_allocs_per_op", AllocsPerOp(frame_op)},
+               {"receive_allocs_per_op", AllocsPerOp(receive_op)},
+               {"parse_response_allocs_per_op", AllocsPerOp(parse_op)},
+           });
+}
+}  // namespace
+
+void RunProto() {
+    for (auto order : {proto::BYTE_ORDER_NETWORK, proto::BYTE_ORDER_NATIVE}) {
+        RunPackCtx(order);
+    }
+    for (const auto &sample : SampleResponses()) {
+        for (auto order :
+             {proto::BYTE_ORDER_NETWORK, proto::BYTE_ORDER_NATIVE}) {
+            RunFraming(sample, order);
+        }
+    }
+}
+}  // namespace bench
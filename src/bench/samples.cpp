@@ -0,0 +1,110 @@
+#include "samples.hpp"
+
+#include <cstdio>
+
+namespace bench {
+namespace {
+constexpr usize DRIVE_COUNT = 64;
+constexpr usize ACE_COUNT = 128;
+constexpr u32 DISTINCT_SIDS = 4;
+// Bulk queries over a project tree, where most files inherit one of a few
+// ACLs from their directories.
+constexpr usize PATH_COUNT = 256;
+constexpr u32 DISTINCT_ACLS = 8;
+constexpr usize ACES_PER_ACL = 6;
+
+// S-1-5-21-<domain>-<rid> in the binary layout GetLengthSid reports,
+// zero-padded to the fixed 32 bytes used on the wire.
+std::array<u8, 32> MakeSid(u32 rid) {
+    std::array<u8, 32> sid{};
+    const u32 sub_auths[] = {21, 3623811015, 3361044348, 30300820, rid};
+    sid[0] = 1;
+    sid[1] = 5;
+    sid[7] = 5;
+    for (usize i = 0; i < 5; i++) {
+        std::memcpy(sid.data() + 8 + i * sizeof(u32), &sub_auths[i],
+                    sizeof(u32));
+    }
+    return sid;
+}
+
+std::string MakePath(usize i) {
+    char path[96];
+    snprintf(path, sizeof(path),
+             "D:\\projects\\team%02llu\\docs\\report%03llu.docx",
+             static_cast<unsigned long long>(i % 16),
+             static_cast<unsigned long long>(i));
+    return path;
+}
+}  // namespace
+
+std::vector<Sample> SampleResponses() {
+    std::vector<Sample> samples;
+
+    samples.push_back({"os_info", std::make_unique<proto::OsInfoResponse>(
+                                      OSInfo{OS_WIN64, {10, 0}})});
+    samples.push_back(
+        {"time", std::make_unique<proto::TimeResponse>(1729339200000, 3)});
+    samples.push_back({"memory", std::make_unique<proto::MemoryResponse>(
+                                     MemInfo{32_GB, 11_GB})});
+
+    std::vector<DriveInfo> drives;
+    for (usize i = 0; i < DRIVE_COUNT; i++) {
+        char name[64];
+        snprintf(name, sizeof(name), "\\\\fileserver\\projects\\team%02llu\\",
+                 static_cast<unsigned long long>(i));
+        drives.push_back({i % 4 ? DRIVE_TYPE_NET : DRIVE_TYPE_LOCAL, name,
+                          (i + 1) * 7_GB + i * 4096});
+    }
+    samples.push_back(
+        {"drives", std::make_unique<proto::DrivesResponse>(drives)});
+
+    AccessRightsInfo rights;
+    for (usize i = 0; i < ACE_COUNT; i++) {
+        rights.entries.push_back({
+            .sid = MakeSid(500 + i % DISTINCT_SIDS),
+            .aceType = i % 8 ? ACE_TYPE_ALLOWED : ACE_TYPE_DENIED,
+            .scope = static_cast<Scope>(i % 3),
+            .accessMask = i % 2 ? 0x001F01FFu : 0x001200A9u,
+        });
+    }
+    samples.push_back(
+        {"rights", std::make_unique<proto::RightsResponse>(rights)});
+
+    samples.push_back({"owner", std::make_unique<proto::OwnerResponse>(
+                                    OwnerInfo{"Administrator", "CORP",
+                                              MakeSid(500)})});
+
+    std::vector<SharedAcl> acls;
+    for (u32 id = 0; id < DISTINCT_ACLS; id++) {
+        SharedAcl acl{.id = id};
+        for (usize i = 0; i < ACES_PER_ACL; i++) {
+            acl.info.entries.push_back({
+                .sid = MakeSid(500 + (id + i) % DISTINCT_SIDS),
+                .aceType = i ? ACE_TYPE_ALLOWED : ACE_TYPE_DENIED,
+                .scope = static_cast<Scope>(i % 3),
+                .accessMask = i % 2 ? 0x001F01FFu : 0x001200A9u,
+            });
+        }
+        acls.push_back(std::move(acl));
+    }
+    std::vector<PathAclInfo> acl_paths;
+    std::vector<PathOwnerInfo> owners;
+    for (usize i = 0; i < PATH_COUNT; i++) {
+        acl_paths.push_back({.path = MakePath(i),
+                             .acl = static_cast<u32>(i % DISTINCT_ACLS)});
+        owners.push_back(
+            {.path = MakePath(i),
+             .info = {"user" + std::to_string(i % 16), "CORP",
+                      MakeSid(1000 + i % 16)}});
+    }
+    samples.push_back({"rights_bulk",
+                       std::make_unique<proto::BulkRightsResponse>(
+                           std::move(acls), std::move(acl_paths))});
+    samples.push_back(
+        {"owner_bulk",
+         std::make_unique<proto::BulkOwnerResponse>(std::move(owners))});
+
+    return samples;
+}
+}  // namespace bench
@@ -0,0 +1,22 @@
+#ifndef BSIT_3_SAMPLES_HPP
+#define BSIT_3_SAMPLES_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../common/proto/response.hpp"
+
+namespace bench {
+struct Sample {
+    std::string name;
+    std::unique_ptr<proto::Response> resp;
+};
+
+// One representative response per ResponseType. The list-shaped ones are
+// sized like a busy file server: dozens of mounts, ACLs with a handful of
+// distinct SIDs repeated across many entries.
+std::vector<Sample> SampleResponses();
+}  // namespace bench
+
+#endif
@@ -0,0 +1,76 @@
+#include "../common/utf/utf.hpp"
+
+#include "bench.hpp"
+
+namespace bench {
+namespace {
+namespace utf = utils::utf;
+
+constexpr usize PATH_COUNT = 64;
+
+const char *IsaName(utf::Isa isa) {
+    switch (isa) {
+        case utf::ISA_AVX2:
+            return "avx2";
+        case utf::ISA_SSE41:
+            return "sse41";
+        default:
+            return "scalar";
+    }
+}
+
+// A batch of long paths as the rights and owner queries send them.
+std::u32string MakePaths(std::u32string_view component) {
+    std::u32string res;
+    for (usize i = 0; i < PATH_COUNT; i++) {
+        res += U"C:\\Users\\";
+        for (usize k = 0; k < 6; k++) {
+            res += component;
+            res += U'\\';
+        }
+        res += U"report_2024.txt";
+    }
+    return res;
+}
+
+void RunText(const char *name, const std::u32string &text) {
+    std::u16string utf16;
+    std::string utf8;
+    utf::ToUtf16(text, &utf16);
+    utf::ToUtf8(text, &utf8);
+
+    for (auto isa : {utf::ISA_SCALAR, utf::ISA_SSE41, utf::ISA_AVX2}) {
+        if (isa > utf::SupportedIsa()) continue;
+        utf::UseIsa(isa);
+        std::u16string out16;
+        std::u32string out32;
+        std::string out8;
+        double to16_ns = MeasureNs([&] { utf::ToUtf16(text, &out16); });
+        double from16_ns = MeasureNs([&] { utf::ToUtf32(utf16, &out32); });
+        double to8_ns = MeasureNs([&] { utf::ToUtf8(utf16, &out8); });
+        double from8_ns = MeasureNs([&] { utf::ToUtf16(utf8, &out16); });
+        double valid8_ns = MeasureNs([&] { Consume(utf::ValidUtf8(utf8)); });
+        double chars = static_cast<double>(text.size());
+
+        Report(std::string("utf/") + name + "/" + IsaName(isa),
+               {
+                   {"chars", chars},
+                   {"utf32_to_utf16_chars_per_s", chars * 1e9 / to16_ns},
+                   {"utf16_to_utf32_chars_per_s", chars * 1e9 / from16_ns},
+                   {"utf16_to_utf8_chars_per_s", chars * 1e9 / to8_ns},
+                   {"utf8_to_utf16_chars_per_s", chars * 1e9 / from8_ns},
+                   {"utf8_validate_bytes_per_s",
+                    static_cast<double>(utf8.size()) * 1e9 / valid8_ns},
+               });
+    }
+    utf::UseIsa(utf::SupportedIsa());
+}
+}  // namespace
+
+void RunUtf() {
+    RunText("ascii", MakePaths(U"projects"));
+    RunText("cyrillic", MakePaths(U"\u043f\u0440\u043e\u0435\u043a\u0442"));
+    RunText("cjk", MakePaths(U"\u9879\u76ee\u6587\u4ef6"));
+    RunText("emoji", MakePaths(U"\U0001F4C1\U0001F4C2"));
+}
+}  // namespace bench
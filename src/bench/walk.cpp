@@ -0,0 +1,94 @@
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "../server/os_utils/walker.hpp"
+
+#include "bench.hpp"
+
+namespace bench {
+namespace {
+const std::wstring ROOT = L"/usr/include";
+constexpr u8 DEPTH = 32;
+
+// Counts the paths of a walk and wakes the caller when it is done.
+class CountingSink : public os_utils::WalkSink {
+public:
+    bool Ready() override { return true; }
+
+    void Visit(const os_utils::WalkEntry &entry) override { m_paths++; }
+
+    void Done() override {
+        std::lock_guard lock(m_lock);
+        m_done = true;
+        m_ready.notify_one();
+    }
+
+    usize Wait() {
+        std::unique_lock lock(m_lock);
+        m_ready.wait(lock, [this] { return m_done; });
+        return m_paths;
+    }
+
+private:
+    std::atomic<usize> m_paths = 0;
+    std::mutex m_lock;
+    std::condition_variable m_ready;
+    bool m_done = false;
+};
+
+// The recursion the walker replaces: every level listed by its full path.
+usize ListRecursive(const std::wstring &path, u8 depth) {
+    usize paths = 1;
+    if (depth == 0) return paths;
+    std::vector<os_utils::DirEntry> entries;
+    os_utils::list_directory(path, &entries);
+    for (const auto &entry : entries) {
+        paths += entry.directory ? ListRecursive(entry.path, depth - 1) : 1;
+    }
+    return paths;
+}
+
+void RunWalker(const std::string &prefix, u32 workers, double list_ns) {
+    os_utils::Walker walker(workers);
+    usize paths = 0;
+    double ns = MeasureNs([&] {
+        auto sink = std::make_shared<CountingSink>();
+        auto walk = walker.Start({ROOT}, DEPTH, sink);
+        paths = sink->Wait();
+    });
+    Report(prefix + "walker",
+           {{"workers", static_cast<double>(workers)},
+            {"paths", static_cast<double>(paths)},
+            {"ns_per_op", ns},
+            {"paths_per_s", static_cast<double>(paths) * 1e9 / ns},
+            {"speedup", list_ns / ns}});
+}
+}  // namespace
+
+// A real tree on the host provider, the walker against a serial recursion
+// over ListDirectory.
+void RunWalk() {
+    os_utils::init();
+    ERR err;
+    if (!os_utils::open_directory(ROOT, &err)) {
+        return;
+    }
+    std::string prefix =
+        std::string("walk/") + os_utils::g_provider->Name() + "/";
+
+    usize paths = 0;
+    double list_ns = MeasureNs([&] { paths = ListRecursive(ROOT, DEPTH); });
+    Report(prefix + "list_directory",
+           {{"paths", static_cast<double>(paths)},
+            {"ns_per_op", list_ns},
+            {"paths_per_s", static_cast<double>(paths) * 1e9 / list_ns}});
+    RunWalker(prefix, 1, list_ns);
+    // hardware_concurrency() is 0 when it is not known.
+    u32 cores = std::thread::hardware_concurrency();
+    if (cores > 1) {
+        RunWalker(prefix, cores, list_ns);
+    }
+}
+}  // namespace bench
@@ -1,5 +1,7 @@
 #include "cli.hpp"
 
+#include <cwchar>
+
 #include <windows.h>
 #include <sddl.h>
 
@@ -10,6 +12,82 @@
 #pragma comment(lib, "AdvApi32.lib")
 
 namespace cli {
+namespace {
+void PrintOwner(const OwnerInfo &info) {
+    std::cout << info.ownerDomain << "\\" << info.ownerName << " ";
+    char *sidString = nullptr;
+    if (ConvertSidToStringSidA(
+            reinterpret_cast<PSID>(
+                const_cast<unsigned char *>(info.sid.data())),
+            &sidString)) {
+        std::cout << "SID: " << sidString << "\n";
+        LocalFree(sidString);
+    } else {
+        std::cout << "SID: (failed to convert SID to string format)\n";
+    }
+}
+
+// Splits "<depth> <path>..." of the bulk commands.
+ERR ParseBulkArgs(int argc, wchar_t **argv, u8 *depth,
+                  std::vector<std::wstring> *paths) {
+    int value = 0;
+    try {
+        value = std::stoi(utils::to_string(argv[1]));
+    } catch (...) {
+        WARN("Invalid depth: %S", argv[1]);
+        return ERR_InvalidArgument;
+    }
+    if (value < 0 || value > UINT8_MAX) {
+        WARN("Depth must be between 0 and %d", UINT8_MAX);
+        return ERR_InvalidArgument;
+    }
+    *depth = static_cast<u8>(value);
+    paths->assign(argv + 2, argv + argc);
+    return ERR_Ok;
+}
+
+// Cuts "where <expr>" off the arguments and parses the expression for the
+// entries cmd lists, see proto::Filter::Parse.
+ERR ParseFilter(CMD cmd, int *argc, wchar_t **argv, proto::Filter *filter) {
+    int where = 1;
+    while (where < *argc && std::wcscmp(argv[where], L"where") != 0) {
+        where++;
+    }
+    if (where == *argc) {
+        return ERR_Ok;
+    }
+    proto::FilterTarget target;
+    switch (cmd) {
+        case CMD_GetDrives:
+            target = proto::FILTER_TARGET_DRIVE;
+            break;
+        case CMD_GetRights:
+        case CMD_GetBulkRights:
+            target = proto::FILTER_TARGET_ACE;
+            break;
+        case CMD_GetBulkOwner:
+            target = proto::FILTER_TARGET_OWNER;
+            break;
+        default:
+            WARN("%S does not take a filter", commandText[cmd]);
+            return ERR_InvalidArgument;
+    }
+    // split took the quotes off values with spaces, they go back on.
+    std::string text;
+    for (int i = where + 1; i < *argc; i++) {
+        std::string arg = utils::to_string(argv[i]);
+        if (arg.find(' ') != std::string::npos) {
+            arg = '"' + arg + '"';
+        }
+        if (!text.empty()) {
+            text += ' ';
+        }
+        text += arg;
+    }
+    *argc = where;
+    return proto::Filter::Parse(text, target, filter);
+}
+}  // namespace
 
 Cli::Cli() : Cli("", "") {}
 
@@ -183,6 +261,12 @@ ERR Cli::exec(CMD cmd, int argc, wchar_t **argv) {
         return m_connectors[m_activeServer];
     };
 
+    proto::Filter filter;
+    ERR err = ParseFilter(cmd, &argc, argv, &filter);
+    if (err != ERR_Ok) {
+        return err;
+    }
+
     switch (cmd) {
         case CMD_Exit:
             return ERR_Ok;
@@ -213,7 +297,7 @@ ERR Cli::exec(CMD cmd, int argc, wchar_t **argv) {
 
         case CMD_GetDrives:
             if (auto *c = activeConn()) {
-                return getDrives();
+                return getDrives(filter);
             }
             return ERR_Connect;
 
@@ -223,7 +307,7 @@ ERR Cli::exec(CMD cmd, int argc, wchar_t **argv) {
                 return ERR_InvalidArgument;
             }
             if (auto *c = activeConn()) {
-                return getRights(argv[1]);
+                return getRights(argv[1], filter);
             }
             return ERR_Connect;
 
@@ -237,6 +321,26 @@ ERR Cli::exec(CMD cmd, int argc, wchar_t **argv) {
             }
             return ERR_Connect;
 
+        case CMD_GetBulkRights:
+            if (argc < 3) {
+                WARN("Usage: bulk-rights <depth> <path>...");
+                return ERR_InvalidArgument;
+            }
+            if (auto *c = activeConn()) {
+                return getBulkRights(argc, argv, filter);
+            }
+            return ERR_Connect;
+
+        case CMD_GetBulkOwner:
+            if (argc < 3) {
+                WARN("Usage: bulk-owner <depth> <path>...");
+                return ERR_InvalidArgument;
+            }
+            if (auto *c = activeConn()) {
+                return getBulkOwner(argc, argv, filter);
+            }
+            return ERR_Connect;
+
         case CMD_Disconnect:
             if (auto *c = activeConn()) {
                 c->disconnect();
@@ -356,26 +460,26 @@ ERR Cli::getMemory() {
     return err;
 }
 
-ERR Cli::getDrives() {
+ERR Cli::getDrives(const proto::Filter &filter) {
     auto *conn = m_connectors[m_activeServer];
     std::vector<DriveInfo> drives;
-    ERR err = conn->getDrives(&drives);
+    ERR err = conn->getDrives(&drives, filter);
     if (err != ERR_Ok) {
         return err;
     }
     std::cout << "Mounted drives:\n";
-    for (const auto &[type, name, free_bytes] : drives) {
+    for (const auto &[type, name, free_bytes, stale] : drives) {
         std::cout << "\t" << name << " [" << DriveTypeName[type]
                   << "] Free space: " << utils::format_bytes(free_bytes)
-                  << std::endl;
+                  << (stale ? " (stale)" : "") << std::endl;
     }
     return err;
 }
 
-ERR Cli::getRights(const wchar_t *path) {
+ERR Cli::getRights(const wchar_t *path, const proto::Filter &filter) {
     auto *conn = m_connectors[m_activeServer];
     AccessRightsInfo info{};
-    ERR err = conn->getRights(&info, path);
+    ERR err = conn->getRights(&info, path, filter);
     if (err != ERR_Ok) {
         return err;
     }
@@ -390,16 +494,57 @@ ERR Cli::getOwner(const wchar_t *path) {
     if (err != ERR_Ok) {
         return err;
     }
-    std::cout << info.ownerDomain << "\\" << info.ownerName << " ";
-    char *sidString = nullptr;
-    if (ConvertSidToStringSidA(
-            reinterpret_cast<PSID>(
-                const_cast<unsigned char *>(info.sid.data())),
-            &sidString)) {
-        std::cout << "SID: " << sidString << "\n";
-        LocalFree(sidString);
-    } else {
-        std::cout << "SID: (failed to convert SID to string format)\n";
+    PrintOwner(info);
+    return err;
+}
+
+ERR Cli::getBulkRights(int argc, wchar_t **argv,
+                       const proto::Filter &filter) {
+    auto *conn = m_connectors[m_activeServer];
+    u8 depth;
+    std::vector<std::wstring> paths;
+    ERR err = ParseBulkArgs(argc, argv, &depth, &paths);
+    if (err != ERR_Ok) {
+        return err;
+    }
+    std::vector<PathRightsInfo> results;
+    err = conn->getBulkRights(&results, paths, depth, filter);
+    if (err != ERR_Ok) {
+        return err;
+    }
+    for (const auto &result : results) {
+        std::cout << result.path << ":";
+        if (result.err != ERR_Ok) {
+            std::cout << " " << errorText[result.err] << std::endl;
+            continue;
+        }
+        std::cout << std::endl;
+        utils::print_access_rights(result.info);
+    }
+    return err;
+}
+
+ERR Cli::getBulkOwner(int argc, wchar_t **argv,
+                      const proto::Filter &filter) {
+    auto *conn = m_connectors[m_activeServer];
+    u8 depth;
+    std::vector<std::wstring> paths;
+    ERR err = ParseBulkArgs(argc, argv, &depth, &paths);
+    if (err != ERR_Ok) {
+        return err;
+    }
+    std::vector<PathOwnerInfo> results;
+    err = conn->getBulkOwners(&results, paths, depth, filter);
+    if (err != ERR_Ok) {
+        return err;
+    }
+    for (const auto &result : results) {
+        std::cout << result.path << ": ";
+        if (result.err != ERR_Ok) {
+            std::cout << errorText[result.err] << std::endl;
+            continue;
+        }
+        PrintOwner(result.info);
     }
     return err;
 }
@@ -18,6 +18,8 @@ enum CMD : u8 {
     CMD_GetDrives,
     CMD_GetRights,
     CMD_GetOwner,
+    CMD_GetBulkRights,
+    CMD_GetBulkOwner,
     CMD_Disconnect,
     CMD_Add,
     CMD_Srv,
@@ -25,8 +27,10 @@ enum CMD : u8 {
 };
 
 inline const wchar_t *commandText[CMD_Count_] = {
-    L"exit",   L"os",    L"time",       L"uptime", L"memory", L"drives",
-    L"rights", L"owner", L"disconnect", L"add",    L"srv",
+    L"exit",       L"os",         L"time",       L"uptime",
+    L"memory",     L"drives",     L"rights",     L"owner",
+    L"bulk-rights", L"bulk-owner", L"disconnect", L"add",
+    L"srv",
 };
 
 inline const wchar_t *commandDescription[CMD_Count_] = {
@@ -35,9 +39,13 @@ inline const wchar_t *commandDescription[CMD_Count_] = {
     L"get current time on server",
     L"get server uptime",
     L"get server RAM info",
-    L"get drives mounted to server",
-    L"<path> get access rights to file at <path>",
+    L"[where <expr>] get drives mounted to server",
+    L"<path> [where <expr>] get access rights to file at <path>",
     L"<path> get owner of file at <path>",
+    L"<depth> <path>... [where <expr>] get access rights to files at "
+    L"<path>s and up to <depth> levels below",
+    L"<depth> <path>... [where <expr>] get owners of files at <path>s and "
+    L"up to <depth> levels below",
     L"close connection to current server",
     L"<ip> <port> connect to server",
     L"<number> switch to server",
@@ -79,9 +87,11 @@ private:
     ERR getTime();
     ERR getUptime();
     ERR getMemory();
-    ERR getDrives();
-    ERR getRights(const wchar_t *path);
+    ERR getDrives(const proto::Filter &filter);
+    ERR getRights(const wchar_t *path, const proto::Filter &filter);
     ERR getOwner(const wchar_t *path);
+    ERR getBulkRights(int argc, wchar_t **argv, const proto::Filter &filter);
+    ERR getBulkOwner(int argc, wchar_t **argv, const proto::Filter &filter);
 
     ERR addServer(int argc, wchar_t **argv);
 
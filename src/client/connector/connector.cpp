@@ -1,12 +1,46 @@
 #include "connector.hpp"
 
+#include <iterator>
+#include <mutex>
+#include <span>
 #include <utility>
 
 #include "../../common/logging.hpp"
 #include "../../common/proto/encryption/encryption.hpp"
+#include "../../common/proto/handshake.hpp"
 #include "../../common/proto/proto.hpp"
+#include "../../common/utf/utf.hpp"
 
 namespace connector {
+namespace {
+// The encryption manager is shared by all connectors, the cipher state of
+// each connection lives in its tcp::Context. Levels below full encryption
+// are up to the caller, see proto::AllowSecurityLevels.
+void InitEncryption() {
+    static std::once_flag once;
+    std::call_once(once, [] { proto::encryption::init(); });
+}
+
+// The RSA key pair is only needed for servers without X25519, so it is
+// generated on the first connection to one rather than on startup. It is
+// only read once created.
+void InitRsaKey() {
+    static std::once_flag once;
+    std::call_once(
+        once, [] { proto::encryption::g_instance->CreateAsymmetricKey(); });
+}
+
+void Collect(proto::BulkRightsResponse *resp,
+             std::vector<PathRightsInfo> *res) {
+    resp->resolve(res);
+}
+
+void Collect(proto::BulkOwnerResponse *resp, std::vector<PathOwnerInfo> *res) {
+    res->insert(res->end(), std::make_move_iterator(resp->results.begin()),
+                std::make_move_iterator(resp->results.end()));
+}
+}  // namespace
+
 Connector::Connector(u32 cid, const std::string &host, u16 port) {
     m_id = cid;
     this->m_host = host;
@@ -19,8 +53,7 @@ Connector::Connector(u32 cid, const std::string &host, u16 port) {
     }
     OKAY("Initialized connector for %s:%d", host.c_str(), port);
     m_canConnect = true;
-    proto::encryption::init();
-    proto::encryption::g_instance->CreateAsymmetricKey();
+    InitEncryption();
 }
 
 bool Connector::canConnect() const { return m_canConnect; }
@@ -36,37 +69,99 @@ void Connector::setServer(std::string host, u16 port) {
     m_host = std::move(host);
     m_port = port;
     m_canConnect = true;
+    // Tickets only open on the server that issued them.
+    m_ticket.clear();
 }
 
 std::string Connector::getHostStr() { return m_host; }
 
-proto::Response *Connector::exec(proto::Request *req, ERR *err) {
+ResponseStream Connector::stream(proto::Request *req, ERR *err) {
     *err = ERR_Ok;
     if (!m_ctx || m_ctx->Expired()) {
         INFO("Reconnecting to the server...");
         *err = reconnect();
         if (*err != ERR_Ok) {
             INFO("Error connecting to server: %s", errorText[*err]);
-            return nullptr;
+            return ResponseStream(nullptr);
         }
     }
 
-    int res = 0;
-
-    auto msg = proto::Message(req, proto::MESSAGE_ENCRYPTION_SYMMETRIC, m_id);
+    auto msg = proto::Message(
+        req, proto::NegotiatedEncryption(m_ctx->GetFeatures()),
+        m_ctx->GetSession(), m_ctx->GetFeatures());
     *err = m_ctx->Send(&msg);
     if (*err != ERR_Ok) {
-        return nullptr;
+        return ResponseStream(nullptr);
+    }
+
+    return ResponseStream(m_ctx);
+}
+
+proto::Response *Connector::exec(proto::Request *req, ERR *err) {
+    proto::Response *resp = nullptr;
+    {
+        ResponseStream frames = stream(req, err);
+        if (*err == ERR_Ok) {
+            resp = frames.Next(err);
+        }
+        while (resp && !frames.Done()) {
+            proto::Response *part = frames.Next(err);
+            if (part) {
+                *err = resp->append(*part);
+                delete part;
+            }
+            if (*err != ERR_Ok) {
+                delete resp;
+                resp = nullptr;
+            }
+        }
     }
-    proto::Message resp_msg = m_ctx->Receive(err);
+
     if (*err != ERR_Ok) {
-        return nullptr;
+        // The connection may be left in the middle of a frame, start over on
+        // the next request.
+        disconnect();
     }
-    proto::Response *resp = proto::ParseResponse(&resp_msg, err);
 
     return resp;
 }
 
+template <typename Resp, typename Info>
+ERR Connector::execBulk(proto::RequestType type, std::vector<Info> *res,
+                        const std::vector<std::wstring> &paths, u8 depth,
+                        const proto::Filter &filter) {
+    const usize max_size = MAX_REQUEST_SIZE - proto::Message::HeaderSize() -
+                           proto::encryption::MAX_OVERHEAD -
+                           filter.packedSize();
+    std::span<const std::wstring> rest(paths);
+    while (!rest.empty()) {
+        usize count = proto::Request::FitPaths(rest, max_size);
+        if (count == 0) {
+            // No request can carry this path, the server would not read it.
+            Info info{};
+            utils::utf::ToUtf8(rest.front(), &info.path,
+                               utils::utf::UTF_REPLACE);
+            info.err = ERR_InvalidArgument;
+            res->push_back(std::move(info));
+            rest = rest.subspan(1);
+            continue;
+        }
+
+        auto req = proto::Request(type, rest.first(count), depth);
+        req.filter = filter;
+        ERR err = ERR_Ok;
+        proto::Response *resp = exec(&req, &err);
+        if (err != ERR_Ok) {
+            return err;
+        }
+        Collect(reinterpret_cast<Resp *>(resp), res);
+        delete resp;
+        rest = rest.subspan(count);
+    }
+
+    return ERR_Ok;
+}
+
 ERR Connector::getOsInfo(OSInfo *res) {
     auto req = proto::Request(proto::REQ_OS_INFO);
     ERR err = ERR_Ok;
@@ -139,8 +234,10 @@ ERR Connector::getMemory(MemInfo *res) {
     return err;
 }
 
-ERR Connector::getDrives(std::vector<DriveInfo> *res) {
+ERR Connector::getDrives(std::vector<DriveInfo> *res,
+                         const proto::Filter &filter) {
     auto req = proto::Request(proto::REQ_DRIVES);
+    req.filter = filter;
     ERR err = ERR_Ok;
     proto::Response *resp = exec(&req, &err);
 
@@ -149,15 +246,19 @@ ERR Connector::getDrives(std::vector<DriveInfo> *res) {
     }
 
     if (res) {
-        *res = reinterpret_cast<proto::DrivesResponse *>(resp)->drives;
+        const auto &drives =
+            reinterpret_cast<proto::DrivesResponse *>(resp)->drives;
+        res->assign(drives.begin(), drives.end());
     }
     delete resp;
 
     return err;
 }
 
-ERR Connector::getRights(AccessRightsInfo *res, const std::wstring &str) {
+ERR Connector::getRights(AccessRightsInfo *res, const std::wstring &str,
+                         const proto::Filter &filter) {
     auto req = proto::Request(proto::REQ_RIGHTS, str);
+    req.filter = filter;
     ERR err = ERR_Ok;
     proto::Response *resp = exec(&req, &err);
 
@@ -189,6 +290,20 @@ ERR Connector::getOwner(OwnerInfo *res, const std::wstring &str) {
 
     return err;
 }
+
+ERR Connector::getBulkRights(std::vector<PathRightsInfo> *res,
+                             const std::vector<std::wstring> &paths,
+                             u8 depth, const proto::Filter &filter) {
+    return execBulk<proto::BulkRightsResponse>(proto::REQ_RIGHTS_BULK, res,
+                                               paths, depth, filter);
+}
+
+ERR Connector::getBulkOwners(std::vector<PathOwnerInfo> *res,
+                             const std::vector<std::wstring> &paths,
+                             u8 depth, const proto::Filter &filter) {
+    return execBulk<proto::BulkOwnerResponse>(proto::REQ_OWNER_BULK, res,
+                                              paths, depth, filter);
+}
 ERR Connector::reconnect() {
     INFO("Removing old context");
     delete m_ctx;
@@ -201,29 +316,143 @@ ERR Connector::reconnect() {
         return err;
     }
 
-    DWORD size;
-    auto buf = proto::encryption::g_instance->ExportPublicKey(&size);
-    proto::Message msg(proto::MESSAGE_KEY_REQUEST, buf, size,
-                       proto::MESSAGE_ENCRYPTION_NONE);
+    InitEncryption();
+    if (!m_ticket.empty()) {
+        bool resumed = false;
+        err = resume(&resumed);
+        if (err != ERR_Ok || resumed) {
+            return err;
+        }
+        INFO("Ticket rejected, falling back to key exchange");
+    }
+    return exchangeKeys();
+}
+
+ERR Connector::exchangeKeys() {
+    auto mgr = proto::encryption::g_instance;
+    ERR err = ERR_Ok;
+    proto::Message resp_msg;
+    std::unique_ptr<proto::encryption::KeyShare> share;
+    if (mgr->SupportsKeyAgreement()) {
+        share = mgr->CreateKeyShare();
+    }
+    if (share) {
+        proto::KeyRequest key_req(proto::LocalFeatures(), share->PublicKey(),
+                                  proto::encryption::X25519_KEY_SIZE);
+        INFO("Requesting X25519 key agreement...");
+        err = handshake(proto::MESSAGE_KEY_REQUEST, key_req, &resp_msg);
+        if (err != ERR_Ok) {
+            return err;
+        }
+        proto::KeyResponse key_resp(resp_msg.buf(), resp_msg.payloadSize());
+        if (!key_resp.valid) {
+            return ERR_Invalid_Response;
+        }
+        if (key_resp.features & proto::FEATURE_X25519) {
+            OKAY("Key agreed");
+            return startSession(
+                mgr->AgreeSession(*share, key_resp.key.data(),
+                                  key_resp.key.size(), false),
+                key_resp.features, key_resp.ticket);
+        }
+        INFO("Server does not support X25519, falling back to RSA");
+    }
+
+    InitRsaKey();
+    usize size;
+    auto buf = mgr->ExportPublicKey(&size);
+    proto::KeyRequest key_req(proto::LocalFeatures() & ~proto::FEATURE_X25519,
+                              buf, size);
+    delete[] buf;
     INFO("Requesting key...");
-    err = m_ctx->Send(&msg);
+    err = handshake(proto::MESSAGE_KEY_REQUEST, key_req, &resp_msg);
     if (err != ERR_Ok) {
         return err;
     }
-    OKAY("Key request sent");
+    OKAY("Key received");
+
+    proto::KeyResponse key_resp(resp_msg.buf(), resp_msg.payloadSize());
+    if (!key_resp.valid) {
+        return ERR_Invalid_Response;
+    }
+    return startSession(
+        mgr->ImportSession(key_resp.key.data(), key_resp.key.size()),
+        key_resp.features, key_resp.ticket);
+}
 
-    INFO("Receiving key response...");
-    proto::Message resp_msg = m_ctx->Receive(&err);
+ERR Connector::resume(bool *resumed) {
+    *resumed = false;
+    // A ticket is only tried once, whatever happens the connection ends up
+    // with a new one or none.
+    std::vector<u8> ticket = std::move(m_ticket);
+    m_ticket.clear();
+
+    u8 random[proto::encryption::RESUMPTION_RANDOM_SIZE];
+    proto::encryption::g_instance->Random(random, sizeof(random));
+    proto::ResumeRequest resume_req(proto::LocalFeatures(), ticket.data(),
+                                    ticket.size(), random);
+    INFO("Resuming session...");
+    proto::Message resp_msg;
+    ERR err = handshake(proto::MESSAGE_RESUME_REQUEST, resume_req, &resp_msg);
     if (err != ERR_Ok) {
         return err;
     }
-    OKAY("Key received");
+    if (resp_msg.type() != proto::MESSAGE_RESUME_RESPONSE) {
+        return ERR_Invalid_Response;
+    }
+    proto::ResumeResponse resume_resp(resp_msg.buf(), resp_msg.payloadSize());
+    if (!resume_resp.valid) {
+        return ERR_Invalid_Response;
+    }
+    if (!resume_resp.accepted()) {
+        return ERR_Ok;
+    }
 
-    proto::encryption::g_instance->ImportSymmetricKey(m_id, resp_msg.buf(),
-                                                      resp_msg.size());
+    *resumed = true;
+    OKAY("Session resumed");
+    return startSession(proto::encryption::g_instance->ResumeFromSecret(
+                            m_resumptionSecret.data(), random,
+                            resume_resp.random.data()),
+                        resume_resp.features, resume_resp.ticket);
+}
 
+ERR Connector::handshake(proto::MessageType type, const proto::Packable &req,
+                         proto::Message *resp) {
+    usize packed_size;
+    auto packed = req.pack(&packed_size, proto::BYTE_ORDER_NETWORK);
+    proto::Message msg(type, packed.get(), packed_size,
+                       proto::MESSAGE_ENCRYPTION_NONE);
+    ERR err = m_ctx->Send(&msg);
+    if (err != ERR_Ok) {
+        return err;
+    }
+    *resp = m_ctx->Receive(&err);
     return err;
 }
+
+ERR Connector::startSession(std::unique_ptr<proto::encryption::Session> session,
+                            u32 features, const std::vector<u8> &ticket) {
+    if (!session) {
+        return ERR_Invalid_Response;
+    }
+    m_ctx->SetFeatures(proto::NegotiateFeatures(features));
+    INFO("Negotiated features 0x%x", features);
+    ERR err = session->SetCipher(proto::NegotiatedCipher(m_ctx->GetFeatures()));
+    m_ctx->SetSession(std::move(session));
+    keepTicket(ticket);
+    return err;
+}
+
+void Connector::keepTicket(const std::vector<u8> &ticket) {
+    if (ticket.empty() ||
+        proto::encryption::g_instance->ExportResumptionSecret(
+            *m_ctx->GetSession(), m_resumptionSecret.data()) != ERR_Ok) {
+        m_ticket.clear();
+        return;
+    }
+    m_ticket = ticket;
+}
+
 void Connector::disconnect() {
     INFO("Disconnecting");
     delete m_ctx;
@@ -1,14 +1,18 @@
 #ifndef CONNECTOR_HPP
 #define CONNECTOR_HPP
 
+#include <array>
 #include <string>
+#include <vector>
 
 #include "../../common/alias.hpp"
 #include "../../common/data.hpp"
 #include "../../common/errors.hpp"
+#include "../../common/proto/encryption/encryption.hpp"
 #include "../../common/proto/request.hpp"
 #include "../../common/proto/response.hpp"
 #include "context.hpp"
+#include "stream.hpp"
 
 namespace connector {
 class Connector {
@@ -31,12 +35,33 @@ public:
 
     ERR getMemory(MemInfo *res);
 
-    ERR getDrives(std::vector<DriveInfo> *res);
+    // The filters of the list-shaped queries are applied by the server, see
+    // proto::Filter. Bulk queries leave out paths without a matching ACE or
+    // owner.
+    ERR getDrives(std::vector<DriveInfo> *res,
+                  const proto::Filter &filter = {});
 
-    ERR getRights(AccessRightsInfo *res, const std::wstring &str);
+    ERR getRights(AccessRightsInfo *res, const std::wstring &str,
+                  const proto::Filter &filter = {});
 
     ERR getOwner(OwnerInfo *res, const std::wstring &str);
 
+    // Rights or owners of every path, and of everything up to depth levels
+    // below the directories among them. Results come in no particular
+    // order, a path that could not be looked up carries its own error.
+    ERR getBulkRights(std::vector<PathRightsInfo> *res,
+                      const std::vector<std::wstring> &paths, u8 depth = 0,
+                      const proto::Filter &filter = {});
+
+    ERR getBulkOwners(std::vector<PathOwnerInfo> *res,
+                      const std::vector<std::wstring> &paths, u8 depth = 0,
+                      const proto::Filter &filter = {});
+
+    // Sends req and returns its response frames for incremental
+    // consumption. The stream must be drained or destroyed before the next
+    // request on this connector.
+    ResponseStream stream(proto::Request *req, ERR *err);
+
     void disconnect();
 
     ERR reconnect();
@@ -48,7 +73,32 @@ private:
     tcp::Context *m_ctx = nullptr;
     u32 m_id;
 
+    // Ticket of the last connection and the secret that goes with it, empty
+    // until a server has issued one. See proto::ResumeRequest.
+    std::vector<u8> m_ticket;
+    std::array<u8, proto::encryption::RESUMPTION_SECRET_SIZE>
+        m_resumptionSecret{};
+
     proto::Response *exec(proto::Request *req, ERR *err);
+
+    // Sends paths in as many bulk requests as it takes to stay under
+    // MAX_REQUEST_SIZE and collects the results of all of them.
+    template <typename Resp, typename Info>
+    ERR execBulk(proto::RequestType type, std::vector<Info> *res,
+                 const std::vector<std::wstring> &paths, u8 depth,
+                 const proto::Filter &filter);
+
+    // Handshakes on a fresh m_ctx. exchangeKeys tries X25519 before RSA,
+    // resume sets *resumed if the server accepted the ticket.
+    ERR exchangeKeys();
+    ERR resume(bool *resumed);
+    // Sends a handshake message and waits for the answer.
+    ERR handshake(proto::MessageType type, const proto::Packable &req,
+                  proto::Message *resp);
+    // Installs the session agreed on with the server in m_ctx.
+    ERR startSession(std::unique_ptr<proto::encryption::Session> session,
+                     u32 features, const std::vector<u8> &ticket);
+    void keepTicket(const std::vector<u8> &ticket);
 };
 }  // namespace connector
 
@@ -1,5 +1,7 @@
 #include "context.hpp"
 
+#include <cerrno>
+
 #include "../../common/logging.hpp"
 
 namespace connector::tcp {
@@ -18,6 +20,18 @@ Context::~Context() {
 #endif
 }
 
+void Context::SetFeatures(u32 features) { m_features = features; }
+
+u32 Context::GetFeatures() const { return m_features; }
+
+void Context::SetSession(std::unique_ptr<proto::encryption::Session> session) {
+    m_session = std::move(session);
+}
+
+proto::encryption::Session *Context::GetSession() const {
+    return m_session.get();
+}
+
 bool Context::Expired() {
     return m_socket == INVALID_SOCKET ||
            std::chrono::steady_clock::now() - m_lastConnTime > m_timeout;
@@ -123,48 +137,68 @@ ERR Context::Send(proto::Message *msg) const {
 #endif
 
 #ifdef _WIN32
-proto::Message Context::Receive(ERR *err) {
-    INFO("Waiting for response...");
-    char buf[MAX_MSG_SIZE];
-    int res;
-    usize res_size = 0;
-
-    do {
-        res = recv(m_socket, buf, MAX_MSG_SIZE, 0);
-        res_size += res;
-        INFO("Received %d bytes", res);
-        if (proto::Message::ValidateBuff(reinterpret_cast<const u8 *>(buf), res_size)) {
-            OKAY("Valid message");
-            break;
+ERR Context::RecvExact(u8 *buf, usize size) {
+    usize received = 0;
+    while (received < size) {
+        int res = recv(m_socket, reinterpret_cast<char *>(buf + received),
+                       static_cast<int>(size - received), 0);
+        if (res == 0) {
+            WARN("Connection closed by server");
+            return ERR_Connect;
         }
-    } while (res > 0);
-    OKAY("Receiving finished");
-
-    if (res < 0) {
-        PRINT_ERROR("recv", WSAGetLastError());
-        *err = winCodeToErr(WSAGetLastError());
-        return {};
+        if (res == SOCKET_ERROR) {
+            PRINT_ERROR("recv", WSAGetLastError());
+            return winCodeToErr(WSAGetLastError());
+        }
+        INFO("Received %d bytes", res);
+        received += res;
     }
-    *err = ERR_Ok;
-    // TODO: Pass received size to Message constructor to prevent memory
-    // overflow exploit
-    return proto::Message(m_id, reinterpret_cast<const u8 *>(buf));
+    return ERR_Ok;
 }
 #else
+ERR Context::RecvExact(u8 *buf, usize size) {
+    usize received = 0;
+    while (received < size) {
+        ssize_t res = recv(m_socket, buf + received, size - received, 0);
+        if (res == 0) {
+            WARN("Connection closed by server");
+            return ERR_Connect;
+        }
+        if (res < 0) {
+            PRINT_ERROR("recv", static_cast<unsigned long>(errno));
+            return winCodeToErr(errno);
+        }
+        received += res;
+    }
+    return ERR_Ok;
+}
+#endif
+
 proto::Message Context::Receive(ERR *err) {
     INFO("Waiting for response...");
-    char buf[MAX_MSG_SIZE];
-    int res;
-
-    do {
-        res = recv(m_socket, buf, MAX_MSG_SIZE, 0);
-    } while (res > 0);
-
-    // TODO: check error
-    *err = ERR_Ok;
-    // TODO: Pass received size to Message constructor to prevent memory
-    // overflow exploit
-    return proto::Message(reinterpret_cast<const u8 *>(buf));
+    // Read the size first and then exactly one frame, so the beginning of a
+    // following frame of a streamed response stays in the socket.
+    u8 buf[MAX_MSG_SIZE];
+    *err = RecvExact(buf, sizeof(usize));
+    if (*err != ERR_Ok) {
+        return {};
+    }
+    usize size = proto::Message::FrameSize(buf, m_features);
+    if (size < proto::Message::HeaderSize() || size > MAX_MSG_SIZE) {
+        WARN("Invalid frame size %llu", size);
+        *err = ERR_Invalid_Response;
+        return {};
+    }
+    *err = RecvExact(buf + sizeof(usize), size - sizeof(usize));
+    if (*err != ERR_Ok) {
+        return {};
+    }
+    OKAY("Receiving finished");
+
+    proto::Message msg(m_session.get(), buf, m_features);
+    if (!msg.buf()) {
+        *err = ERR_Invalid_Response;
+    }
+    return msg;
 }
-#endif
 }  // namespace connector::tcp
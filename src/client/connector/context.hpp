@@ -25,9 +25,11 @@
 #endif
 
 #include <chrono>
+#include <memory>
 
 #include "../../common/alias.hpp"
 #include "../../common/errors.hpp"
+#include "../../common/proto/encryption/encryption.hpp"
 #include "../../common/proto/message.hpp"
 
 #ifdef _WIN32
@@ -51,8 +53,20 @@ public:
 
     proto::Message Receive(ERR *err);
 
+    void SetFeatures(u32 features);
+
+    [[nodiscard]] u32 GetFeatures() const;
+
+    // Cipher state agreed on during the key exchange, it lives as long as
+    // the connection.
+    void SetSession(std::unique_ptr<proto::encryption::Session> session);
+
+    [[nodiscard]] proto::encryption::Session *GetSession() const;
+
 private:
     u32 m_id;
+    u32 m_features = 0;
+    std::unique_ptr<proto::encryption::Session> m_session;
 #ifdef _WIN32
     WSADATA m_wsaData = {};
     SOCKET m_socket = INVALID_SOCKET;
@@ -63,6 +77,8 @@ private:
     std::chrono::steady_clock::time_point m_lastConnTime =
         std::chrono::steady_clock::now();
     std::chrono::seconds m_timeout;
+
+    ERR RecvExact(u8 *buf, usize size);
 };
 }  // namespace connector::tcp
 
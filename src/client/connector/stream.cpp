@@ -0,0 +1,51 @@
+#include "stream.hpp"
+
+#include "../../common/logging.hpp"
+#include "../../common/proto/proto.hpp"
+
+namespace connector {
+ResponseStream::ResponseStream(tcp::Context *ctx)
+    : m_ctx(ctx), m_done(ctx == nullptr) {}
+
+ResponseStream::ResponseStream(ResponseStream &&other) noexcept
+    : m_ctx(other.m_ctx), m_done(other.m_done) {
+    other.m_done = true;
+}
+
+ResponseStream::~ResponseStream() {
+    while (!m_done) {
+        ERR err;
+        NextFrame(&err);
+    }
+}
+
+proto::Response *ResponseStream::Next(ERR *err) {
+    proto::Message msg = NextFrame(err);
+    if (*err != ERR_Ok || !msg.buf()) {
+        return nullptr;
+    }
+
+    return proto::ParseResponse(&msg, err);
+}
+
+proto::Message ResponseStream::NextFrame(ERR *err) {
+    *err = ERR_Ok;
+    if (m_done) {
+        return {};
+    }
+
+    proto::Message msg = m_ctx->Receive(err);
+    if (*err != ERR_Ok) {
+        m_done = true;
+        return {};
+    }
+    m_done = !(msg.flags() & proto::MESSAGE_FLAG_CONTINUED);
+    if (!m_done) {
+        INFO("Response continues in the next frame");
+    }
+
+    return msg;
+}
+
+bool ResponseStream::Done() const { return m_done; }
+}  // namespace connector
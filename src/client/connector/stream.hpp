@@ -0,0 +1,36 @@
+#ifndef BSIT_3_STREAM_HPP
+#define BSIT_3_STREAM_HPP
+
+#include "../../common/errors.hpp"
+#include "../../common/proto/response.hpp"
+#include "context.hpp"
+
+namespace connector {
+// Frames of a (possibly chunked) response, consumed one at a time. Every
+// frame parses into a complete response holding a slice of the entries, so
+// a caller never needs the whole payload in memory. Frames left unread are
+// drained on destruction to keep the connection in sync.
+class ResponseStream {
+public:
+    explicit ResponseStream(tcp::Context *ctx);
+    ResponseStream(const ResponseStream &) = delete;
+    ResponseStream(ResponseStream &&other) noexcept;
+    ~ResponseStream();
+
+    // Receives and parses the next frame. Returns nullptr on error or once
+    // the last frame has been consumed.
+    proto::Response *Next(ERR *err);
+
+    // Receives the next frame without parsing it, for requests with the flat
+    // layout whose payload is read in place through flat::View.
+    proto::Message NextFrame(ERR *err);
+
+    [[nodiscard]] bool Done() const;
+
+private:
+    tcp::Context *m_ctx;
+    bool m_done;
+};
+}  // namespace connector
+
+#endif
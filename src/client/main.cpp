@@ -1,12 +1,23 @@
+#include "../common/logging.hpp"
+#include "../common/proto/handshake.hpp"
 #include "cli/cli.hpp"
 
 int main(int argc, char **argv) {
     std::string host;
     std::string port;
-    if (argc == 3) {
+    if (argc >= 3) {
         host.assign(argv[1]);
         port.assign(argv[2]);
     }
+    // Lowest protection to accept from servers: aead (default), mac or none.
+    // Only for links that are trusted or already encrypted.
+    if (argc >= 4) {
+        u32 levels = 0;
+        if (!proto::ParseSecurityLevel(argv[3], &levels)) {
+            WARN("Unknown security level %s, using aead", argv[3]);
+        }
+        proto::AllowSecurityLevels(levels);
+    }
     auto cli = cli::Cli(host, port);
     cli.run();
     return 0;
@@ -33,15 +33,15 @@ using i64 = int64_t;
 using ptr_diff = std::ptrdiff_t;
 using ptr_int = uintptr_t;
 
-inline auto operator""_KB(u64 const x) {
+inline auto operator""_KB(unsigned long long const x) {
     return static_cast<usize>(1024) * static_cast<usize>(x);
 }
 
-inline auto operator""_MB(u64 const x) {
+inline auto operator""_MB(unsigned long long const x) {
     return static_cast<usize>(1024 * 1024) * static_cast<usize>(x);
 }
 
-inline auto operator""_GB(u64 const x) {
+inline auto operator""_GB(unsigned long long const x) {
     return static_cast<usize>(1024 * 1024 * 1024) * static_cast<usize>(x);
 }
 
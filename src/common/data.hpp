@@ -2,14 +2,29 @@
 #define DATA_H
 
 #include "alias.hpp"
+#include "errors.hpp"
+#include <memory_resource>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <array>
 
-enum OSType : u8 { OS_WIN32, OS_WIN64, OS_WINARM, OS_WINARM64, OS_UNKNOWN };
+// Values are on the wire, new ones go at the end.
+enum OSType : u8 {
+    OS_WIN32,
+    OS_WIN64,
+    OS_WINARM,
+    OS_WINARM64,
+    OS_UNKNOWN,
+    OS_LINUX32,
+    OS_LINUX64,
+    OS_LINUXARM,
+    OS_LINUXARM64,
+};
 
 inline const char *OSTypeName[] = {
     "Windows x86", "Windows x64", "Windows ARM", "Windows ARM64", "Windows",
+    "Linux x86",   "Linux x64",   "Linux ARM",   "Linux ARM64",
 };
 
 struct OSVersion {
@@ -38,10 +53,34 @@ enum DriveType : u8 {
 inline const char *DriveTypeName[] = {"local", "network", "removable",
                                       "file system", "unknown"};
 
+// Set in the type byte on the wire if the drive did not answer in time and
+// the values are the last known ones.
+constexpr u8 DRIVE_FLAG_STALE = 0x80;
+
+// Allocator-aware, so the names in a std::pmr::vector<DriveInfo> come from
+// the same memory resource as the vector itself.
 struct DriveInfo {
-    DriveType type;
-    std::string name;
-    u64 free_bytes;
+    using allocator_type = std::pmr::polymorphic_allocator<>;
+
+    DriveType type = DRIVE_TYPE_UNKNOWN;
+    std::pmr::string name;
+    u64 free_bytes = 0;
+    bool stale = false;
+
+    DriveInfo() = default;
+    DriveInfo(DriveType type, std::string_view name, u64 free_bytes,
+              allocator_type alloc = {})
+        : type(type), name(name, alloc), free_bytes(free_bytes) {}
+    DriveInfo(const DriveInfo &other) = default;
+    DriveInfo(DriveInfo &&other) noexcept = default;
+    DriveInfo(const DriveInfo &other, allocator_type alloc)
+        : type(other.type), name(other.name, alloc),
+          free_bytes(other.free_bytes), stale(other.stale) {}
+    DriveInfo(DriveInfo &&other, allocator_type alloc)
+        : type(other.type), name(std::move(other.name), alloc),
+          free_bytes(other.free_bytes), stale(other.stale) {}
+    DriveInfo &operator=(const DriveInfo &other) = default;
+    DriveInfo &operator=(DriveInfo &&other) noexcept = default;
 };
 
 enum AceType : u8 {
@@ -64,7 +103,7 @@ struct AccessControlEntry {
 };
 
 struct AccessRightsInfo {
-    std::vector<AccessControlEntry> entries;
+    std::pmr::vector<AccessControlEntry> entries;
 };
 
 struct OwnerInfo {
@@ -73,4 +112,32 @@ struct OwnerInfo {
     std::array<u8, 32> sid;
 };
 
+// Result for one path of a bulk query. A path that could not be queried
+// carries its error and an empty info instead of failing the whole batch.
+struct PathRightsInfo {
+    std::string path;
+    ERR err = ERR_Ok;
+    AccessRightsInfo info;
+};
+
+// ACL shared by the paths of a bulk rights query. Ids number the ACLs of one
+// response stream, each is sent once.
+struct SharedAcl {
+    u32 id = 0;
+    AccessRightsInfo info;
+};
+
+// Path of a bulk rights query as sent, acl is the id of its SharedAcl.
+struct PathAclInfo {
+    std::string path;
+    ERR err = ERR_Ok;
+    u32 acl = 0;
+};
+
+struct PathOwnerInfo {
+    std::string path;
+    ERR err = ERR_Ok;
+    OwnerInfo info;
+};
+
 #endif
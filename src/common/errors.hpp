@@ -12,6 +12,7 @@ enum ERR : u8 {
     ERR_Invalid_Response,
     ERR_InvalidArgument,
     ERR_NotFound,
+    ERR_Path_not_found,
     ERR_Count_
 };
 
@@ -19,13 +20,16 @@ inline const char *errorText[ERR_Count_] = {
     "No error",         "Permission denied",
     "Unknown error",    "Connection refused by server",
     "Invalid response", "Invalid argument",
-    "Server not found",
+    "Server not found", "Path not found",
 };
 
 inline ERR winCodeToErr(int code) {
     switch (code) {
         case 0:
             return ERR_Ok;
+        case 2:
+        case 3:
+            return ERR_Path_not_found;
         case 13:
         case 5:
         case 22:
@@ -0,0 +1,11 @@
+#include "arena.hpp"
+
+namespace proto {
+Arena::Arena()
+    : m_inline(std::make_unique<std::byte[]>(INLINE_SIZE)),
+      m_resource(m_inline.get(), INLINE_SIZE) {}
+
+std::pmr::memory_resource *Arena::resource() { return &m_resource; }
+
+void Arena::reset() { m_resource.release(); }
+}  // namespace proto
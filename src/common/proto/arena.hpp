@@ -0,0 +1,41 @@
+#ifndef BSIT_3_ARENA_HPP
+#define BSIT_3_ARENA_HPP
+
+#include <memory>
+#include <memory_resource>
+#include <utility>
+
+#include "../alias.hpp"
+
+namespace proto {
+// Monotonic arena for everything allocated while serving one request: the
+// PackCtx buffers, the response object and its entry containers. Nothing is
+// freed individually, a single reset() releases it all and rewinds to the
+// inline block, which is sized so typical requests never reach the heap.
+class Arena {
+public:
+    static constexpr usize INLINE_SIZE = 16 * 1024;
+
+    Arena();
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    [[nodiscard]] std::pmr::memory_resource *resource();
+
+    // Constructs a T in the arena. The caller runs the destructor with
+    // std::destroy_at before the next reset(), the memory is never deleted.
+    template <typename T, typename... Args>
+    T *make(Args &&...args) {
+        void *mem = m_resource.allocate(sizeof(T), alignof(T));
+        return new (mem) T(std::forward<Args>(args)...);
+    }
+
+    void reset();
+
+private:
+    std::unique_ptr<std::byte[]> m_inline;
+    std::pmr::monotonic_buffer_resource m_resource;
+};
+}  // namespace proto
+
+#endif
@@ -0,0 +1,167 @@
+#include "compression.hpp"
+
+#include <cstring>
+
+namespace proto::compression {
+namespace {
+constexpr usize MIN_MATCH = 4;
+// The block always ends with literals and no match may start within the
+// last MF_LIMIT bytes, so the match finder can read 4 bytes unchecked.
+constexpr usize LAST_LITERALS = 5;
+constexpr usize MF_LIMIT = 12;
+constexpr usize MAX_OFFSET = u16_max;
+constexpr u32 HASH_BITS = 12;
+constexpr usize HEADER_SIZE = sizeof(u32);
+constexpr u8 RUN_MASK = 15;
+
+u32 Read32(const u8 *p) {
+    u32 v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+u32 Hash(u32 v) { return (v * 2654435761u) >> (32 - HASH_BITS); }
+
+u8 *WriteLength(u8 *op, usize len) {
+    while (len >= 255) {
+        *op++ = 255;
+        len -= 255;
+    }
+    *op++ = static_cast<u8>(len);
+    return op;
+}
+
+bool ReadLength(const u8 **ip, const u8 *end, usize *len) {
+    u8 b;
+    do {
+        if (*ip >= end) return false;
+        b = *(*ip)++;
+        *len += b;
+    } while (b == 255);
+    return true;
+}
+
+u8 *WriteSequence(u8 *op, const u8 *literals, usize lit_len) {
+    u8 *token = op++;
+    *token = static_cast<u8>(MIN(lit_len, RUN_MASK) << 4);
+    if (lit_len >= RUN_MASK) op = WriteLength(op, lit_len - RUN_MASK);
+    std::memcpy(op, literals, lit_len);
+    return op + lit_len;
+}
+}  // namespace
+
+usize CompressBound(usize size) {
+    return HEADER_SIZE + size + size / 255 + 16;
+}
+
+std::unique_ptr<const u8[]> Compress(const u8 *buf, usize size,
+                                     usize *res_size) {
+    auto res = std::make_unique<u8[]>(CompressBound(size));
+    u8 *op = res.get();
+    for (usize i = 0; i < HEADER_SIZE; i++) {
+        *op++ = static_cast<u8>(size >> (8 * i));
+    }
+
+    const u8 *ip = buf;
+    const u8 *anchor = buf;
+    const u8 *end = buf + size;
+
+    if (size > MF_LIMIT) {
+        u32 table[1 << HASH_BITS] = {};
+        const u8 *match_limit = end - MF_LIMIT;
+        const u8 *extend_limit = end - LAST_LITERALS;
+
+        while (ip < match_limit) {
+            u32 h = Hash(Read32(ip));
+            const u8 *ref = buf + table[h];
+            table[h] = static_cast<u32>(ip - buf);
+            if (ref >= ip || static_cast<usize>(ip - ref) > MAX_OFFSET ||
+                Read32(ref) != Read32(ip)) {
+                ip++;
+                continue;
+            }
+
+            usize len = MIN_MATCH;
+            while (ip + len < extend_limit && ref[len] == ip[len]) len++;
+
+            u8 *token = op;
+            op = WriteSequence(op, anchor, ip - anchor);
+            auto offset = static_cast<u16>(ip - ref);
+            *op++ = static_cast<u8>(offset);
+            *op++ = static_cast<u8>(offset >> 8);
+            usize match_len = len - MIN_MATCH;
+            *token |= static_cast<u8>(MIN(match_len, RUN_MASK));
+            if (match_len >= RUN_MASK) {
+                op = WriteLength(op, match_len - RUN_MASK);
+            }
+
+            ip += len;
+            anchor = ip;
+        }
+    }
+
+    op = WriteSequence(op, anchor, end - anchor);
+    *res_size = op - res.get();
+    return res;
+}
+
+std::unique_ptr<const u8[]> Decompress(const u8 *buf, usize size,
+                                       usize *res_size) {
+    if (size < HEADER_SIZE + 1) return nullptr;
+    usize raw_size = 0;
+    for (usize i = 0; i < HEADER_SIZE; i++) {
+        raw_size |= static_cast<usize>(buf[i]) << (8 * i);
+    }
+    // A single token byte can not expand into more than ~255 bytes, anything
+    // claiming a higher ratio is garbage and must not drive the allocation.
+    if (raw_size / 255 > size) return nullptr;
+
+    auto res = std::make_unique<u8[]>(raw_size);
+    u8 *op = res.get();
+    u8 *out_end = op + raw_size;
+    const u8 *ip = buf + HEADER_SIZE;
+    const u8 *end = buf + size;
+
+    while (ip < end) {
+        u8 token = *ip++;
+        usize lit_len = token >> 4;
+        if (lit_len == RUN_MASK && !ReadLength(&ip, end, &lit_len)) {
+            return nullptr;
+        }
+        if (lit_len > static_cast<usize>(end - ip) ||
+            lit_len > static_cast<usize>(out_end - op)) {
+            return nullptr;
+        }
+        std::memcpy(op, ip, lit_len);
+        op += lit_len;
+        ip += lit_len;
+        if (ip == end) break;
+
+        if (end - ip < 2) return nullptr;
+        usize offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > static_cast<usize>(op - res.get())) {
+            return nullptr;
+        }
+
+        usize match_len = token & RUN_MASK;
+        if (match_len == RUN_MASK && !ReadLength(&ip, end, &match_len)) {
+            return nullptr;
+        }
+        match_len += MIN_MATCH;
+        if (match_len > static_cast<usize>(out_end - op)) return nullptr;
+
+        // Byte by byte on purpose: offsets shorter than the match length
+        // replicate the preceding run.
+        const u8 *ref = op - offset;
+        for (usize i = 0; i < match_len; i++) {
+            op[i] = ref[i];
+        }
+        op += match_len;
+    }
+
+    if (op != out_end) return nullptr;
+    *res_size = raw_size;
+    return res;
+}
+}  // namespace proto::compression
@@ -0,0 +1,27 @@
+#ifndef BSIT_3_COMPRESSION_HPP
+#define BSIT_3_COMPRESSION_HPP
+
+#include <memory>
+
+#include "../../alias.hpp"
+
+namespace proto::compression {
+// Payloads smaller than this are never compressed, the block header and
+// sequence tokens would eat most of the gain.
+constexpr usize COMPRESSION_THRESHOLD = 256;
+
+// Worst case size of a compressed block for size bytes of input.
+usize CompressBound(usize size);
+
+// LZ77 block codec in the spirit of LZ4: a byte token holding literal and
+// match lengths, raw literals, 16-bit back references. The block starts with
+// the uncompressed size as a little-endian u32.
+std::unique_ptr<const u8[]> Compress(const u8 *buf, usize size,
+                                     usize *res_size);
+
+// Returns nullptr if the block is malformed.
+std::unique_ptr<const u8[]> Decompress(const u8 *buf, usize size,
+                                       usize *res_size);
+}  // namespace proto::compression
+
+#endif
@@ -0,0 +1,230 @@
+#include "capi.hpp"
+
+#include "../../logging.hpp"
+
+namespace proto::encryption {
+CapiSession::CapiSession(HCRYPTPROV provider, HCRYPTKEY key)
+    : m_provider(provider), m_key(key) {
+    PrintHash();
+}
+
+CapiSession::~CapiSession() { CryptDestroyKey(m_key); }
+
+ERR CapiSession::SetCipher(Cipher cipher) {
+    return cipher == CIPHER_AES_CBC ? ERR_Ok : ERR_InvalidArgument;
+}
+
+ERR CapiSession::Encrypt(u8 *buf, usize size, const u8 *aad, usize aad_size,
+                         usize *res_size) {
+    *res_size = 0;
+    auto len = static_cast<DWORD>(size);
+    if (!CryptEncrypt(m_key, 0, true, 0, buf, &len,
+                      static_cast<DWORD>(size + MAX_OVERHEAD))) {
+        PRINT_ERROR("CryptEncrypt", GetLastError());
+        return ERR_Unknown;
+    }
+    *res_size = len;
+    return ERR_Ok;
+}
+
+ERR CapiSession::Decrypt(u8 *buf, usize size, const u8 *aad, usize aad_size,
+                         usize *res_size) {
+    *res_size = 0;
+    auto len = static_cast<DWORD>(size);
+    if (!CryptDecrypt(m_key, 0, true, 0, buf, &len)) {
+        PRINT_ERROR("CryptDecrypt", GetLastError());
+        return ERR_InvalidArgument;
+    }
+    *res_size = len;
+    return ERR_Ok;
+}
+
+ERR CapiSession::Sign(u8 *buf, usize size, const u8 *aad, usize aad_size,
+                      usize *res_size) {
+    *res_size = 0;
+    return ERR_InvalidArgument;
+}
+
+ERR CapiSession::Verify(const u8 *buf, usize size, const u8 *aad,
+                        usize aad_size, usize *res_size) {
+    *res_size = 0;
+    return ERR_InvalidArgument;
+}
+
+void CapiSession::PrintHash() const {
+#ifdef BSIT_3_PRINT_KEY_HASH
+    HCRYPTKEY hKey = m_key;
+    DWORD blobLen = 0;
+
+    if (!CryptExportKey(hKey, 0, PLAINTEXTKEYBLOB, 0, NULL, &blobLen)) {
+        printf("Error in CryptExportKey: %d\n", GetLastError());
+        return;
+    }
+
+    BYTE *keyBlob = (BYTE *)malloc(blobLen);
+
+    if (!CryptExportKey(hKey, 0, PLAINTEXTKEYBLOB, 0, keyBlob, &blobLen)) {
+        printf("Error in CryptExportKey: %d\n", GetLastError());
+        free(keyBlob);
+        return;
+    }
+
+    HCRYPTHASH hHash;
+    if (!CryptCreateHash(m_provider, CALG_SHA_256, 0, 0, &hHash)) {
+        printf("Error in CryptCreateHash: %d\n", GetLastError());
+        free(keyBlob);
+        return;
+    }
+
+    if (!CryptHashData(hHash, keyBlob, blobLen, 0)) {
+        printf("Error in CryptHashData: %d\n", GetLastError());
+        CryptDestroyHash(hHash);
+        free(keyBlob);
+        return;
+    }
+
+    DWORD hashLen = 0;
+    DWORD hashLenSize = sizeof(DWORD);
+    if (!CryptGetHashParam(hHash, HP_HASHSIZE, (BYTE *)&hashLen, &hashLenSize,
+                           0)) {
+        printf("Error in CryptGetHashParam: %d\n", GetLastError());
+        CryptDestroyHash(hHash);
+        free(keyBlob);
+        return;
+    }
+
+    BYTE *hashValue = (BYTE *)malloc(hashLen);
+
+    if (!CryptGetHashParam(hHash, HP_HASHVAL, hashValue, &hashLen, 0)) {
+        printf("Error in CryptGetHashParam: %d\n", GetLastError());
+        CryptDestroyHash(hHash);
+        free(keyBlob);
+        free(hashValue);
+        return;
+    }
+
+    printf("Key Hash: ");
+    for (DWORD i = 0; i < hashLen; i++) {
+        printf("%02X", hashValue[i]);
+    }
+    printf("\n");
+
+    CryptDestroyHash(hHash);
+    free(keyBlob);
+    free(hashValue);
+#endif
+}
+
+CapiManager::CapiManager() {
+    CryptAcquireContext(&m_provider, nullptr, nullptr, PROV_RSA_AES,
+                        CRYPT_VERIFYCONTEXT);
+}
+
+CapiManager::~CapiManager() {
+    if (m_exchangeKey) {
+        CryptDestroyKey(m_exchangeKey);
+    }
+    CryptReleaseContext(m_provider, 0);
+}
+
+const char *CapiManager::Name() const { return "capi"; }
+
+void CapiManager::CreateAsymmetricKey() {
+    if (m_exchangeKey) {
+        CryptDestroyKey(m_exchangeKey);
+    }
+    CryptGenKey(m_provider, AT_KEYEXCHANGE, (2048 << 16) | CRYPT_EXPORTABLE,
+                &m_exchangeKey);
+}
+
+const u8 *CapiManager::ExportPublicKey(usize *size) {
+    DWORD len = 0;
+    CryptExportKey(m_exchangeKey, 0, PUBLICKEYBLOB, 0, nullptr, &len);
+    auto buf = new u8[len];
+    CryptExportKey(m_exchangeKey, 0, PUBLICKEYBLOB, 0, buf, &len);
+    *size = len;
+
+    return buf;
+}
+
+std::unique_ptr<Session> CapiManager::CreateSession() {
+    HCRYPTKEY key;
+    if (!CryptGenKey(m_provider, CALG_AES_256, CRYPT_EXPORTABLE, &key)) {
+        PRINT_ERROR("CryptGenKey", GetLastError());
+        return nullptr;
+    }
+    return std::make_unique<CapiSession>(m_provider, key);
+}
+
+const u8 *CapiManager::ExportSessionKey(const Session &session, usize *size,
+                                        const u8 *pub_key_buf,
+                                        usize pub_key_size) {
+    HCRYPTKEY key = static_cast<const CapiSession &>(session).m_key;
+    HCRYPTKEY pub_key;
+    CryptImportKey(m_provider, pub_key_buf, static_cast<DWORD>(pub_key_size), 0,
+                   0, &pub_key);
+    DWORD len = 0;
+    CryptExportKey(key, pub_key, SIMPLEBLOB, 0, nullptr, &len);
+    auto buf = new u8[len];
+    CryptExportKey(key, pub_key, SIMPLEBLOB, 0, buf, &len);
+    *size = len;
+
+    CryptDestroyKey(pub_key);
+
+    return buf;
+}
+
+std::unique_ptr<Session> CapiManager::ImportSession(const u8 *buf,
+                                                    usize size) {
+    HCRYPTKEY key;
+    if (!CryptImportKey(m_provider, buf, static_cast<DWORD>(size),
+                        m_exchangeKey, CRYPT_EXPORTABLE, &key)) {
+        PRINT_ERROR("CryptImportKey", GetLastError());
+        return nullptr;
+    }
+    return std::make_unique<CapiSession>(m_provider, key);
+}
+
+bool CapiManager::SupportsKeyAgreement() const { return false; }
+
+std::unique_ptr<KeyShare> CapiManager::CreateKeyShare() { return nullptr; }
+
+std::unique_ptr<Session> CapiManager::AgreeSession(const KeyShare &share,
+                                                   const u8 *peer_key,
+                                                   usize peer_key_size,
+                                                   bool local) {
+    return nullptr;
+}
+
+bool CapiManager::SupportsTickets() const { return false; }
+
+const u8 *CapiManager::IssueTicket(const Session &session, usize *size) {
+    *size = 0;
+    return nullptr;
+}
+
+ERR CapiManager::ExportResumptionSecret(const Session &session, u8 *secret) {
+    return ERR_InvalidArgument;
+}
+
+std::unique_ptr<Session> CapiManager::ResumeFromTicket(
+    const u8 *ticket, usize size, const u8 *client_random,
+    const u8 *server_random) {
+    return nullptr;
+}
+
+std::unique_ptr<Session> CapiManager::ResumeFromSecret(
+    const u8 *secret, const u8 *client_random, const u8 *server_random) {
+    return nullptr;
+}
+
+void CapiManager::Random(u8 *buf, usize size) {
+    if (!CryptGenRandom(m_provider, static_cast<DWORD>(size), buf)) {
+        PRINT_ERROR("CryptGenRandom", GetLastError());
+    }
+}
+
+bool CapiManager::Supports(Cipher cipher) const {
+    return cipher == CIPHER_AES_CBC;
+}
+}  // namespace proto::encryption
@@ -0,0 +1,89 @@
+#ifndef BSIT_3_CAPI_HPP
+#define BSIT_3_CAPI_HPP
+
+#include <windows.h>
+#include <wincrypt.h>
+
+#include "encryption.hpp"
+
+namespace proto::encryption {
+// CryptoAPI has no AEAD modes, so sessions stay on CIPHER_AES_CBC and peers
+// fall back to it.
+class CapiSession : public Session {
+public:
+    // Takes ownership of key, provider is borrowed from the manager.
+    CapiSession(HCRYPTPROV provider, HCRYPTKEY key);
+    ~CapiSession() override;
+
+    CapiSession(const CapiSession &) = delete;
+    CapiSession &operator=(const CapiSession &) = delete;
+
+    ERR SetCipher(Cipher cipher) override;
+
+    ERR Encrypt(u8 *buf, usize size, const u8 *aad, usize aad_size,
+                usize *res_size) override;
+    ERR Decrypt(u8 *buf, usize size, const u8 *aad, usize aad_size,
+                usize *res_size) override;
+
+    ERR Sign(u8 *buf, usize size, const u8 *aad, usize aad_size,
+             usize *res_size) override;
+    ERR Verify(const u8 *buf, usize size, const u8 *aad, usize aad_size,
+               usize *res_size) override;
+
+    void PrintHash() const override;
+
+private:
+    friend class CapiManager;
+
+    HCRYPTPROV m_provider;
+    HCRYPTKEY m_key;
+};
+
+// Windows CryptoAPI backend.
+class CapiManager : public EncryptionManager {
+public:
+    CapiManager();
+    ~CapiManager() override;
+
+    const char *Name() const override;
+
+    void CreateAsymmetricKey() override;
+    const u8 *ExportPublicKey(usize *size) override;
+
+    std::unique_ptr<Session> CreateSession() override;
+    const u8 *ExportSessionKey(const Session &session, usize *size,
+                               const u8 *pub_key_buf,
+                               usize pub_key_size) override;
+    std::unique_ptr<Session> ImportSession(const u8 *buf, usize size) override;
+
+    // CryptoAPI has no Curve25519, peers fall back to the RSA exchange.
+    bool SupportsKeyAgreement() const override;
+    std::unique_ptr<KeyShare> CreateKeyShare() override;
+    std::unique_ptr<Session> AgreeSession(const KeyShare &share,
+                                          const u8 *peer_key,
+                                          usize peer_key_size,
+                                          bool local) override;
+
+    // CryptoAPI has no key derivation to build resumed sessions on, so no
+    // tickets are issued and clients always run the key exchange.
+    bool SupportsTickets() const override;
+    const u8 *IssueTicket(const Session &session, usize *size) override;
+    ERR ExportResumptionSecret(const Session &session, u8 *secret) override;
+    std::unique_ptr<Session> ResumeFromTicket(
+        const u8 *ticket, usize size, const u8 *client_random,
+        const u8 *server_random) override;
+    std::unique_ptr<Session> ResumeFromSecret(
+        const u8 *secret, const u8 *client_random,
+        const u8 *server_random) override;
+
+    void Random(u8 *buf, usize size) override;
+
+    bool Supports(Cipher cipher) const override;
+
+private:
+    HCRYPTPROV m_provider = 0;
+    HCRYPTKEY m_exchangeKey = 0;
+};
+}  // namespace proto::encryption
+
+#endif
@@ -1,36 +1,156 @@
 #ifndef BSIT_3_ENCRYPTION_HPP
 #define BSIT_3_ENCRYPTION_HPP
 
-#include <windows.h>
-#include <wincrypt.h>
-
-#include <unordered_map>
 #include <memory>
 
 #include "../../alias.hpp"
+#include "../../errors.hpp"
 
 namespace proto::encryption {
+// Upper bound of what Encrypt adds to a plaintext (one AES block of padding
+// or an AEAD tag).
+constexpr usize MAX_OVERHEAD = 16;
+
+// Sizes of the secret a client keeps along with its session ticket and of
+// the randoms both sides contribute to a resumed session.
+constexpr usize RESUMPTION_SECRET_SIZE = 32;
+constexpr usize RESUMPTION_RANDOM_SIZE = 32;
+
+constexpr usize X25519_KEY_SIZE = 32;
+
+enum Cipher : u8 {
+    // Default after the key exchange, see Session.
+    CIPHER_AES_CBC,
+    CIPHER_AES_GCM,
+    CIPHER_CHACHA20_POLY1305,
+};
+
+// Cipher state of one connection. It is owned by the connection (the server
+// Client slot or the client tcp::Context) and only touched by whoever serves
+// it, so no locking is needed.
+//
+// Messages start out as AES-256-CBC with a zero IV and PKCS#7 padding. Peers
+// that agree on an AEAD cipher switch to it with SetCipher. Each direction
+// then gets its own key and nonce base, derived from the session key with
+// HKDF-SHA256, and the nonce of a message is its implicit sequence number in
+// that direction. Both sides therefore have to encrypt and decrypt every
+// message exactly once and in order; a reordered, replayed or modified
+// message fails to decrypt.
+class Session {
+public:
+    virtual ~Session() = default;
+
+    // Switches to cipher. The side that created the session key (the
+    // server) and the side that imported it pick opposite directions.
+    virtual ERR SetCipher(Cipher cipher) = 0;
+
+    // Encrypts size bytes of buf in place, buf must have MAX_OVERHEAD bytes
+    // of room after them. Sets *res_size to the size of the ciphertext. aad
+    // is authenticated along with the message by AEAD ciphers.
+    virtual ERR Encrypt(u8 *buf, usize size, const u8 *aad, usize aad_size,
+                        usize *res_size) = 0;
+    // Decrypts size bytes of buf in place and sets *res_size to the size of
+    // the plaintext.
+    virtual ERR Decrypt(u8 *buf, usize size, const u8 *aad, usize aad_size,
+                        usize *res_size) = 0;
+
+    // Integrity-only protection: the AEAD cipher is run with the whole
+    // message as associated data, which leaves GMAC or Poly1305. Sign
+    // appends the tag after size bytes of buf (MAX_OVERHEAD bytes of room
+    // needed), Verify checks it and sets *res_size to the size without it.
+    // Both use the sequence numbers of Encrypt and Decrypt and fail while the
+    // session is still on CIPHER_AES_CBC.
+    virtual ERR Sign(u8 *buf, usize size, const u8 *aad, usize aad_size,
+                     usize *res_size) = 0;
+    virtual ERR Verify(const u8 *buf, usize size, const u8 *aad,
+                       usize aad_size, usize *res_size) = 0;
+
+    // Prints a SHA-256 of the session key.
+    virtual void PrintHash() const = 0;
+};
+
+// Ephemeral X25519 key pair of one handshake, see
+// EncryptionManager::AgreeSession.
+class KeyShare {
+public:
+    virtual ~KeyShare() = default;
+
+    // Raw public key, X25519_KEY_SIZE bytes.
+    virtual const u8 *PublicKey() const = 0;
+};
+
+// Key exchange. Peers that agree on FEATURE_X25519 derive the session key
+// from an ephemeral ECDH exchange. Otherwise the wire format is the one of
+// CryptoAPI: the public key is an RSA-2048 PUBLICKEYBLOB and the session key
+// an AES-256 SIMPLEBLOB. The asymmetric key is the only state kept here, it
+// is created once and then only read, so sessions can be created and
+// imported from any thread.
+//
+// The implementation is chosen at build time (BSIT_3_CRYPTO in CMake), see
+// capi.hpp and openssl.hpp. Key hashes are printed when a session is created
+// or imported if BSIT_3_PRINT_KEY_HASH is on.
 class EncryptionManager {
 public:
-    EncryptionManager();
-    ~EncryptionManager();
+    virtual ~EncryptionManager() = default;
+
+    // Name of the backend, for logs and benchmarks.
+    virtual const char *Name() const = 0;
+
+    virtual void CreateAsymmetricKey() = 0;
+    virtual const u8 *ExportPublicKey(usize *size) = 0;
 
-    void CreateAsymmetricKey();
-    void CreateSymmetricKey(u32 cid);
+    // New session with a random key, used by the server.
+    virtual std::unique_ptr<Session> CreateSession() = 0;
+    // Key of session encrypted for the peer's public key.
+    virtual const u8 *ExportSessionKey(const Session &session, usize *size,
+                                       const u8 *pub_key_buf,
+                                       usize pub_key_size) = 0;
+    // Session from a key exported for our public key, nullptr if it cannot
+    // be decrypted. Used by the client.
+    virtual std::unique_ptr<Session> ImportSession(const u8 *buf,
+                                                   usize size) = 0;
 
-    const u8 *ExportPublicKey(DWORD *size);
-    const u8 *ExportSymmetricKey(u32 cid, DWORD *size, const u8 *pub_key_buf,
-                                 DWORD pub_key_size);
+    // X25519 key agreement. Each side creates a key share, sends its public
+    // key and builds the session from the peer's one. The session key is
+    // derived with HKDF-SHA256 from the shared secret and both public keys.
+    // local is set on the server. Returns nullptr if peer_key is not a valid
+    // public key.
+    virtual bool SupportsKeyAgreement() const = 0;
+    virtual std::unique_ptr<KeyShare> CreateKeyShare() = 0;
+    virtual std::unique_ptr<Session> AgreeSession(const KeyShare &share,
+                                                  const u8 *peer_key,
+                                                  usize peer_key_size,
+                                                  bool local) = 0;
 
-    void ImportSymmetricKey(u32 cid, const u8 *buf, usize size);
-    std::unique_ptr<const u8[]> Encrypt(u32 cid, const u8 *buf, usize size, DWORD *res_size);
-    std::unique_ptr<const u8[]> Decrypt(u32 cid, const u8 *buf, usize size, DWORD *res_size);
+    // Session resumption, see proto::ResumeRequest. A ticket carries the
+    // resumption secret of a session, encrypted with a key that never leaves
+    // the server process, so the server keeps nothing per client and a
+    // restart invalidates every ticket. A resumed session gets a fresh key
+    // derived from the secret and the randoms of both sides, without any
+    // asymmetric operation.
+    virtual bool SupportsTickets() const = 0;
+    // Ticket for session, nullptr if tickets are not supported. Server side.
+    virtual const u8 *IssueTicket(const Session &session, usize *size) = 0;
+    // Copies the resumption secret of session, which is what the server
+    // sealed in its ticket, to secret. Client side.
+    virtual ERR ExportResumptionSecret(const Session &session,
+                                       u8 *secret) = 0;
+    // Server side of a resumption, nullptr if the ticket was not issued by
+    // this process or has expired.
+    virtual std::unique_ptr<Session> ResumeFromTicket(
+        const u8 *ticket, usize size, const u8 *client_random,
+        const u8 *server_random) = 0;
+    // Client side of a resumption.
+    virtual std::unique_ptr<Session> ResumeFromSecret(
+        const u8 *secret, const u8 *client_random,
+        const u8 *server_random) = 0;
 
-    void PrintHash(HCRYPTKEY hKey) const;
+    // Fills buf with size bytes from the backend's secure generator.
+    virtual void Random(u8 *buf, usize size) = 0;
 
-private:
-    std::unordered_map<u32, HCRYPTKEY> m_keys;
-    HCRYPTPROV m_provider = 0;
+    // Whether cipher can be used by this backend on this host. AES-GCM is
+    // only reported with hardware AES, ChaCha20-Poly1305 is faster otherwise.
+    virtual bool Supports(Cipher cipher) const = 0;
 };
 
 void init();
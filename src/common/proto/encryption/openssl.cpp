@@ -0,0 +1,703 @@
+#include "openssl.hpp"
+
+#include <openssl/bn.h>
+#include <openssl/core_names.h>
+#include <openssl/evp.h>
+#include <openssl/kdf.h>
+#include <openssl/param_build.h>
+#include <openssl/rand.h>
+#include <openssl/rsa.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#endif
+
+#include "../../logging.hpp"
+
+namespace proto::encryption {
+namespace {
+// CryptoAPI blob constants, see PUBLICKEYSTRUC and RSAPUBKEY.
+constexpr u8 SIMPLEBLOB_TYPE = 0x01;
+constexpr u8 PUBLICKEYBLOB_TYPE = 0x06;
+constexpr u8 PLAINTEXTKEYBLOB_TYPE = 0x08;
+constexpr u8 BLOB_VERSION = 2;
+constexpr u32 ALG_RSA_KEYX = 0xa400;
+constexpr u32 ALG_AES_256 = 0x6610;
+constexpr u32 RSA1_MAGIC = 0x31415352;
+constexpr u32 RSA_BITS = 2048;
+constexpr u32 RSA_EXPONENT = 65537;
+
+constexpr usize BLOB_HEADER_SIZE = 8;
+constexpr usize RSA_PUBKEY_SIZE = 12;
+constexpr usize MODULUS_SIZE = RSA_BITS / 8;
+constexpr usize PUBLIC_BLOB_SIZE =
+    BLOB_HEADER_SIZE + RSA_PUBKEY_SIZE + MODULUS_SIZE;
+constexpr usize SIMPLE_BLOB_SIZE = BLOB_HEADER_SIZE + 4 + MODULUS_SIZE;
+
+constexpr u8 ZERO_IV[16] = {};
+
+constexpr usize TAG_SIZE = 16;
+static_assert(TAG_SIZE <= MAX_OVERHEAD);
+
+// HKDF labels, the side that created the session key is the server.
+constexpr const char *SERVER_WRITE_LABEL = "bsit3 server write";
+constexpr const char *CLIENT_WRITE_LABEL = "bsit3 client write";
+constexpr const char *RESUMPTION_LABEL = "bsit3 resumption";
+constexpr const char *RESUMED_KEY_LABEL = "bsit3 resumed key";
+constexpr const char *X25519_LABEL = "bsit3 x25519";
+
+// Ticket: version | nonce | issue time | resumption secret | tag. Everything
+// after the nonce is encrypted with AES-256-GCM under the ticket key, the
+// version and nonce are authenticated along with it.
+constexpr u8 TICKET_VERSION = 1;
+constexpr usize TICKET_HEADER_SIZE = 1 + NONCE_SIZE;
+constexpr usize TICKET_PLAIN_SIZE = sizeof(u64) + RESUMPTION_SECRET_SIZE;
+constexpr usize TICKET_SIZE =
+    TICKET_HEADER_SIZE + TICKET_PLAIN_SIZE + TAG_SIZE;
+// Each resumption issues a new ticket, so this only bounds how long a client
+// may stay away.
+constexpr u64 TICKET_LIFETIME_S = 60 * 60;
+
+// AES-NI and carry-less multiply, which GCM needs to be fast.
+bool HasAesHardware() {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    static const bool has =
+        __builtin_cpu_supports("aes") && __builtin_cpu_supports("pclmul");
+    return has;
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    int regs[4];
+    __cpuid(regs, 1);
+    return (regs[2] & (1 << 25)) && (regs[2] & (1 << 1));
+#elif defined(__ARM_FEATURE_CRYPTO)
+    return true;
+#else
+    return false;
+#endif
+}
+
+// Nonce of message seq: the big-endian sequence number xor-ed into the low
+// bytes of the nonce base, as in TLS 1.3.
+void MakeNonce(const u8 *iv, u64 seq, u8 *nonce) {
+    std::memcpy(nonce, iv, NONCE_SIZE);
+    for (usize i = 0; i < sizeof(seq); i++) {
+        nonce[NONCE_SIZE - 1 - i] ^= static_cast<u8>(seq >> (8 * i));
+    }
+}
+
+// HKDF-SHA256 of key into out_size bytes of out. salt may be empty.
+bool Hkdf(const u8 *key, usize key_size, const u8 *salt, usize salt_size,
+          const char *label, u8 *out, usize out_size) {
+    EVP_KDF *kdf = EVP_KDF_fetch(nullptr, "HKDF", nullptr);
+    EVP_KDF_CTX *kctx = EVP_KDF_CTX_new(kdf);
+    EVP_KDF_free(kdf);
+    OSSL_PARAM params[5];
+    OSSL_PARAM *p = params;
+    *p++ = OSSL_PARAM_construct_utf8_string(OSSL_KDF_PARAM_DIGEST,
+                                            const_cast<char *>("SHA256"), 0);
+    *p++ = OSSL_PARAM_construct_octet_string(
+        OSSL_KDF_PARAM_KEY, const_cast<u8 *>(key), key_size);
+    if (salt_size) {
+        *p++ = OSSL_PARAM_construct_octet_string(
+            OSSL_KDF_PARAM_SALT, const_cast<u8 *>(salt), salt_size);
+    }
+    *p++ = OSSL_PARAM_construct_octet_string(
+        OSSL_KDF_PARAM_INFO, const_cast<char *>(label), std::strlen(label));
+    *p = OSSL_PARAM_construct_end();
+    bool ok = EVP_KDF_derive(kctx, out, out_size, params) > 0;
+    EVP_KDF_CTX_free(kctx);
+    return ok;
+}
+
+u64 UnixSeconds() {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+void PutLe64(u8 *buf, u64 val) {
+    for (usize i = 0; i < 8; i++) {
+        buf[i] = static_cast<u8>(val >> (8 * i));
+    }
+}
+
+u64 GetLe64(const u8 *buf) {
+    u64 val = 0;
+    for (usize i = 0; i < 8; i++) {
+        val |= static_cast<u64>(buf[i]) << (8 * i);
+    }
+    return val;
+}
+
+void PutLe32(u8 *buf, u32 val) {
+    for (usize i = 0; i < 4; i++) {
+        buf[i] = static_cast<u8>(val >> (8 * i));
+    }
+}
+
+u32 GetLe32(const u8 *buf) {
+    u32 val = 0;
+    for (usize i = 0; i < 4; i++) {
+        val |= static_cast<u32>(buf[i]) << (8 * i);
+    }
+    return val;
+}
+
+void PutBlobHeader(u8 *buf, u8 type, u32 alg) {
+    buf[0] = type;
+    buf[1] = BLOB_VERSION;
+    buf[2] = 0;
+    buf[3] = 0;
+    PutLe32(buf + 4, alg);
+}
+
+bool CheckBlobHeader(const u8 *buf, usize size, u8 type, u32 alg) {
+    return size >= BLOB_HEADER_SIZE && buf[0] == type &&
+           buf[1] == BLOB_VERSION && GetLe32(buf + 4) == alg;
+}
+
+// Builds an RSA public key from a PUBLICKEYBLOB, nullptr if it is malformed.
+EVP_PKEY *ImportPublicKey(const u8 *buf, usize size) {
+    if (size != PUBLIC_BLOB_SIZE ||
+        !CheckBlobHeader(buf, size, PUBLICKEYBLOB_TYPE, ALG_RSA_KEYX) ||
+        GetLe32(buf + BLOB_HEADER_SIZE) != RSA1_MAGIC ||
+        GetLe32(buf + BLOB_HEADER_SIZE + 4) != RSA_BITS) {
+        WARN("Malformed public key blob");
+        return nullptr;
+    }
+    BIGNUM *n = BN_lebin2bn(buf + BLOB_HEADER_SIZE + RSA_PUBKEY_SIZE,
+                            MODULUS_SIZE, nullptr);
+    BIGNUM *e = BN_new();
+    BN_set_word(e, GetLe32(buf + BLOB_HEADER_SIZE + 8));
+
+    OSSL_PARAM_BLD *bld = OSSL_PARAM_BLD_new();
+    OSSL_PARAM_BLD_push_BN(bld, OSSL_PKEY_PARAM_RSA_N, n);
+    OSSL_PARAM_BLD_push_BN(bld, OSSL_PKEY_PARAM_RSA_E, e);
+    OSSL_PARAM *params = OSSL_PARAM_BLD_to_param(bld);
+
+    EVP_PKEY *key = nullptr;
+    EVP_PKEY_CTX *ctx = EVP_PKEY_CTX_new_from_name(nullptr, "RSA", nullptr);
+    if (EVP_PKEY_fromdata_init(ctx) <= 0 ||
+        EVP_PKEY_fromdata(ctx, &key, EVP_PKEY_PUBLIC_KEY, params) <= 0) {
+        WARN("Failed to import public key");
+    }
+
+    EVP_PKEY_CTX_free(ctx);
+    OSSL_PARAM_free(params);
+    OSSL_PARAM_BLD_free(bld);
+    BN_free(e);
+    BN_free(n);
+    return key;
+}
+
+// Session keyed from a resumption secret and the randoms of both sides. local
+// is set on the server, as for a session it created itself.
+std::unique_ptr<Session> Resume(const u8 *secret, const u8 *client_random,
+                                const u8 *server_random, bool local) {
+    u8 salt[2 * RESUMPTION_RANDOM_SIZE];
+    std::memcpy(salt, client_random, RESUMPTION_RANDOM_SIZE);
+    std::memcpy(salt + RESUMPTION_RANDOM_SIZE, server_random,
+                RESUMPTION_RANDOM_SIZE);
+    u8 key[AES_KEY_SIZE];
+    std::unique_ptr<Session> session;
+    if (!Hkdf(secret, RESUMPTION_SECRET_SIZE, salt, sizeof(salt),
+              RESUMED_KEY_LABEL, key, sizeof(key))) {
+        WARN("Failed to derive resumed session key");
+    } else {
+        session = std::make_unique<OpenSslSession>(key, local);
+    }
+    OPENSSL_cleanse(key, sizeof(key));
+    return session;
+}
+}  // namespace
+
+OpenSslSession::OpenSslSession(const u8 *key, bool local) : m_local(local) {
+    std::memcpy(m_key.data(), key, AES_KEY_SIZE);
+    m_send.ctx = EVP_CIPHER_CTX_new();
+    m_recv.ctx = EVP_CIPHER_CTX_new();
+    EVP_EncryptInit_ex(m_send.ctx, EVP_aes_256_cbc(), nullptr, key, ZERO_IV);
+    EVP_DecryptInit_ex(m_recv.ctx, EVP_aes_256_cbc(), nullptr, key, ZERO_IV);
+    PrintHash();
+}
+
+OpenSslSession::~OpenSslSession() {
+    EVP_CIPHER_CTX_free(m_send.ctx);
+    EVP_CIPHER_CTX_free(m_recv.ctx);
+    OPENSSL_cleanse(m_key.data(), m_key.size());
+}
+
+bool OpenSslSession::InitDirection(Direction *dir, const EVP_CIPHER *cipher,
+                                   const char *label, bool encrypt) const {
+    u8 out[AES_KEY_SIZE + NONCE_SIZE];
+    bool ok = Hkdf(m_key.data(), m_key.size(), nullptr, 0, label, out,
+                   sizeof(out));
+    ok = ok && EVP_CIPHER_CTX_reset(dir->ctx) &&
+         EVP_CipherInit_ex(dir->ctx, cipher, nullptr, out, nullptr, encrypt);
+    std::memcpy(dir->iv.data(), out + AES_KEY_SIZE, NONCE_SIZE);
+    dir->seq = 0;
+    OPENSSL_cleanse(out, sizeof(out));
+    return ok;
+}
+
+ERR OpenSslSession::SetCipher(Cipher cipher) {
+    if (m_cipher == cipher) {
+        return ERR_Ok;
+    }
+    // Sequence numbers restart with the new keys, which is only safe once.
+    if (m_cipher != CIPHER_AES_CBC ||
+        (cipher == CIPHER_AES_GCM && !HasAesHardware())) {
+        return ERR_InvalidArgument;
+    }
+
+    const EVP_CIPHER *evp = cipher == CIPHER_AES_GCM
+                                ? EVP_aes_256_gcm()
+                                : EVP_chacha20_poly1305();
+    const char *send_label = m_local ? SERVER_WRITE_LABEL : CLIENT_WRITE_LABEL;
+    const char *recv_label = m_local ? CLIENT_WRITE_LABEL : SERVER_WRITE_LABEL;
+    if (!InitDirection(&m_send, evp, send_label, true) ||
+        !InitDirection(&m_recv, evp, recv_label, false)) {
+        WARN("Failed to derive session keys");
+        return ERR_Unknown;
+    }
+    m_cipher = cipher;
+    return ERR_Ok;
+}
+
+ERR OpenSslSession::Encrypt(u8 *buf, usize size, const u8 *aad,
+                            usize aad_size, usize *res_size) {
+    *res_size = 0;
+    EVP_CIPHER_CTX *ctx = m_send.ctx;
+    int len = 0;
+    int final_len = 0;
+    if (m_cipher == CIPHER_AES_CBC) {
+        if (!EVP_EncryptInit_ex(ctx, nullptr, nullptr, nullptr, ZERO_IV) ||
+            !EVP_EncryptUpdate(ctx, buf, &len, buf, static_cast<int>(size)) ||
+            !EVP_EncryptFinal_ex(ctx, buf + len, &final_len)) {
+            WARN("Encryption failed");
+            return ERR_Unknown;
+        }
+        *res_size = len + final_len;
+        return ERR_Ok;
+    }
+
+    u8 nonce[NONCE_SIZE];
+    MakeNonce(m_send.iv.data(), m_send.seq, nonce);
+    int aad_len = 0;
+    if (!EVP_EncryptInit_ex(ctx, nullptr, nullptr, nullptr, nonce) ||
+        (aad_size && !EVP_EncryptUpdate(ctx, nullptr, &aad_len, aad,
+                                        static_cast<int>(aad_size))) ||
+        !EVP_EncryptUpdate(ctx, buf, &len, buf, static_cast<int>(size)) ||
+        !EVP_EncryptFinal_ex(ctx, buf + len, &final_len) ||
+        !EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_GET_TAG, TAG_SIZE,
+                             buf + len + final_len)) {
+        WARN("Encryption failed");
+        return ERR_Unknown;
+    }
+    m_send.seq++;
+    *res_size = len + final_len + TAG_SIZE;
+    return ERR_Ok;
+}
+
+ERR OpenSslSession::Decrypt(u8 *buf, usize size, const u8 *aad,
+                            usize aad_size, usize *res_size) {
+    *res_size = 0;
+    EVP_CIPHER_CTX *ctx = m_recv.ctx;
+    int len = 0;
+    int final_len = 0;
+    if (m_cipher == CIPHER_AES_CBC) {
+        if (!EVP_DecryptInit_ex(ctx, nullptr, nullptr, nullptr, ZERO_IV) ||
+            !EVP_DecryptUpdate(ctx, buf, &len, buf, static_cast<int>(size)) ||
+            !EVP_DecryptFinal_ex(ctx, buf + len, &final_len)) {
+            WARN("Decryption failed");
+            return ERR_InvalidArgument;
+        }
+        *res_size = len + final_len;
+        return ERR_Ok;
+    }
+
+    if (size < TAG_SIZE) {
+        WARN("Message shorter than its tag");
+        return ERR_InvalidArgument;
+    }
+    usize content_size = size - TAG_SIZE;
+    u8 nonce[NONCE_SIZE];
+    MakeNonce(m_recv.iv.data(), m_recv.seq, nonce);
+    int aad_len = 0;
+    if (!EVP_DecryptInit_ex(ctx, nullptr, nullptr, nullptr, nonce) ||
+        (aad_size && !EVP_DecryptUpdate(ctx, nullptr, &aad_len, aad,
+                                        static_cast<int>(aad_size))) ||
+        !EVP_DecryptUpdate(ctx, buf, &len, buf,
+                           static_cast<int>(content_size)) ||
+        !EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_SET_TAG, TAG_SIZE,
+                             buf + content_size) ||
+        EVP_DecryptFinal_ex(ctx, buf + len, &final_len) <= 0) {
+        WARN("Message failed authentication");
+        return ERR_InvalidArgument;
+    }
+    m_recv.seq++;
+    *res_size = len + final_len;
+    return ERR_Ok;
+}
+
+ERR OpenSslSession::Sign(u8 *buf, usize size, const u8 *aad, usize aad_size,
+                         usize *res_size) {
+    *res_size = 0;
+    if (m_cipher == CIPHER_AES_CBC) {
+        return ERR_InvalidArgument;
+    }
+    EVP_CIPHER_CTX *ctx = m_send.ctx;
+    u8 nonce[NONCE_SIZE];
+    MakeNonce(m_send.iv.data(), m_send.seq, nonce);
+    int len = 0;
+    if (!EVP_EncryptInit_ex(ctx, nullptr, nullptr, nullptr, nonce) ||
+        (aad_size && !EVP_EncryptUpdate(ctx, nullptr, &len, aad,
+                                        static_cast<int>(aad_size))) ||
+        (size && !EVP_EncryptUpdate(ctx, nullptr, &len, buf,
+                                    static_cast<int>(size))) ||
+        !EVP_EncryptFinal_ex(ctx, buf + size, &len) ||
+        !EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_GET_TAG, TAG_SIZE,
+                             buf + size)) {
+        WARN("Signing failed");
+        return ERR_Unknown;
+    }
+    m_send.seq++;
+    *res_size = size + TAG_SIZE;
+    return ERR_Ok;
+}
+
+ERR OpenSslSession::Verify(const u8 *buf, usize size, const u8 *aad,
+                           usize aad_size, usize *res_size) {
+    *res_size = 0;
+    if (m_cipher == CIPHER_AES_CBC || size < TAG_SIZE) {
+        WARN("Message cannot be verified");
+        return ERR_InvalidArgument;
+    }
+    usize content_size = size - TAG_SIZE;
+    EVP_CIPHER_CTX *ctx = m_recv.ctx;
+    u8 nonce[NONCE_SIZE];
+    MakeNonce(m_recv.iv.data(), m_recv.seq, nonce);
+    u8 tag[TAG_SIZE];
+    std::memcpy(tag, buf + content_size, TAG_SIZE);
+    u8 none[1];
+    int len = 0;
+    if (!EVP_DecryptInit_ex(ctx, nullptr, nullptr, nullptr, nonce) ||
+        (aad_size && !EVP_DecryptUpdate(ctx, nullptr, &len, aad,
+                                        static_cast<int>(aad_size))) ||
+        (content_size &&
+         !EVP_DecryptUpdate(ctx, nullptr, &len, buf,
+                            static_cast<int>(content_size))) ||
+        !EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_SET_TAG, TAG_SIZE, tag) ||
+        EVP_DecryptFinal_ex(ctx, none, &len) <= 0) {
+        WARN("Message failed authentication");
+        return ERR_InvalidArgument;
+    }
+    m_recv.seq++;
+    *res_size = content_size;
+    return ERR_Ok;
+}
+
+void OpenSslSession::PrintHash() const {
+#ifdef BSIT_3_PRINT_KEY_HASH
+    // Hash the PLAINTEXTKEYBLOB like CapiSession does, so both sides of a
+    // mixed connection print the same value.
+    u8 blob[BLOB_HEADER_SIZE + 4 + AES_KEY_SIZE];
+    PutBlobHeader(blob, PLAINTEXTKEYBLOB_TYPE, ALG_AES_256);
+    PutLe32(blob + BLOB_HEADER_SIZE, AES_KEY_SIZE);
+    std::memcpy(blob + BLOB_HEADER_SIZE + 4, m_key.data(), AES_KEY_SIZE);
+
+    u8 hash[EVP_MAX_MD_SIZE];
+    unsigned int hash_len = 0;
+    EVP_Digest(blob, sizeof(blob), hash, &hash_len, EVP_sha256(), nullptr);
+    OPENSSL_cleanse(blob, sizeof(blob));
+
+    printf("Key Hash: ");
+    for (unsigned int i = 0; i < hash_len; i++) {
+        printf("%02X", hash[i]);
+    }
+    printf("\n");
+#endif
+}
+
+OpenSslManager::OpenSslManager() {
+    RAND_bytes(m_ticketKey.data(), static_cast<int>(m_ticketKey.size()));
+}
+
+OpenSslManager::~OpenSslManager() {
+    EVP_PKEY_free(m_rsa);
+    OPENSSL_cleanse(m_ticketKey.data(), m_ticketKey.size());
+}
+
+const char *OpenSslManager::Name() const { return "openssl"; }
+
+void OpenSslManager::CreateAsymmetricKey() {
+    EVP_PKEY_free(m_rsa);
+    m_rsa = nullptr;
+    EVP_PKEY_CTX *ctx = EVP_PKEY_CTX_new_from_name(nullptr, "RSA", nullptr);
+    if (EVP_PKEY_keygen_init(ctx) <= 0 ||
+        EVP_PKEY_CTX_set_rsa_keygen_bits(ctx, RSA_BITS) <= 0 ||
+        EVP_PKEY_generate(ctx, &m_rsa) <= 0) {
+        WARN("Failed to generate RSA key");
+    }
+    EVP_PKEY_CTX_free(ctx);
+}
+
+const u8 *OpenSslManager::ExportPublicKey(usize *size) {
+    auto buf = new u8[PUBLIC_BLOB_SIZE]{};
+    *size = PUBLIC_BLOB_SIZE;
+    PutBlobHeader(buf, PUBLICKEYBLOB_TYPE, ALG_RSA_KEYX);
+    PutLe32(buf + BLOB_HEADER_SIZE, RSA1_MAGIC);
+    PutLe32(buf + BLOB_HEADER_SIZE + 4, RSA_BITS);
+    PutLe32(buf + BLOB_HEADER_SIZE + 8, RSA_EXPONENT);
+
+    BIGNUM *n = nullptr;
+    if (!m_rsa || !EVP_PKEY_get_bn_param(m_rsa, OSSL_PKEY_PARAM_RSA_N, &n)) {
+        WARN("No asymmetric key to export");
+        return buf;
+    }
+    BN_bn2lebinpad(n, buf + BLOB_HEADER_SIZE + RSA_PUBKEY_SIZE, MODULUS_SIZE);
+    BN_free(n);
+
+    return buf;
+}
+
+std::unique_ptr<Session> OpenSslManager::CreateSession() {
+    u8 key[AES_KEY_SIZE];
+    RAND_bytes(key, sizeof(key));
+    auto session = std::make_unique<OpenSslSession>(key, true);
+    OPENSSL_cleanse(key, sizeof(key));
+    return session;
+}
+
+const u8 *OpenSslManager::ExportSessionKey(const Session &session,
+                                           usize *size, const u8 *pub_key_buf,
+                                           usize pub_key_size) {
+    auto buf = new u8[SIMPLE_BLOB_SIZE]{};
+    *size = SIMPLE_BLOB_SIZE;
+    PutBlobHeader(buf, SIMPLEBLOB_TYPE, ALG_AES_256);
+    PutLe32(buf + BLOB_HEADER_SIZE, ALG_RSA_KEYX);
+
+    EVP_PKEY *pub_key = ImportPublicKey(pub_key_buf, pub_key_size);
+    if (!pub_key) {
+        return buf;
+    }
+
+    const auto &key = static_cast<const OpenSslSession &>(session).m_key;
+    u8 *encrypted = buf + BLOB_HEADER_SIZE + 4;
+    usize encrypted_size = MODULUS_SIZE;
+    EVP_PKEY_CTX *ctx = EVP_PKEY_CTX_new(pub_key, nullptr);
+    if (EVP_PKEY_encrypt_init(ctx) <= 0 ||
+        EVP_PKEY_CTX_set_rsa_padding(ctx, RSA_PKCS1_PADDING) <= 0 ||
+        EVP_PKEY_encrypt(ctx, encrypted, &encrypted_size, key.data(),
+                         key.size()) <= 0) {
+        WARN("Failed to encrypt session key");
+    }
+    // CryptoAPI stores the RSA result little-endian.
+    std::reverse(encrypted, encrypted + MODULUS_SIZE);
+
+    EVP_PKEY_CTX_free(ctx);
+    EVP_PKEY_free(pub_key);
+    return buf;
+}
+
+std::unique_ptr<Session> OpenSslManager::ImportSession(const u8 *buf,
+                                                       usize size) {
+    if (size != SIMPLE_BLOB_SIZE ||
+        !CheckBlobHeader(buf, size, SIMPLEBLOB_TYPE, ALG_AES_256) ||
+        GetLe32(buf + BLOB_HEADER_SIZE) != ALG_RSA_KEYX || !m_rsa) {
+        WARN("Malformed session key blob");
+        return nullptr;
+    }
+
+    u8 encrypted[MODULUS_SIZE];
+    std::reverse_copy(buf + BLOB_HEADER_SIZE + 4, buf + size, encrypted);
+    u8 key[MODULUS_SIZE];
+    usize key_size = sizeof(key);
+    std::unique_ptr<Session> session;
+    EVP_PKEY_CTX *ctx = EVP_PKEY_CTX_new(m_rsa, nullptr);
+    if (EVP_PKEY_decrypt_init(ctx) <= 0 ||
+        EVP_PKEY_CTX_set_rsa_padding(ctx, RSA_PKCS1_PADDING) <= 0 ||
+        EVP_PKEY_decrypt(ctx, key, &key_size, encrypted, sizeof(encrypted)) <=
+            0 ||
+        key_size != AES_KEY_SIZE) {
+        WARN("Failed to decrypt session key");
+    } else {
+        session = std::make_unique<OpenSslSession>(key, false);
+    }
+
+    OPENSSL_cleanse(key, sizeof(key));
+    EVP_PKEY_CTX_free(ctx);
+    return session;
+}
+
+OpenSslKeyShare::OpenSslKeyShare(EVP_PKEY *key) : m_key(key) {
+    usize size = m_public.size();
+    EVP_PKEY_get_raw_public_key(m_key, m_public.data(), &size);
+}
+
+OpenSslKeyShare::~OpenSslKeyShare() { EVP_PKEY_free(m_key); }
+
+const u8 *OpenSslKeyShare::PublicKey() const { return m_public.data(); }
+
+bool OpenSslManager::SupportsKeyAgreement() const { return true; }
+
+std::unique_ptr<KeyShare> OpenSslManager::CreateKeyShare() {
+    EVP_PKEY *key = EVP_PKEY_Q_keygen(nullptr, nullptr, "X25519");
+    if (!key) {
+        WARN("Failed to generate X25519 key");
+        return nullptr;
+    }
+    return std::make_unique<OpenSslKeyShare>(key);
+}
+
+std::unique_ptr<Session> OpenSslManager::AgreeSession(const KeyShare &share,
+                                                      const u8 *peer_key,
+                                                      usize peer_key_size,
+                                                      bool local) {
+    if (peer_key_size != X25519_KEY_SIZE) {
+        WARN("Malformed X25519 public key");
+        return nullptr;
+    }
+    const auto &own = static_cast<const OpenSslKeyShare &>(share);
+    EVP_PKEY *peer = EVP_PKEY_new_raw_public_key(EVP_PKEY_X25519, nullptr,
+                                                 peer_key, peer_key_size);
+    u8 secret[X25519_KEY_SIZE];
+    usize secret_size = sizeof(secret);
+    EVP_PKEY_CTX *ctx = EVP_PKEY_CTX_new(own.m_key, nullptr);
+    // OpenSSL refuses the all-zero secret of a small order peer key.
+    bool ok = peer && EVP_PKEY_derive_init(ctx) > 0 &&
+              EVP_PKEY_derive_set_peer(ctx, peer) > 0 &&
+              EVP_PKEY_derive(ctx, secret, &secret_size) > 0 &&
+              secret_size == sizeof(secret);
+    EVP_PKEY_CTX_free(ctx);
+    EVP_PKEY_free(peer);
+
+    // Binding both public keys into the key keeps a session from being
+    // spliced onto another exchange. The client's key comes first.
+    u8 salt[2 * X25519_KEY_SIZE];
+    const u8 *client_key = local ? peer_key : own.PublicKey();
+    const u8 *server_key = local ? own.PublicKey() : peer_key;
+    std::memcpy(salt, client_key, X25519_KEY_SIZE);
+    std::memcpy(salt + X25519_KEY_SIZE, server_key, X25519_KEY_SIZE);
+    u8 key[AES_KEY_SIZE];
+    std::unique_ptr<Session> session;
+    if (!ok || !Hkdf(secret, sizeof(secret), salt, sizeof(salt), X25519_LABEL,
+                     key, sizeof(key))) {
+        WARN("X25519 key agreement failed");
+    } else {
+        session = std::make_unique<OpenSslSession>(key, local);
+    }
+    OPENSSL_cleanse(secret, sizeof(secret));
+    OPENSSL_cleanse(key, sizeof(key));
+    return session;
+}
+
+bool OpenSslManager::SupportsTickets() const { return true; }
+
+const u8 *OpenSslManager::IssueTicket(const Session &session, usize *size) {
+    u8 plain[TICKET_PLAIN_SIZE];
+    PutLe64(plain, UnixSeconds());
+    if (ExportResumptionSecret(session, plain + sizeof(u64)) != ERR_Ok) {
+        *size = 0;
+        return nullptr;
+    }
+
+    auto buf = new u8[TICKET_SIZE];
+    buf[0] = TICKET_VERSION;
+    RAND_bytes(buf + 1, NONCE_SIZE);
+    u8 *encrypted = buf + TICKET_HEADER_SIZE;
+    int len = 0;
+    int final_len = 0;
+    EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+    bool ok = EVP_EncryptInit_ex(ctx, EVP_aes_256_gcm(), nullptr,
+                                 m_ticketKey.data(), buf + 1) &&
+              EVP_EncryptUpdate(ctx, nullptr, &len, buf, TICKET_HEADER_SIZE) &&
+              EVP_EncryptUpdate(ctx, encrypted, &len, plain, sizeof(plain)) &&
+              EVP_EncryptFinal_ex(ctx, encrypted + len, &final_len) &&
+              EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_GET_TAG, TAG_SIZE,
+                                  encrypted + TICKET_PLAIN_SIZE);
+    EVP_CIPHER_CTX_free(ctx);
+    OPENSSL_cleanse(plain, sizeof(plain));
+    if (!ok) {
+        WARN("Failed to seal session ticket");
+        delete[] buf;
+        *size = 0;
+        return nullptr;
+    }
+    *size = TICKET_SIZE;
+    return buf;
+}
+
+ERR OpenSslManager::ExportResumptionSecret(const Session &session,
+                                           u8 *secret) {
+    const auto &key = static_cast<const OpenSslSession &>(session).m_key;
+    if (!Hkdf(key.data(), key.size(), nullptr, 0, RESUMPTION_LABEL, secret,
+              RESUMPTION_SECRET_SIZE)) {
+        WARN("Failed to derive resumption secret");
+        return ERR_Unknown;
+    }
+    return ERR_Ok;
+}
+
+std::unique_ptr<Session> OpenSslManager::ResumeFromTicket(
+    const u8 *ticket, usize size, const u8 *client_random,
+    const u8 *server_random) {
+    if (size != TICKET_SIZE || ticket[0] != TICKET_VERSION) {
+        WARN("Malformed session ticket");
+        return nullptr;
+    }
+
+    u8 plain[TICKET_PLAIN_SIZE];
+    u8 tag[TAG_SIZE];
+    std::memcpy(tag, ticket + TICKET_HEADER_SIZE + TICKET_PLAIN_SIZE,
+                TAG_SIZE);
+    int len = 0;
+    int final_len = 0;
+    EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+    bool ok = EVP_DecryptInit_ex(ctx, EVP_aes_256_gcm(), nullptr,
+                                 m_ticketKey.data(), ticket + 1) &&
+              EVP_DecryptUpdate(ctx, nullptr, &len, ticket,
+                                TICKET_HEADER_SIZE) &&
+              EVP_DecryptUpdate(ctx, plain, &len, ticket + TICKET_HEADER_SIZE,
+                                TICKET_PLAIN_SIZE) &&
+              EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_SET_TAG, TAG_SIZE, tag) &&
+              EVP_DecryptFinal_ex(ctx, plain + len, &final_len) > 0;
+    EVP_CIPHER_CTX_free(ctx);
+
+    std::unique_ptr<Session> session;
+    u64 issued = GetLe64(plain);
+    u64 now = UnixSeconds();
+    if (!ok) {
+        WARN("Session ticket failed authentication");
+    } else if (now < issued || now - issued > TICKET_LIFETIME_S) {
+        WARN("Session ticket expired");
+    } else {
+        session = Resume(plain + sizeof(u64), client_random, server_random,
+                         true);
+    }
+    OPENSSL_cleanse(plain, sizeof(plain));
+    return session;
+}
+
+std::unique_ptr<Session> OpenSslManager::ResumeFromSecret(
+    const u8 *secret, const u8 *client_random, const u8 *server_random) {
+    return Resume(secret, client_random, server_random, false);
+}
+
+void OpenSslManager::Random(u8 *buf, usize size) {
+    RAND_bytes(buf, static_cast<int>(size));
+}
+
+bool OpenSslManager::Supports(Cipher cipher) const {
+    switch (cipher) {
+        case CIPHER_AES_CBC:
+        case CIPHER_CHACHA20_POLY1305:
+            return true;
+        case CIPHER_AES_GCM:
+            return HasAesHardware();
+    }
+    return false;
+}
+}  // namespace proto::encryption
@@ -0,0 +1,125 @@
+#ifndef BSIT_3_OPENSSL_HPP
+#define BSIT_3_OPENSSL_HPP
+
+#include <openssl/types.h>
+
+#include <array>
+
+#include "encryption.hpp"
+
+namespace proto::encryption {
+constexpr usize AES_KEY_SIZE = 32;
+constexpr usize NONCE_SIZE = 12;
+
+class OpenSslSession : public Session {
+public:
+    // local is set on the side that created key rather than imported it.
+    OpenSslSession(const u8 *key, bool local);
+    ~OpenSslSession() override;
+
+    OpenSslSession(const OpenSslSession &) = delete;
+    OpenSslSession &operator=(const OpenSslSession &) = delete;
+
+    ERR SetCipher(Cipher cipher) override;
+
+    ERR Encrypt(u8 *buf, usize size, const u8 *aad, usize aad_size,
+                usize *res_size) override;
+    ERR Decrypt(u8 *buf, usize size, const u8 *aad, usize aad_size,
+                usize *res_size) override;
+
+    ERR Sign(u8 *buf, usize size, const u8 *aad, usize aad_size,
+             usize *res_size) override;
+    ERR Verify(const u8 *buf, usize size, const u8 *aad, usize aad_size,
+               usize *res_size) override;
+
+    void PrintHash() const override;
+
+private:
+    friend class OpenSslManager;
+
+    // Cipher contexts are initialized with the key once and only get their IV
+    // reset per message, so the key schedule is not recomputed.
+    struct Direction {
+        EVP_CIPHER_CTX *ctx = nullptr;
+        std::array<u8, NONCE_SIZE> iv{};
+        u64 seq = 0;
+    };
+
+    // Derives the key and nonce base of dir from the session key and label
+    // and restarts its sequence.
+    bool InitDirection(Direction *dir, const EVP_CIPHER *cipher,
+                       const char *label, bool encrypt) const;
+
+    std::array<u8, AES_KEY_SIZE> m_key{};
+    bool m_local = false;
+    Cipher m_cipher = CIPHER_AES_CBC;
+    Direction m_send;
+    Direction m_recv;
+};
+
+class OpenSslKeyShare : public KeyShare {
+public:
+    // Takes ownership of key.
+    explicit OpenSslKeyShare(EVP_PKEY *key);
+    ~OpenSslKeyShare() override;
+
+    OpenSslKeyShare(const OpenSslKeyShare &) = delete;
+    OpenSslKeyShare &operator=(const OpenSslKeyShare &) = delete;
+
+    const u8 *PublicKey() const override;
+
+private:
+    friend class OpenSslManager;
+
+    EVP_PKEY *m_key;
+    std::array<u8, X25519_KEY_SIZE> m_public{};
+};
+
+// OpenSSL backend. Produces and accepts the same key blobs as CryptoAPI, so
+// it talks to CapiManager peers. AES goes through EVP, which picks AES-NI
+// when the CPU has it.
+class OpenSslManager : public EncryptionManager {
+public:
+    OpenSslManager();
+    ~OpenSslManager() override;
+
+    const char *Name() const override;
+
+    void CreateAsymmetricKey() override;
+    const u8 *ExportPublicKey(usize *size) override;
+
+    std::unique_ptr<Session> CreateSession() override;
+    const u8 *ExportSessionKey(const Session &session, usize *size,
+                               const u8 *pub_key_buf,
+                               usize pub_key_size) override;
+    std::unique_ptr<Session> ImportSession(const u8 *buf, usize size) override;
+
+    bool SupportsKeyAgreement() const override;
+    std::unique_ptr<KeyShare> CreateKeyShare() override;
+    std::unique_ptr<Session> AgreeSession(const KeyShare &share,
+                                          const u8 *peer_key,
+                                          usize peer_key_size,
+                                          bool local) override;
+
+    bool SupportsTickets() const override;
+    const u8 *IssueTicket(const Session &session, usize *size) override;
+    ERR ExportResumptionSecret(const Session &session, u8 *secret) override;
+    std::unique_ptr<Session> ResumeFromTicket(
+        const u8 *ticket, usize size, const u8 *client_random,
+        const u8 *server_random) override;
+    std::unique_ptr<Session> ResumeFromSecret(
+        const u8 *secret, const u8 *client_random,
+        const u8 *server_random) override;
+
+    void Random(u8 *buf, usize size) override;
+
+    bool Supports(Cipher cipher) const override;
+
+private:
+    EVP_PKEY *m_rsa = nullptr;
+    // Seals tickets, random per process and never exported.
+    std::array<u8, AES_KEY_SIZE> m_ticketKey{};
+};
+}  // namespace proto::encryption
+
+#endif
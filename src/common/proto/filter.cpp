@@ -0,0 +1,558 @@
+#include "filter.hpp"
+
+#include <cctype>
+#include <charconv>
+#include <cstring>
+
+#include "../logging.hpp"
+
+namespace proto {
+namespace {
+// Op, field, value and text size of a node on the wire.
+constexpr usize NODE_HEADER = sizeof(FilterOp) + sizeof(FilterField) +
+                              sizeof(u64) + sizeof(usize);
+// Nesting of parentheses and negations Parse follows.
+constexpr usize MAX_DEPTH = 32;
+constexpr usize SID_SIZE = sizeof(AccessControlEntry::sid);
+
+struct FieldInfo {
+    FilterTarget target;
+    const char *name;
+    // Compared as text, only with == and !=.
+    bool text;
+};
+
+// By FilterField.
+constexpr FieldInfo FIELDS[FILTER_FIELD_COUNT_] = {
+    {FILTER_TARGET_DRIVE, "type", false},
+    {FILTER_TARGET_DRIVE, "free", false},
+    {FILTER_TARGET_DRIVE, "stale", false},
+    {FILTER_TARGET_DRIVE, "name", true},
+    {FILTER_TARGET_ACE, "type", false},
+    {FILTER_TARGET_ACE, "scope", false},
+    {FILTER_TARGET_ACE, "mask", false},
+    {FILTER_TARGET_ACE, "sid", true},
+    {FILTER_TARGET_OWNER, "name", true},
+    {FILTER_TARGET_OWNER, "domain", true},
+    {FILTER_TARGET_OWNER, "sid", true},
+};
+
+struct NamedValue {
+    FilterField field;
+    const char *name;
+    u64 value;
+};
+
+constexpr NamedValue VALUES[] = {
+    {FILTER_DRIVE_TYPE, "local", DRIVE_TYPE_LOCAL},
+    {FILTER_DRIVE_TYPE, "network", DRIVE_TYPE_NET},
+    {FILTER_DRIVE_TYPE, "removable", DRIVE_TYPE_REMOVABLE},
+    {FILTER_DRIVE_TYPE, "fs", DRIVE_TYPE_FS},
+    {FILTER_DRIVE_TYPE, "unknown", DRIVE_TYPE_UNKNOWN},
+    {FILTER_DRIVE_STALE, "false", 0},
+    {FILTER_DRIVE_STALE, "true", 1},
+    {FILTER_ACE_TYPE, "allowed", ACE_TYPE_ALLOWED},
+    {FILTER_ACE_TYPE, "denied", ACE_TYPE_DENIED},
+    {FILTER_ACE_TYPE, "other", ACE_TYPE_OTHER},
+    {FILTER_ACE_SCOPE, "direct", SCOPE_DIRECT},
+    {FILTER_ACE_SCOPE, "object", SCOPE_OBJECT},
+    {FILTER_ACE_SCOPE, "container", SCOPE_CONTAINER},
+    {FILTER_ACE_MASK, "read", 0x120089},
+    {FILTER_ACE_MASK, "write", 0x120116},
+    {FILTER_ACE_MASK, "execute", 0x1200A0},
+    {FILTER_ACE_MASK, "delete", 0x10000},
+    {FILTER_ACE_MASK, "read_control", 0x20000},
+    {FILTER_ACE_MASK, "write_dac", 0x40000},
+    {FILTER_ACE_MASK, "write_owner", 0x80000},
+    {FILTER_ACE_MASK, "synchronize", 0x100000},
+    {FILTER_ACE_MASK, "generic_all", 0x10000000},
+};
+
+bool EqualsIgnoreCase(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) return false;
+    for (usize i = 0; i < a.size(); i++) {
+        if (std::tolower(static_cast<unsigned char>(a[i])) !=
+            std::tolower(static_cast<unsigned char>(b[i]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Decimal or 0x hexadecimal, with an optional binary K, M, G or T.
+bool ParseNumber(std::string_view word, u64 *res) {
+    int base = 10;
+    if (word.size() > 2 && word[0] == '0' &&
+        (word[1] == 'x' || word[1] == 'X')) {
+        base = 16;
+        word.remove_prefix(2);
+    }
+    auto [end, ec] =
+        std::from_chars(word.data(), word.data() + word.size(), *res, base);
+    if (ec != std::errc() || end == word.data()) return false;
+    std::string_view suffix(end, word.data() + word.size() - end);
+    if (suffix.empty()) return true;
+    if (suffix.size() != 1) return false;
+    const char *units = "KMGT";
+    for (u32 i = 0; i < 4; i++) {
+        if (std::toupper(static_cast<unsigned char>(suffix[0])) == units[i]) {
+            u32 shift = 10 * (i + 1);
+            if (*res >> (64 - shift)) return false;
+            *res <<= shift;
+            return true;
+        }
+    }
+    return false;
+}
+
+// "S-1-5-32-544" to the raw layout of AccessControlEntry::sid.
+bool ParseSid(std::string_view text, std::pmr::string *res) {
+    if (text.size() < 2 || (text[0] != 'S' && text[0] != 's') ||
+        text[1] != '-') {
+        return false;
+    }
+    text.remove_prefix(2);
+    std::vector<u64> parts;
+    while (true) {
+        u64 part;
+        auto [end, ec] =
+            std::from_chars(text.data(), text.data() + text.size(), part);
+        if (ec != std::errc() || end == text.data()) return false;
+        parts.push_back(part);
+        text.remove_prefix(end - text.data());
+        if (text.empty()) break;
+        if (text[0] != '-') return false;
+        text.remove_prefix(1);
+    }
+    if (parts.size() < 2 || parts[0] > 0xFF || parts[1] >> 48 ||
+        8 + (parts.size() - 2) * sizeof(u32) > SID_SIZE) {
+        return false;
+    }
+    usize subs = parts.size() - 2;
+    res->assign(SID_SIZE, '\0');
+    (*res)[0] = static_cast<char>(parts[0]);
+    (*res)[1] = static_cast<char>(subs);
+    for (usize i = 0; i < 6; i++) {
+        (*res)[2 + i] = static_cast<char>(parts[1] >> (8 * (5 - i)));
+    }
+    for (usize i = 0; i < subs; i++) {
+        if (parts[2 + i] > UINT32_MAX) return false;
+        auto sub = static_cast<u32>(parts[2 + i]);
+        std::memcpy(res->data() + 8 + i * sizeof(u32), &sub, sizeof(u32));
+    }
+    return true;
+}
+
+u64 NumberOf(const DriveInfo &drive, FilterField field) {
+    switch (field) {
+        case FILTER_DRIVE_TYPE:
+            return drive.type;
+        case FILTER_DRIVE_FREE:
+            return drive.free_bytes;
+        case FILTER_DRIVE_STALE:
+            return drive.stale;
+        default:
+            return 0;
+    }
+}
+
+u64 NumberOf(const AccessControlEntry &ace, FilterField field) {
+    switch (field) {
+        case FILTER_ACE_TYPE:
+            return ace.aceType;
+        case FILTER_ACE_SCOPE:
+            return ace.scope;
+        case FILTER_ACE_MASK:
+            return ace.accessMask;
+        default:
+            return 0;
+    }
+}
+
+u64 NumberOf(const OwnerInfo &owner, FilterField field) { return 0; }
+
+std::string_view TextOf(const DriveInfo &drive, FilterField field) {
+    return drive.name;
+}
+
+std::string_view TextOf(const AccessControlEntry &ace, FilterField field) {
+    return {reinterpret_cast<const char *>(ace.sid.data()), ace.sid.size()};
+}
+
+std::string_view TextOf(const OwnerInfo &owner, FilterField field) {
+    switch (field) {
+        case FILTER_OWNER_NAME:
+            return owner.ownerName;
+        case FILTER_OWNER_DOMAIN:
+            return owner.ownerDomain;
+        default:
+            return {reinterpret_cast<const char *>(owner.sid.data()),
+                    owner.sid.size()};
+    }
+}
+
+template <typename T>
+bool Compare(const FilterNode &node, const T &entry) {
+    if (FIELDS[node.field].text) {
+        bool equal = TextOf(entry, node.field) == node.text;
+        return node.op == FILTER_EQ ? equal : !equal;
+    }
+    u64 val = NumberOf(entry, node.field);
+    switch (node.op) {
+        case FILTER_EQ:
+            return val == node.value;
+        case FILTER_NE:
+            return val != node.value;
+        case FILTER_LT:
+            return val < node.value;
+        case FILTER_LE:
+            return val <= node.value;
+        case FILTER_GT:
+            return val > node.value;
+        case FILTER_GE:
+            return val >= node.value;
+        case FILTER_HAS:
+            return (val & node.value) == node.value;
+        default:
+            return (val & node.value) != 0;
+    }
+}
+
+// Recursive descent over the text, appends the nodes in postfix order.
+class Parser {
+public:
+    Parser(std::string_view text, FilterTarget target,
+           std::pmr::vector<FilterNode> *nodes)
+        : m_text(text), m_target(target), m_nodes(nodes) {}
+
+    bool Parse() {
+        Next();
+        if (!Or(0)) return false;
+        if (m_kind != TOK_END) return Fail("unexpected", m_token);
+        return true;
+    }
+
+private:
+    enum TokenKind {
+        TOK_END,
+        TOK_INVALID,
+        TOK_WORD,
+        TOK_QUOTED,
+        TOK_OPEN,
+        TOK_CLOSE,
+        TOK_AND,
+        TOK_OR,
+        TOK_NOT,
+        TOK_COMPARE,
+    };
+
+    std::string_view m_text;
+    FilterTarget m_target;
+    std::pmr::vector<FilterNode> *m_nodes;
+    usize m_pos = 0;
+    TokenKind m_kind = TOK_END;
+    std::string_view m_token;
+    FilterOp m_op = FILTER_EQ;
+
+    static bool Fail(const char *what, std::string_view token) {
+        WARN("Invalid filter, %s \"%.*s\"", what,
+             static_cast<int>(token.size()), token.data());
+        return false;
+    }
+
+    void Next() {
+        while (m_pos < m_text.size() && std::isspace(static_cast<unsigned char>(
+                                            m_text[m_pos]))) {
+            m_pos++;
+        }
+        usize start = m_pos;
+        auto take = [&](TokenKind kind, usize size) {
+            m_kind = kind;
+            m_token = m_text.substr(start, size);
+            m_pos += size;
+        };
+        if (m_pos == m_text.size()) {
+            m_kind = TOK_END;
+            m_token = {};
+            return;
+        }
+        std::string_view rest = m_text.substr(m_pos);
+        const std::pair<std::string_view, FilterOp> compares[] = {
+            {"==", FILTER_EQ}, {"!=", FILTER_NE}, {"<=", FILTER_LE},
+            {">=", FILTER_GE}, {"<", FILTER_LT},  {">", FILTER_GT},
+        };
+        for (const auto &[text, op] : compares) {
+            if (rest.starts_with(text)) {
+                m_op = op;
+                take(TOK_COMPARE, text.size());
+                return;
+            }
+        }
+        if (rest.starts_with("&&")) return take(TOK_AND, 2);
+        if (rest.starts_with("||")) return take(TOK_OR, 2);
+        switch (rest[0]) {
+            case '!':
+                return take(TOK_NOT, 1);
+            case '(':
+                return take(TOK_OPEN, 1);
+            case ')':
+                return take(TOK_CLOSE, 1);
+            case '"': {
+                usize end = rest.find('"', 1);
+                if (end == std::string_view::npos) {
+                    return take(TOK_INVALID, rest.size());
+                }
+                take(TOK_QUOTED, end + 1);
+                m_token = m_token.substr(1, end - 1);
+                return;
+            }
+            default:
+                break;
+        }
+        usize size = 0;
+        while (size < rest.size() &&
+               !std::isspace(static_cast<unsigned char>(rest[size])) &&
+               std::string_view("!=<>&|()\"").find(rest[size]) ==
+                   std::string_view::npos) {
+            size++;
+        }
+        // A lone & or |.
+        if (size == 0) return take(TOK_INVALID, 1);
+        take(TOK_WORD, size);
+    }
+
+    bool Or(usize depth) {
+        if (!And(depth)) return false;
+        while (m_kind == TOK_OR) {
+            Next();
+            if (!And(depth)) return false;
+            m_nodes->push_back({FILTER_OR});
+        }
+        return true;
+    }
+
+    bool And(usize depth) {
+        if (!Unary(depth)) return false;
+        while (m_kind == TOK_AND) {
+            Next();
+            if (!Unary(depth)) return false;
+            m_nodes->push_back({FILTER_AND});
+        }
+        return true;
+    }
+
+    bool Unary(usize depth) {
+        if (depth > MAX_DEPTH) return Fail("too deeply nested at", m_token);
+        if (m_kind == TOK_NOT) {
+            Next();
+            if (!Unary(depth + 1)) return false;
+            m_nodes->push_back({FILTER_NOT});
+            return true;
+        }
+        if (m_kind == TOK_OPEN) {
+            Next();
+            if (!Or(depth + 1)) return false;
+            if (m_kind != TOK_CLOSE) return Fail("expected ) at", m_token);
+            Next();
+            return true;
+        }
+        return Comparison();
+    }
+
+    bool Comparison() {
+        if (m_kind != TOK_WORD) return Fail("expected a field at", m_token);
+        FilterNode node{};
+        bool found = false;
+        for (u8 i = 0; i < FILTER_FIELD_COUNT_; i++) {
+            if (FIELDS[i].target == m_target &&
+                EqualsIgnoreCase(m_token, FIELDS[i].name)) {
+                node.field = static_cast<FilterField>(i);
+                found = true;
+                break;
+            }
+        }
+        if (!found) return Fail("unknown field", m_token);
+        Next();
+
+        if (m_kind == TOK_COMPARE) {
+            node.op = m_op;
+        } else if (m_kind == TOK_WORD && EqualsIgnoreCase(m_token, "has")) {
+            node.op = FILTER_HAS;
+        } else if (m_kind == TOK_WORD && EqualsIgnoreCase(m_token, "any")) {
+            node.op = FILTER_ANY;
+        } else {
+            return Fail("expected a comparison at", m_token);
+        }
+        Next();
+
+        if (m_kind != TOK_WORD && m_kind != TOK_QUOTED) {
+            return Fail("expected a value at", m_token);
+        }
+        if (!Value(&node)) return false;
+        Next();
+        m_nodes->push_back(std::move(node));
+        return true;
+    }
+
+    bool Value(FilterNode *node) {
+        if (FIELDS[node->field].text) {
+            if (node->op != FILTER_EQ && node->op != FILTER_NE) {
+                return Fail("text only compares with == or !=, got",
+                            m_token);
+            }
+            if (node->field == FILTER_ACE_SID ||
+                node->field == FILTER_OWNER_SID) {
+                return ParseSid(m_token, &node->text) ||
+                       Fail("invalid SID", m_token);
+            }
+            node->text = m_token;
+            return true;
+        }
+        if (m_kind == TOK_WORD) {
+            for (const auto &named : VALUES) {
+                if (named.field == node->field &&
+                    EqualsIgnoreCase(m_token, named.name)) {
+                    node->value = named.value;
+                    return true;
+                }
+            }
+            if (ParseNumber(m_token, &node->value)) return true;
+        }
+        return Fail("invalid value", m_token);
+    }
+};
+}  // namespace
+
+Filter::Filter(std::pmr::memory_resource *mem) : m_nodes(mem) {}
+
+ERR Filter::Parse(std::string_view text, FilterTarget target, Filter *res) {
+    res->m_nodes.clear();
+    Parser parser(text, target, &res->m_nodes);
+    if (!parser.Parse()) {
+        return ERR_InvalidArgument;
+    }
+    if (!res->Compile(target)) {
+        WARN("Invalid filter, more than %zu comparisons or %zu bytes",
+             FILTER_MAX_NODES / 2, FILTER_MAX_SIZE);
+        return ERR_InvalidArgument;
+    }
+    return ERR_Ok;
+}
+
+bool Filter::Compile(FilterTarget target) {
+    m_compiled = false;
+    if (m_nodes.size() > FILTER_MAX_NODES ||
+        packedSize() > FILTER_MAX_SIZE) {
+        return false;
+    }
+    // Results on the evaluation stack after each node.
+    usize depth = 0;
+    for (const auto &node : m_nodes) {
+        switch (node.op) {
+            case FILTER_AND:
+            case FILTER_OR:
+                if (depth < 2) return false;
+                depth--;
+                break;
+            case FILTER_NOT:
+                if (depth < 1) return false;
+                break;
+            default:
+                if (node.op >= FILTER_OP_COUNT_ ||
+                    node.field >= FILTER_FIELD_COUNT_ ||
+                    FIELDS[node.field].target != target) {
+                    return false;
+                }
+                if (FIELDS[node.field].text && node.op != FILTER_EQ &&
+                    node.op != FILTER_NE) {
+                    return false;
+                }
+                depth++;
+        }
+    }
+    m_compiled = m_nodes.empty() || depth == 1;
+    return m_compiled;
+}
+
+bool Filter::Match(const DriveInfo &drive) const { return Eval(drive); }
+
+bool Filter::Match(const AccessControlEntry &ace) const { return Eval(ace); }
+
+bool Filter::Match(const OwnerInfo &owner) const { return Eval(owner); }
+
+template <typename T>
+bool Filter::Eval(const T &entry) const {
+    if (!m_compiled) return false;
+    if (m_nodes.empty()) return true;
+    bool stack[FILTER_MAX_NODES];
+    usize top = 0;
+    for (const auto &node : m_nodes) {
+        switch (node.op) {
+            case FILTER_AND:
+                top--;
+                stack[top - 1] = stack[top - 1] && stack[top];
+                break;
+            case FILTER_OR:
+                top--;
+                stack[top - 1] = stack[top - 1] || stack[top];
+                break;
+            case FILTER_NOT:
+                stack[top - 1] = !stack[top - 1];
+                break;
+            default:
+                stack[top++] = Compare(node, entry);
+        }
+    }
+    return stack[0];
+}
+
+void Filter::push(PackCtx *ctx) const {
+    ctx->push(static_cast<u8>(m_nodes.size()));
+    for (const auto &node : m_nodes) {
+        ctx->push(node.op);
+        ctx->push(node.field);
+        ctx->push(node.value);
+        ctx->push(node.text.data(), node.text.size());
+    }
+}
+
+bool Filter::pop(PackCtx *ctx) {
+    m_nodes.clear();
+    u8 count = ctx->pop<u8>();
+    m_nodes.reserve(count);
+    for (u8 i = 0; i < count; i++) {
+        // A corrupt frame gives a filter that matches nothing rather than
+        // reads past its end.
+        if (ctx->remaining() < NODE_HEADER) {
+            m_nodes.clear();
+            m_compiled = false;
+            return false;
+        }
+        auto op = ctx->pop<FilterOp>();
+        auto field = ctx->pop<FilterField>();
+        auto value = ctx->pop<u64>();
+        usize left = ctx->remaining() - sizeof(usize);
+        usize size;
+        const char *text = ctx->popView<char>(&size);
+        if (size > left) {
+            m_nodes.clear();
+            m_compiled = false;
+            return false;
+        }
+        // Built on the allocator of m_nodes, a moved string keeps it.
+        m_nodes.push_back(
+            {op, field, value,
+             std::pmr::string(text, size, m_nodes.get_allocator())});
+    }
+    return true;
+}
+
+usize Filter::packedSize() const {
+    if (m_nodes.empty()) return 0;
+    usize size = sizeof(u8);
+    for (const auto &node : m_nodes) {
+        size += NODE_HEADER + node.text.size();
+    }
+    return size;
+}
+}  // namespace proto
@@ -0,0 +1,126 @@
+#ifndef BSIT_3_FILTER_HPP
+#define BSIT_3_FILTER_HPP
+
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../alias.hpp"
+#include "../data.hpp"
+#include "../errors.hpp"
+#include "packable.hpp"
+
+namespace proto {
+// Limits of a filter a server accepts, they keep its evaluation stack small
+// and leave room for paths in a bulk request.
+constexpr usize FILTER_MAX_NODES = 64;
+constexpr usize FILTER_MAX_SIZE = 1024;
+
+// Entries a filter selects: drives of REQ_DRIVES, ACEs of REQ_RIGHTS and
+// REQ_RIGHTS_BULK, owners of REQ_OWNER_BULK.
+enum FilterTarget : u8 {
+    FILTER_TARGET_NONE,
+    FILTER_TARGET_DRIVE,
+    FILTER_TARGET_ACE,
+    FILTER_TARGET_OWNER,
+};
+
+// Values are on the wire, new ones go at the end. Names, domains and SIDs
+// are text, SIDs as their 32 raw bytes.
+enum FilterField : u8 {
+    FILTER_DRIVE_TYPE,
+    FILTER_DRIVE_FREE,
+    FILTER_DRIVE_STALE,
+    FILTER_DRIVE_NAME,
+    FILTER_ACE_TYPE,
+    FILTER_ACE_SCOPE,
+    FILTER_ACE_MASK,
+    FILTER_ACE_SID,
+    FILTER_OWNER_NAME,
+    FILTER_OWNER_DOMAIN,
+    FILTER_OWNER_SID,
+    FILTER_FIELD_COUNT_,
+};
+
+enum FilterOp : u8 {
+    FILTER_EQ,
+    FILTER_NE,
+    FILTER_LT,
+    FILTER_LE,
+    FILTER_GT,
+    FILTER_GE,
+    // All bits of the value are set in the field.
+    FILTER_HAS,
+    // Any bit of the value is set in the field.
+    FILTER_ANY,
+    FILTER_AND,
+    FILTER_OR,
+    FILTER_NOT,
+    FILTER_OP_COUNT_,
+};
+
+// One step of a filter in postfix order. Comparisons push their result,
+// AND, OR and NOT replace the topmost ones with theirs.
+struct FilterNode {
+    FilterOp op;
+    FilterField field = FILTER_DRIVE_TYPE;
+    u64 value = 0;
+    std::pmr::string text;
+};
+
+// Expression a request carries so the server only sends matching entries.
+// Built from text by the client with Parse, compiled by the server against
+// the target of the request once before evaluating it on every entry.
+//
+// A default constructed filter matches everything, one that failed to
+// compile matches nothing.
+class Filter {
+public:
+    Filter() = default;
+    // Nodes read by pop are allocated from mem.
+    explicit Filter(std::pmr::memory_resource *mem);
+
+    // Parses text such as
+    //   type == network && free < 10G
+    //   mask has write_dac && !(sid == S-1-1-0 || type == denied)
+    // and compiles it for target. Fields and named values depend on the
+    // target:
+    //   drive: type (local, network, removable, fs, unknown), free, stale
+    //          (true, false), name
+    //   ace:   type (allowed, denied, other), scope (direct, object,
+    //          container), mask (read, write, execute, delete,
+    //          read_control, write_dac, write_owner, synchronize,
+    //          generic_all), sid
+    //   owner: name, domain, sid
+    // Numbers are decimal or hexadecimal with an optional K, M, G or T.
+    // Text values may be quoted and only compare with == and !=.
+    static ERR Parse(std::string_view text, FilterTarget target, Filter *res);
+
+    // Checks the nodes against target, false if the filter is malformed,
+    // too large or uses fields of another target.
+    bool Compile(FilterTarget target);
+
+    [[nodiscard]] bool empty() const { return m_nodes.empty(); }
+
+    [[nodiscard]] bool Match(const DriveInfo &drive) const;
+    [[nodiscard]] bool Match(const AccessControlEntry &ace) const;
+    [[nodiscard]] bool Match(const OwnerInfo &owner) const;
+
+    // Node count and nodes, read back by pop. pop fails on a truncated
+    // filter, which then matches nothing.
+    void push(PackCtx *ctx) const;
+    bool pop(PackCtx *ctx);
+    // Bytes push adds, 0 for an empty filter which requests leave out.
+    [[nodiscard]] usize packedSize() const;
+
+private:
+    std::pmr::vector<FilterNode> m_nodes;
+    bool m_compiled = true;
+
+    template <typename T>
+    bool Eval(const T &entry) const;
+};
+}  // namespace proto
+
+#endif
@@ -0,0 +1,157 @@
+#include "flat.hpp"
+
+namespace proto::flat {
+namespace {
+constexpr usize TYPE_OFFSET = sizeof(usize);
+constexpr usize COUNT_OFFSET = TYPE_OFFSET + 4;
+constexpr usize OFFSETS_OFFSET = COUNT_OFFSET + sizeof(u32);
+constexpr usize SID_SIZE = sizeof(AccessControlEntry::sid);
+constexpr usize ACE_SIZE = 6 + SID_SIZE;
+// Fixed part of bulk records: kind and id for ACLs, kind, error and ACL id
+// for rights paths, error, SID, path size and name size for owners.
+constexpr usize ACL_HEADER = 1 + sizeof(u32);
+constexpr usize PATH_RIGHTS_HEADER = 2 + sizeof(u32);
+constexpr usize PATH_OWNER_HEADER = 1 + SID_SIZE + 2 * sizeof(u32);
+}  // namespace
+
+Builder::Builder(ByteOrder order, std::pmr::memory_resource *mem)
+    : m_order(order), m_buf(mem) {}
+
+void Builder::begin(ResponseType type, usize count) {
+    m_count = count;
+    m_next = 0;
+    m_buf.assign(OFFSETS_OFFSET + (count + 1) * sizeof(u32), 0);
+    m_buf[TYPE_OFFSET] = type;
+    u32 wire_count = static_cast<u32>(count);
+    if (m_order != BYTE_ORDER_NATIVE) {
+        wire_count = utils::hton_generic(wire_count);
+    }
+    std::memcpy(m_buf.data() + COUNT_OFFSET, &wire_count, sizeof(wire_count));
+}
+
+void Builder::record() {
+    if (m_next < m_count) {
+        setOffset(m_next++, static_cast<u32>(m_buf.size()));
+    }
+}
+
+void Builder::putBytes(const void *data, usize size) {
+    auto bytes = static_cast<const u8 *>(data);
+    m_buf.insert(m_buf.end(), bytes, bytes + size);
+}
+
+std::unique_ptr<const u8[]> Builder::finish(usize *size) {
+    // Records that were never started are empty.
+    while (m_next <= m_count) {
+        setOffset(m_next++, static_cast<u32>(m_buf.size()));
+    }
+    *size = m_buf.size();
+    auto res = std::make_unique<u8[]>(*size);
+    std::memcpy(res.get(), m_buf.data(), *size);
+    // Same native size prefix as PackCtx.
+    *reinterpret_cast<usize *>(res.get()) = *size;
+
+    return res;
+}
+
+void Builder::setOffset(usize i, u32 offset) {
+    if (m_order != BYTE_ORDER_NATIVE) offset = utils::hton_generic(offset);
+    std::memcpy(m_buf.data() + OFFSETS_OFFSET + i * sizeof(u32), &offset,
+                sizeof(offset));
+}
+
+std::string_view Record::text(usize offset, usize size) const {
+    if (offset >= m_size) return {};
+    size = MIN(size, m_size - offset);
+    return {reinterpret_cast<const char *>(m_data + offset), size};
+}
+
+std::span<const u8> AceView::sid() const {
+    if (m_size < 6 + SID_SIZE) return {};
+    return {m_data + 6, SID_SIZE};
+}
+
+std::span<const u8> OwnerView::sid() const {
+    if (m_size < SID_SIZE) return {};
+    return {m_data, SID_SIZE};
+}
+
+std::string_view OwnerView::name() const {
+    return text(SID_SIZE + sizeof(u32), read<u32>(SID_SIZE));
+}
+
+std::string_view OwnerView::domain() const {
+    return text(SID_SIZE + sizeof(u32) + read<u32>(SID_SIZE), m_size);
+}
+
+usize AclView::aceCount() const {
+    return m_size > ACL_HEADER ? (m_size - ACL_HEADER) / ACE_SIZE : 0;
+}
+
+AceView AclView::ace(usize i) const {
+    if (i >= aceCount()) return {};
+    return {m_data + ACL_HEADER + i * ACE_SIZE, ACE_SIZE, m_order};
+}
+
+std::string_view PathRightsView::path() const {
+    return text(PATH_RIGHTS_HEADER, m_size);
+}
+
+std::span<const u8> PathOwnerView::sid() const {
+    if (m_size < 1 + SID_SIZE) return {};
+    return {m_data + 1, SID_SIZE};
+}
+
+std::string_view PathOwnerView::path() const {
+    return text(PATH_OWNER_HEADER, read<u32>(1 + SID_SIZE));
+}
+
+std::string_view PathOwnerView::name() const {
+    return text(PATH_OWNER_HEADER + read<u32>(1 + SID_SIZE),
+                read<u32>(1 + SID_SIZE + sizeof(u32)));
+}
+
+std::string_view PathOwnerView::domain() const {
+    return text(PATH_OWNER_HEADER + read<u32>(1 + SID_SIZE) +
+                    read<u32>(1 + SID_SIZE + sizeof(u32)),
+                m_size);
+}
+
+View::View(const u8 *buf, usize size, ByteOrder order)
+    : m_buf(buf), m_size(size), m_order(order) {}
+
+bool View::valid() const {
+    if (!m_buf || m_size < OFFSETS_OFFSET) return false;
+    if (*reinterpret_cast<const usize *>(m_buf) != m_size) return false;
+    return OFFSETS_OFFSET + (count() + 1) * sizeof(u32) <= m_size;
+}
+
+ResponseType View::type() const {
+    return static_cast<ResponseType>(m_buf[TYPE_OFFSET]);
+}
+
+usize View::count() const {
+    u32 count;
+    std::memcpy(&count, m_buf + COUNT_OFFSET, sizeof(count));
+    if (m_order != BYTE_ORDER_NATIVE) count = utils::ntoh_generic(count);
+    return count;
+}
+
+bool View::record(usize i, const u8 **data, usize *size) const {
+    if (!valid() || i >= count()) return false;
+    u32 begin = offset(i);
+    u32 end = offset(i + 1);
+    if (begin > end || end > m_size) return false;
+    *data = m_buf + begin;
+    *size = end - begin;
+    return true;
+}
+
+u32 View::offset(usize i) const {
+    u32 offset;
+    std::memcpy(&offset, m_buf + OFFSETS_OFFSET + i * sizeof(u32),
+                sizeof(offset));
+    if (m_order != BYTE_ORDER_NATIVE) offset = utils::ntoh_generic(offset);
+    return offset;
+}
+}  // namespace proto::flat
@@ -0,0 +1,191 @@
+#ifndef BSIT_3_FLAT_HPP
+#define BSIT_3_FLAT_HPP
+
+#include <cstring>
+#include <memory>
+#include <memory_resource>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "../alias.hpp"
+#include "response.hpp"
+
+// Flat response layout, an alternative to the sequential PackCtx encoding
+// that can be read in place:
+//
+//   usize size | u8 type | 3 reserved | u32 count | u32 offsets[count + 1]
+//   | records...
+//
+// Record i spans [offsets[i], offsets[i + 1]) from the start of the payload.
+// Scalar responses have a single record. Multi-byte fields follow the byte
+// order of the connection, so in native mode reading a field is one load.
+namespace proto::flat {
+class Builder {
+public:
+    explicit Builder(
+        ByteOrder order,
+        std::pmr::memory_resource *mem = std::pmr::get_default_resource());
+
+    void begin(ResponseType type, usize count);
+
+    // Starts the next record, its fields are appended with put/putBytes.
+    void record();
+
+    template <typename T>
+    void put(T val) {
+        if (m_order != BYTE_ORDER_NATIVE) val = utils::hton_generic(val);
+        putBytes(&val, sizeof(val));
+    }
+
+    void putBytes(const void *data, usize size);
+
+    std::unique_ptr<const u8[]> finish(usize *size);
+
+private:
+    ByteOrder m_order;
+    std::pmr::vector<u8> m_buf;
+    usize m_count = 0;
+    usize m_next = 0;
+
+    void setOffset(usize i, u32 offset);
+};
+
+// Base of the typed record views: a bounds-checked window into the payload.
+// Reads outside of the record yield zero instead of touching other memory.
+class Record {
+public:
+    Record() = default;
+    Record(const u8 *data, usize size, ByteOrder order)
+        : m_data(data), m_size(size), m_order(order) {}
+
+    [[nodiscard]] bool empty() const { return m_size == 0; }
+
+protected:
+    template <typename T>
+    [[nodiscard]] T read(usize offset) const {
+        T val{};
+        if (offset + sizeof(T) > m_size) return val;
+        std::memcpy(&val, m_data + offset, sizeof(T));
+        if (m_order != BYTE_ORDER_NATIVE) val = utils::ntoh_generic(val);
+        return val;
+    }
+
+    [[nodiscard]] std::string_view text(usize offset, usize size) const;
+
+    const u8 *m_data = nullptr;
+    usize m_size = 0;
+    ByteOrder m_order = BYTE_ORDER_NETWORK;
+};
+
+struct OsInfoView : Record {
+    using Record::Record;
+    [[nodiscard]] OSType type() const { return read<OSType>(0); }
+    [[nodiscard]] u16 major() const { return read<u16>(1); }
+    [[nodiscard]] u16 minor() const { return read<u16>(3); }
+};
+
+struct TimeView : Record {
+    using Record::Record;
+    [[nodiscard]] u64 timeMs() const { return read<u64>(0); }
+    [[nodiscard]] i8 timeZone() const { return read<i8>(8); }
+};
+
+struct MemoryView : Record {
+    using Record::Record;
+    [[nodiscard]] u64 totalBytes() const { return read<u64>(0); }
+    [[nodiscard]] u64 freeBytes() const { return read<u64>(8); }
+};
+
+struct DriveView : Record {
+    using Record::Record;
+    [[nodiscard]] u64 freeBytes() const { return read<u64>(0); }
+    [[nodiscard]] DriveType type() const {
+        return static_cast<DriveType>(read<u8>(8) & ~DRIVE_FLAG_STALE);
+    }
+    [[nodiscard]] bool stale() const {
+        return read<u8>(8) & DRIVE_FLAG_STALE;
+    }
+    [[nodiscard]] std::string_view name() const { return text(9, m_size); }
+};
+
+struct AceView : Record {
+    using Record::Record;
+    [[nodiscard]] u32 accessMask() const { return read<u32>(0); }
+    [[nodiscard]] AceType aceType() const { return read<AceType>(4); }
+    [[nodiscard]] Scope scope() const { return read<Scope>(5); }
+    [[nodiscard]] std::span<const u8> sid() const;
+};
+
+struct OwnerView : Record {
+    using Record::Record;
+    [[nodiscard]] std::span<const u8> sid() const;
+    [[nodiscard]] std::string_view name() const;
+    [[nodiscard]] std::string_view domain() const;
+};
+
+// Records of a RESP_RIGHTS_BULK payload start with their kind, the ACLs come
+// before the paths. Either view reads it.
+enum BulkRecord : u8 {
+    BULK_RECORD_ACL,
+    BULK_RECORD_PATH,
+};
+
+struct AclView : Record {
+    using Record::Record;
+    [[nodiscard]] BulkRecord kind() const { return read<BulkRecord>(0); }
+    [[nodiscard]] u32 id() const { return read<u32>(1); }
+    [[nodiscard]] usize aceCount() const;
+    [[nodiscard]] AceView ace(usize i) const;
+};
+
+struct PathRightsView : Record {
+    using Record::Record;
+    [[nodiscard]] BulkRecord kind() const { return read<BulkRecord>(0); }
+    [[nodiscard]] ERR err() const { return read<ERR>(1); }
+    // Id of the AclView of this path, from this payload or an earlier one.
+    [[nodiscard]] u32 acl() const { return read<u32>(2); }
+    [[nodiscard]] std::string_view path() const;
+};
+
+struct PathOwnerView : Record {
+    using Record::Record;
+    [[nodiscard]] ERR err() const { return read<ERR>(0); }
+    [[nodiscard]] std::span<const u8> sid() const;
+    [[nodiscard]] std::string_view path() const;
+    [[nodiscard]] std::string_view name() const;
+    [[nodiscard]] std::string_view domain() const;
+};
+
+// Entry point over a received payload, e.g.
+//   flat::View view(msg.buf(), msg.payloadSize(), msg.order());
+//   u64 free = view.at<flat::DriveView>(2).freeBytes();
+class View {
+public:
+    View(const u8 *buf, usize size, ByteOrder order);
+
+    // Header is complete and the offset table fits the payload.
+    [[nodiscard]] bool valid() const;
+    [[nodiscard]] ResponseType type() const;
+    [[nodiscard]] usize count() const;
+
+    // Record i, or an empty record if i or its offsets are out of range.
+    template <typename T>
+    [[nodiscard]] T at(usize i) const {
+        const u8 *data;
+        usize size;
+        if (!record(i, &data, &size)) return T();
+        return T(data, size, m_order);
+    }
+
+private:
+    const u8 *m_buf;
+    usize m_size;
+    ByteOrder m_order;
+
+    bool record(usize i, const u8 **data, usize *size) const;
+    [[nodiscard]] u32 offset(usize i) const;
+};
+}  // namespace proto::flat
+
+#endif
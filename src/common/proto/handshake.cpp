@@ -0,0 +1,224 @@
+#include "handshake.hpp"
+
+#include <bit>
+
+namespace proto {
+namespace {
+u32 allowedSecurityLevels = 0;
+
+// buf holds the packed size it starts with, so a context can be made of it.
+bool Fits(const u8 *buf, usize size) {
+    if (!buf || size < sizeof(usize)) {
+        return false;
+    }
+    usize packed = *reinterpret_cast<const usize *>(buf);
+    return packed >= sizeof(usize) && packed <= size;
+}
+
+bool PopFeatures(PackCtx *ctx, u32 *features) {
+    if (ctx->remaining() < sizeof(u32)) {
+        return false;
+    }
+    *features = ctx->pop<u32>();
+    return true;
+}
+
+// Copies out a byte array, false if the payload is shorter than its size
+// says.
+bool PopBytes(PackCtx *ctx, std::vector<u8> *res) {
+    if (ctx->remaining() < sizeof(usize)) {
+        return false;
+    }
+    usize left = ctx->remaining() - sizeof(usize);
+    usize size;
+    const u8 *view = ctx->popView<u8>(&size);
+    if (size > left) {
+        return false;
+    }
+    res->assign(view, view + size);
+    return true;
+}
+}  // namespace
+
+void AllowSecurityLevels(u32 levels) {
+    allowedSecurityLevels =
+        levels & (FEATURE_INTEGRITY_ONLY | FEATURE_PLAINTEXT);
+}
+
+bool ParseSecurityLevel(std::string_view name, u32 *levels) {
+    if (name == "aead") {
+        *levels = 0;
+    } else if (name == "mac") {
+        *levels = FEATURE_INTEGRITY_ONLY;
+    } else if (name == "none") {
+        *levels = FEATURE_INTEGRITY_ONLY | FEATURE_PLAINTEXT;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+u32 LocalFeatures() {
+    u32 features = FEATURE_COMPRESSION | allowedSecurityLevels;
+    if constexpr (std::endian::native == std::endian::little) {
+        features |= FEATURE_LITTLE_ENDIAN;
+    } else if constexpr (std::endian::native == std::endian::big) {
+        features |= FEATURE_BIG_ENDIAN;
+    }
+    if (encryption::g_instance) {
+        if (encryption::g_instance->Supports(encryption::CIPHER_AES_GCM)) {
+            features |= FEATURE_AES_GCM;
+        }
+        if (encryption::g_instance->Supports(
+                encryption::CIPHER_CHACHA20_POLY1305)) {
+            features |= FEATURE_CHACHA20_POLY1305;
+        }
+        if (encryption::g_instance->SupportsKeyAgreement()) {
+            features |= FEATURE_X25519;
+        }
+        if (encryption::g_instance->SupportsTickets()) {
+            features |= FEATURE_SESSION_TICKET;
+        }
+    }
+    return features;
+}
+
+u32 NegotiateFeatures(u32 remote) { return remote & LocalFeatures(); }
+
+ByteOrder NegotiatedByteOrder(u32 accepted) {
+    // Both peers only advertise their own byte order, so any endianness bit
+    // surviving the intersection means they share it.
+    if (NegotiateFeatures(accepted) &
+        (FEATURE_LITTLE_ENDIAN | FEATURE_BIG_ENDIAN)) {
+        return BYTE_ORDER_NATIVE;
+    }
+    return BYTE_ORDER_NETWORK;
+}
+
+encryption::Cipher NegotiatedCipher(u32 accepted) {
+    if (accepted & FEATURE_AES_GCM) {
+        return encryption::CIPHER_AES_GCM;
+    }
+    if (accepted & FEATURE_CHACHA20_POLY1305) {
+        return encryption::CIPHER_CHACHA20_POLY1305;
+    }
+    return encryption::CIPHER_AES_CBC;
+}
+
+MessageEncryption NegotiatedEncryption(u32 accepted) {
+    if (accepted & FEATURE_PLAINTEXT) {
+        return MESSAGE_ENCRYPTION_NONE;
+    }
+    if ((accepted & FEATURE_INTEGRITY_ONLY) &&
+        NegotiatedCipher(accepted) != encryption::CIPHER_AES_CBC) {
+        return MESSAGE_ENCRYPTION_INTEGRITY;
+    }
+    return MESSAGE_ENCRYPTION_SYMMETRIC;
+}
+
+std::unique_ptr<const u8[]> KeyRequest::pack(usize *size,
+                                             ByteOrder order) const {
+    PackCtx ctx(BYTE_ORDER_NETWORK);
+    ctx.push(features);
+    ctx.push(key.data(), key.size());
+    return ctx.pack(size);
+}
+
+KeyRequest::KeyRequest(u32 features, const u8 *key, usize key_size)
+    : features(features), key(key, key + key_size) {}
+
+KeyRequest::KeyRequest(const u8 *buf, usize size) {
+    valid = Fits(buf, size);
+    if (!valid) {
+        return;
+    }
+    PackCtx ctx(buf, BYTE_ORDER_NETWORK);
+    valid = PopFeatures(&ctx, &features) && PopBytes(&ctx, &key);
+}
+
+std::unique_ptr<const u8[]> KeyResponse::pack(usize *size,
+                                              ByteOrder order) const {
+    PackCtx ctx(BYTE_ORDER_NETWORK);
+    ctx.push(features);
+    ctx.push(key.data(), key.size());
+    if (features & FEATURE_SESSION_TICKET) {
+        ctx.push(ticket.data(), ticket.size());
+    }
+    return ctx.pack(size);
+}
+
+KeyResponse::KeyResponse(u32 features, const u8 *key, usize key_size,
+                         const u8 *ticket, usize ticket_size)
+    : features(features), key(key, key + key_size) {
+    if (ticket) {
+        this->ticket.assign(ticket, ticket + ticket_size);
+    }
+}
+
+KeyResponse::KeyResponse(const u8 *buf, usize size) {
+    valid = Fits(buf, size);
+    if (!valid) {
+        return;
+    }
+    PackCtx ctx(buf, BYTE_ORDER_NETWORK);
+    valid = PopFeatures(&ctx, &features) && PopBytes(&ctx, &key) &&
+            (!(features & FEATURE_SESSION_TICKET) || PopBytes(&ctx, &ticket));
+}
+
+std::unique_ptr<const u8[]> ResumeRequest::pack(usize *size,
+                                                ByteOrder order) const {
+    PackCtx ctx(BYTE_ORDER_NETWORK);
+    ctx.push(features);
+    ctx.push(ticket.data(), ticket.size());
+    ctx.push(random.data(), random.size());
+    return ctx.pack(size);
+}
+
+ResumeRequest::ResumeRequest(u32 features, const u8 *ticket,
+                             usize ticket_size, const u8 *random)
+    : features(features),
+      ticket(ticket, ticket + ticket_size),
+      random(random, random + encryption::RESUMPTION_RANDOM_SIZE) {}
+
+ResumeRequest::ResumeRequest(const u8 *buf, usize size) {
+    valid = Fits(buf, size);
+    if (!valid) {
+        return;
+    }
+    PackCtx ctx(buf, BYTE_ORDER_NETWORK);
+    valid = PopFeatures(&ctx, &features) && PopBytes(&ctx, &ticket) &&
+            PopBytes(&ctx, &random);
+}
+
+std::unique_ptr<const u8[]> ResumeResponse::pack(usize *size,
+                                                 ByteOrder order) const {
+    PackCtx ctx(BYTE_ORDER_NETWORK);
+    ctx.push(features);
+    ctx.push(random.data(), random.size());
+    ctx.push(ticket.data(), ticket.size());
+    return ctx.pack(size);
+}
+
+ResumeResponse::ResumeResponse(u32 features, const u8 *random,
+                               const u8 *ticket, usize ticket_size)
+    : features(features),
+      random(random, random + encryption::RESUMPTION_RANDOM_SIZE) {
+    if (ticket) {
+        this->ticket.assign(ticket, ticket + ticket_size);
+    }
+}
+
+ResumeResponse::ResumeResponse(const u8 *buf, usize size) {
+    valid = Fits(buf, size);
+    if (!valid) {
+        return;
+    }
+    PackCtx ctx(buf, BYTE_ORDER_NETWORK);
+    valid = PopFeatures(&ctx, &features) && PopBytes(&ctx, &random) &&
+            PopBytes(&ctx, &ticket);
+}
+
+bool ResumeResponse::accepted() const {
+    return valid && random.size() == encryption::RESUMPTION_RANDOM_SIZE;
+}
+}  // namespace proto
@@ -0,0 +1,144 @@
+#ifndef BSIT_3_HANDSHAKE_HPP
+#define BSIT_3_HANDSHAKE_HPP
+
+#include <string_view>
+#include <vector>
+
+#include "../alias.hpp"
+#include "encryption/encryption.hpp"
+#include "message.hpp"
+#include "packable.hpp"
+
+namespace proto {
+// Capabilities advertised by the client in MESSAGE_KEY_REQUEST. The server
+// answers with the subset it accepted in MESSAGE_KEY_RESPONSE and both sides
+// switch to the agreed settings for every message after the key exchange.
+enum HandshakeFeature : u32 {
+    FEATURE_LITTLE_ENDIAN = 1 << 0,
+    FEATURE_BIG_ENDIAN = 1 << 1,
+    FEATURE_COMPRESSION = 1 << 2,
+    // AEAD record layer, see encryption::EncryptionManager::SetCipher.
+    FEATURE_AES_GCM = 1 << 3,
+    FEATURE_CHACHA20_POLY1305 = 1 << 4,
+    // KeyResponse carries a session ticket, see ResumeRequest.
+    FEATURE_SESSION_TICKET = 1 << 5,
+    // The keys of KeyRequest and KeyResponse are X25519 public keys rather
+    // than an RSA public key and a wrapped session key.
+    FEATURE_X25519 = 1 << 6,
+    // Security levels below full encryption, see NegotiatedEncryption.
+    FEATURE_INTEGRITY_ONLY = 1 << 7,
+    FEATURE_PLAINTEXT = 1 << 8,
+};
+
+// Features supported by this build on this host.
+u32 LocalFeatures();
+
+// Lets this side agree to the levels in levels, FEATURE_INTEGRITY_ONLY and
+// FEATURE_PLAINTEXT, which are meant for trusted links such as loopback or
+// an encrypted overlay network. Nothing below full encryption is allowed by
+// default, on either side.
+void AllowSecurityLevels(u32 levels);
+
+// Levels for AllowSecurityLevels from the name of the lowest one: aead for
+// none below full encryption, mac or none. False for any other name.
+bool ParseSecurityLevel(std::string_view name, u32 *levels);
+
+// Subset of remote features this side agrees to use.
+u32 NegotiateFeatures(u32 remote);
+
+ByteOrder NegotiatedByteOrder(u32 accepted);
+
+// Cipher both sides switch to after the key exchange. AES-GCM wins when both
+// have hardware AES, CBC is kept when no AEAD cipher is shared.
+encryption::Cipher NegotiatedCipher(u32 accepted);
+
+// Protection of requests and responses. The weakest level both sides allow
+// wins; integrity-only needs an AEAD cipher and falls back to full
+// encryption without one. Receivers drop messages with any other protection.
+//
+// The feature bits travel in the clear and are not bound into the keys, so
+// anything on the path can pick any level both sides allow. Neither side
+// goes below what it allows itself: a rewritten bit the other side does not
+// share only makes the two disagree and the connection fail. Clients have
+// to opt into the weaker levels just like servers.
+MessageEncryption NegotiatedEncryption(u32 accepted);
+
+// Handshake messages are always packed in network byte order, since nothing
+// has been agreed on yet when they are sent. Nothing in them is
+// authenticated, so parsing checks every size against the size of the
+// payload and leaves valid false on anything that does not fit.
+//
+// The handshake version is picked by the client: with FEATURE_X25519 set in
+// KeyRequest::features the key is an ephemeral X25519 public key. A server
+// that accepts it answers with its own one, a server that does not answers
+// with an empty key and without the bit, and the client sends a KeyRequest
+// with its RSA public key over the same connection.
+struct KeyRequest : Packable {
+    u32 features = 0;
+    std::vector<u8> key;
+    bool valid = true;
+
+    std::unique_ptr<const u8[]> pack(usize *size,
+                                     ByteOrder order) const override;
+
+    KeyRequest(u32 features, const u8 *key, usize key_size);
+    KeyRequest(const u8 *buf, usize size);
+};
+
+// ticket is only on the wire if features has FEATURE_SESSION_TICKET, it may
+// still be empty if the server failed to issue one.
+struct KeyResponse : Packable {
+    u32 features = 0;
+    std::vector<u8> key;
+    std::vector<u8> ticket;
+    bool valid = true;
+
+    std::unique_ptr<const u8[]> pack(usize *size,
+                                     ByteOrder order) const override;
+
+    KeyResponse(u32 features, const u8 *key, usize key_size,
+                const u8 *ticket = nullptr, usize ticket_size = 0);
+    KeyResponse(const u8 *buf, usize size);
+};
+
+// Sent instead of KeyRequest by a client holding a ticket from an earlier
+// connection. Both sides derive a fresh session key from the secret in the
+// ticket and their randoms (see encryption::EncryptionManager), so no RSA
+// operation is needed on either side. The server rejects the ticket with an
+// empty ResumeResponse and the client then sends a KeyRequest over the same
+// connection.
+struct ResumeRequest : Packable {
+    u32 features = 0;
+    std::vector<u8> ticket;
+    std::vector<u8> random;
+    bool valid = true;
+
+    std::unique_ptr<const u8[]> pack(usize *size,
+                                     ByteOrder order) const override;
+
+    ResumeRequest(u32 features, const u8 *ticket, usize ticket_size,
+                  const u8 *random);
+    ResumeRequest(const u8 *buf, usize size);
+};
+
+// random is empty if the ticket was rejected. ticket replaces the one the
+// client presented.
+struct ResumeResponse : Packable {
+    u32 features = 0;
+    std::vector<u8> random;
+    std::vector<u8> ticket;
+    bool valid = true;
+
+    std::unique_ptr<const u8[]> pack(usize *size,
+                                     ByteOrder order) const override;
+
+    ResumeResponse() = default;
+    ResumeResponse(u32 features, const u8 *random, const u8 *ticket,
+                   usize ticket_size);
+    ResumeResponse(const u8 *buf, usize size);
+
+    [[nodiscard]] bool accepted() const;
+};
+}  // namespace proto
+
+#endif
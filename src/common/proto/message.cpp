@@ -1,51 +1,133 @@
 #include "message.hpp"
 
-#include <cassert>
 #include <cstring>
 
 #include "../logging.hpp"
 #include "../tcp_utils.hpp"
+#include "compression/compression.hpp"
 #include "encryption/encryption.hpp"
+#include "handshake.hpp"
 
 namespace proto {
+namespace {
+constexpr usize HEADER_SIZE = sizeof(usize) + sizeof(MessageType) +
+                              sizeof(MessageEncryption) + sizeof(MessageFlags);
+
+usize SizeToWire(usize size, ByteOrder order) {
+    return order == BYTE_ORDER_NATIVE ? size : utils::hton_generic(size);
+}
+
+usize SizeFromWire(usize size, ByteOrder order) {
+    return order == BYTE_ORDER_NATIVE ? size : utils::ntoh_generic(size);
+}
+
+// Whether the session adds up to encryption::MAX_OVERHEAD bytes.
+bool HasOverhead(MessageEncryption encryption) {
+    return encryption == MESSAGE_ENCRYPTION_SYMMETRIC ||
+           encryption == MESSAGE_ENCRYPTION_INTEGRITY;
+}
+}  // namespace
+
 Message::Message(Packable *p, MessageType type,
-                 MessageEncryption encryption_method, u32 cid)
-    : m_type(type), m_encryption(encryption_method), m_size(0) {
-    auto content_buf = p->pack(&m_size);
-
-    if (m_encryption == MESSAGE_ENCRYPTION_SYMMETRIC) {
-        INFO("Encrypting message using symmetric method");
-        DWORD encrypted_size;
-        auto encrypted = encryption::g_instance->Encrypt(
-            cid, content_buf.get(), m_size, &encrypted_size);
-        content_buf = std::move(encrypted);
-        m_size = encrypted_size;
+                 MessageEncryption encryption_method,
+                 encryption::Session *session, u32 features)
+    : m_type(type),
+      m_encryption(encryption_method),
+      m_order(NegotiatedByteOrder(features)),
+      m_size(0) {
+    usize content_size;
+    auto content_buf = p->pack(&content_size, m_order);
+    Seal(std::move(content_buf), content_size, session, features);
+}
+
+Message::Message(Response *resp, MessageEncryption encryption_method,
+                 encryption::Session *session, u32 features, usize frame_size,
+                 usize *cursor, ResponseLayout layout)
+    : m_type(MESSAGE_RESPONSE),
+      m_encryption(encryption_method),
+      m_order(NegotiatedByteOrder(features)),
+      m_size(0) {
+    usize max_payload = frame_size - HEADER_SIZE;
+    if (HasOverhead(m_encryption)) {
+        max_payload -= encryption::MAX_OVERHEAD;
     }
+    usize content_size;
+    auto content_buf =
+        resp->packChunk(&content_size, m_order, max_payload, cursor, layout);
+    if (*cursor < resp->entryCount() || resp->more) {
+        m_flags = MESSAGE_FLAG_CONTINUED;
+    }
+    if (layout == LAYOUT_FLAT) {
+        m_flags = static_cast<MessageFlags>(m_flags | MESSAGE_FLAG_FLAT);
+    }
+    Seal(std::move(content_buf), content_size, session, features);
+}
 
-    usize content_size = m_size;
+void Message::Seal(std::unique_ptr<const u8[]> content_buf, usize content_size,
+                   encryption::Session *session, u32 features) {
+    m_size = content_size;
+
+    if ((features & FEATURE_COMPRESSION) &&
+        m_size > compression::COMPRESSION_THRESHOLD) {
+        usize compressed_size;
+        auto compressed = compression::Compress(content_buf.get(), m_size,
+                                                &compressed_size);
+        if (compressed_size < m_size) {
+            INFO("Compressed message %llu -> %llu bytes", m_size,
+                 compressed_size);
+            content_buf = std::move(compressed);
+            m_size = compressed_size;
+            m_flags = static_cast<MessageFlags>(m_flags |
+                                                MESSAGE_FLAG_COMPRESSED);
+        }
+    }
 
-    m_size += sizeof(m_size);
-    m_size += sizeof(m_type);
-    m_size += sizeof(m_encryption);
+    // Leave room for the header in front and the cipher padding behind, so
+    // the payload is encrypted where it lies.
+    usize capacity = HEADER_SIZE + m_size;
+    if (HasOverhead(m_encryption)) {
+        capacity += encryption::MAX_OVERHEAD;
+    }
+    auto frame = std::make_unique_for_overwrite<u8[]>(capacity);
+    u8 *buf = frame.get() + sizeof(m_size);
+    buf[0] = m_type;
+    buf[1] = m_encryption;
+    buf[2] = m_flags;
+    u8 *payload = frame.get() + HEADER_SIZE;
+    std::memcpy(payload, content_buf.get(), m_size);
+
+    if (HasOverhead(m_encryption)) {
+        // The header after the size is authenticated by AEAD ciphers, the
+        // size itself is covered by the tag.
+        usize sealed_size = 0;
+        ERR err = ERR_InvalidArgument;
+        if (session && m_encryption == MESSAGE_ENCRYPTION_SYMMETRIC) {
+            INFO("Encrypting message using symmetric method");
+            err = session->Encrypt(payload, m_size, buf,
+                                   HEADER_SIZE - sizeof(m_size), &sealed_size);
+        } else if (session) {
+            INFO("Signing message");
+            err = session->Sign(payload, m_size, buf,
+                                HEADER_SIZE - sizeof(m_size), &sealed_size);
+        }
+        if (err != ERR_Ok) {
+            // Never let the plaintext out, the peer rejects the empty frame.
+            WARN("Failed to seal message: %s", errorText[err]);
+            sealed_size = 0;
+        }
+        m_size = sealed_size;
+    }
 
-    m_buf = std::make_unique<const u8[]>(m_size);
-    auto buf = const_cast<u8 *>(m_buf.get());
+    m_size += HEADER_SIZE;
 
-    *reinterpret_cast<usize *>(buf) = utils::ntoh_generic(m_size);
-    buf += sizeof(m_size);
-    *buf = m_type;
-    buf += sizeof(m_type);
-    *buf = m_encryption;
-    buf += sizeof(m_encryption);
-    std::memcpy(buf, content_buf.get(), content_size);
+    *reinterpret_cast<usize *>(frame.get()) = SizeToWire(m_size, m_order);
+    m_buf = std::move(frame);
 }
 
 Message::Message(MessageType type, const u8 *buf, usize size,
                  MessageEncryption encryption_method)
     : m_type(type), m_encryption(encryption_method), m_size(size) {
-    m_size += sizeof(m_size);
-    m_size += sizeof(m_type);
-    m_size += sizeof(m_encryption);
+    m_size += HEADER_SIZE;
     m_buf = std::make_unique<const u8[]>(m_size);
     auto tmp = const_cast<u8 *>(m_buf.get());
 
@@ -55,14 +137,18 @@ Message::Message(MessageType type, const u8 *buf, usize size,
     tmp += sizeof(m_type);
     *tmp = m_encryption;
     tmp += sizeof(m_encryption);
+    *tmp = m_flags;
+    tmp += sizeof(m_flags);
     std::memcpy(tmp, buf, size);
 }
 
-Message::Message(Request *req, MessageEncryption encryption_method, u32 cid)
-    : Message(req, MESSAGE_REQUEST, encryption_method, cid) {}
+Message::Message(Request *req, MessageEncryption encryption_method,
+                 encryption::Session *session, u32 features)
+    : Message(req, MESSAGE_REQUEST, encryption_method, session, features) {}
 
-Message::Message(Response *resp, MessageEncryption encryption_method, u32 cid)
-    : Message(resp, MESSAGE_RESPONSE, encryption_method, cid) {}
+Message::Message(Response *resp, MessageEncryption encryption_method,
+                 encryption::Session *session, u32 features)
+    : Message(resp, MESSAGE_RESPONSE, encryption_method, session, features) {}
 
 usize Message::size() const { return m_size; }
 
@@ -70,35 +156,90 @@ MessageType Message::type() const { return m_type; }
 
 const u8 *Message::buf() const { return m_buf.get(); }
 
-Message::Message(u32 cid, const u8 *buf) {
-    m_size = utils::ntoh_generic(*reinterpret_cast<const usize *>(buf));
+usize Message::payloadSize() const { return m_payloadSize; }
+
+ByteOrder Message::order() const { return m_order; }
+
+MessageFlags Message::flags() const { return m_flags; }
+
+Message::Message(encryption::Session *session, const u8 *buf, u32 features)
+    : m_order(NegotiatedByteOrder(features)) {
+    m_size = SizeFromWire(*reinterpret_cast<const usize *>(buf), m_order);
     INFO("Received Message of size %llu", m_size);
     utils::dump_memory(buf, MIN(m_size, MAX_MSG_SIZE));
-    assert(m_size <= MAX_MSG_SIZE);
+    // Left empty, the size would take the content past the frame.
+    if (m_size < HEADER_SIZE || m_size > MAX_MSG_SIZE) {
+        WARN("Invalid message size %llu", m_size);
+        return;
+    }
     buf += sizeof(m_size);
+    const u8 *aad = buf;
     m_type = static_cast<MessageType>(*buf);
     buf += sizeof(m_type);
     m_encryption = static_cast<MessageEncryption>(*buf);
     buf += sizeof(m_encryption);
+    m_flags = static_cast<MessageFlags>(*buf);
+    buf += sizeof(m_flags);
+
+    if ((m_type == MESSAGE_REQUEST || m_type == MESSAGE_RESPONSE) &&
+        m_encryption != NegotiatedEncryption(features)) {
+        WARN("Message protection %d does not match the negotiated one",
+             m_encryption);
+        return;
+    }
 
-    m_buf = std::make_unique<const u8[]>(m_size);
-    std::unique_ptr<const u8[]> decrypted;
-    if (m_encryption == MESSAGE_ENCRYPTION_SYMMETRIC) {
-        DWORD content_size =
-            m_size - sizeof(m_size) - sizeof(m_type) - sizeof(m_encryption);
-        DWORD decrypted_size;
-        decrypted = encryption::g_instance->Decrypt(
-            cid, buf, content_size, &decrypted_size);
-        buf = decrypted.get();
+    // One copy out of the receive buffer, decrypted in place.
+    usize content_size = m_size - HEADER_SIZE;
+    auto content = std::make_unique_for_overwrite<u8[]>(content_size);
+    std::memcpy(content.get(), buf, content_size);
+    if (HasOverhead(m_encryption)) {
+        ERR err = ERR_InvalidArgument;
+        if (session && m_encryption == MESSAGE_ENCRYPTION_SYMMETRIC) {
+            err = session->Decrypt(content.get(), content_size, aad,
+                                   HEADER_SIZE - sizeof(m_size),
+                                   &content_size);
+        } else if (session) {
+            err = session->Verify(content.get(), content_size, aad,
+                                  HEADER_SIZE - sizeof(m_size), &content_size);
+        }
+        if (err != ERR_Ok) {
+            WARN("Failed to open message: %s", errorText[err]);
+            return;
+        }
     }
-    std::memcpy(const_cast<u8 *>(m_buf.get()), buf, m_size);
+
+    if (m_flags & MESSAGE_FLAG_COMPRESSED) {
+        // Left empty on a corrupt block, callers check buf() before parsing.
+        m_buf = compression::Decompress(content.get(), content_size,
+                                        &content_size);
+        if (!m_buf) {
+            WARN("Failed to decompress message");
+            return;
+        }
+        m_payloadSize = content_size;
+        return;
+    }
+
+    m_buf = std::move(content);
+    m_payloadSize = content_size;
+}
+
+bool Message::ValidateBuff(const u8 *buf, usize size, u32 features) {
+    return size >= HEADER_SIZE && size <= MAX_MSG_SIZE &&
+           FrameSize(buf, features) == size;
 }
 
-bool Message::ValidateBuff(const u8 *buf, usize size) {
-    auto msg_size = utils::ntoh_generic(*reinterpret_cast<const usize *>(buf));
-    return msg_size == size;
+usize Message::FrameSize(const u8 *buf, u32 features) {
+    return SizeFromWire(*reinterpret_cast<const usize *>(buf),
+                        NegotiatedByteOrder(features));
 }
 
+usize Message::HeaderSize() { return HEADER_SIZE; }
+
+Message::Message(Message &&other) noexcept = default;
+
+Message &Message::operator=(Message &&other) noexcept = default;
+
 Message::~Message() = default;
 
 Message::Message() = default;
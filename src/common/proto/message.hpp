@@ -8,47 +8,98 @@
 #define MAX_MSG_SIZE 8192
 
 namespace proto {
+namespace encryption {
+class Session;
+}
 
 enum MessageType : u8 {
     MESSAGE_REQUEST,
     MESSAGE_RESPONSE,
     MESSAGE_KEY_REQUEST,
     MESSAGE_KEY_RESPONSE,
+    MESSAGE_RESUME_REQUEST,
+    MESSAGE_RESUME_RESPONSE,
 };
 
 enum MessageEncryption : u8 {
     MESSAGE_ENCRYPTION_SYMMETRIC,
     MESSAGE_ENCRYPTION_ASYMMETRIC,
     MESSAGE_ENCRYPTION_NONE,
+    // Authenticated but readable, see encryption::Session::Sign.
+    MESSAGE_ENCRYPTION_INTEGRITY,
+};
+
+enum MessageFlags : u8 {
+    MESSAGE_FLAG_NONE = 0,
+    // Payload was compressed before encryption, see compression.hpp.
+    MESSAGE_FLAG_COMPRESSED = 1 << 0,
+    // More frames of the same response follow this one.
+    MESSAGE_FLAG_CONTINUED = 1 << 1,
+    // Payload uses the flat response layout, see flat.hpp.
+    MESSAGE_FLAG_FLAT = 1 << 2,
 };
 
 class Message {
 public:
     Message();
-    explicit Message(u32 cid, const u8 *buf);
+    // features is the set negotiated during the key exchange (see
+    // handshake.hpp) and controls byte order, compression and the protection
+    // requests and responses must have. session is the cipher state of the
+    // connection, it may be null for messages that are neither encrypted nor
+    // signed.
+    explicit Message(encryption::Session *session, const u8 *buf,
+                     u32 features = 0);
 
     explicit Message(Request *req, MessageEncryption encryption_method,
-                     u32 cid);
+                     encryption::Session *session, u32 features = 0);
     explicit Message(Response *resp, MessageEncryption encryption_method,
-                     u32 cid);
+                     encryption::Session *session, u32 features = 0);
+    // Next frame of a streamed response, see Response::packChunk. The frame
+    // is at most frame_size bytes on the wire as long as a single entry fits.
+    // It is marked continued unless it holds the last entry of a response
+    // without Response::more.
+    Message(Response *resp, MessageEncryption encryption_method,
+            encryption::Session *session, u32 features, usize frame_size,
+            usize *cursor, ResponseLayout layout = LAYOUT_PACKED);
     Message(MessageType type, const u8 *buf, usize size,
             MessageEncryption encryption_method);
 
+    Message(Message &&other) noexcept;
+    Message &operator=(Message &&other) noexcept;
+
     ~Message();
 
     [[nodiscard]] MessageType type() const;
     [[nodiscard]] usize size() const;
     [[nodiscard]] const u8 *buf() const;
+    // Size of the decrypted and decompressed payload behind buf() of a
+    // received message.
+    [[nodiscard]] usize payloadSize() const;
+    [[nodiscard]] ByteOrder order() const;
+    [[nodiscard]] MessageFlags flags() const;
+
+    static bool ValidateBuff(const u8 *buf, usize size, u32 features = 0);
+
+    // Total frame size announced by a header, buf must hold at least
+    // sizeof(usize) bytes.
+    static usize FrameSize(const u8 *buf, u32 features = 0);
 
-    static bool ValidateBuff(const u8 *buf, usize size);
+    // Size of the fixed header preceding the payload.
+    static usize HeaderSize();
 
 private:
     explicit Message(Packable *p, MessageType type,
-                     MessageEncryption encryption_method, u32 cid);
+                     MessageEncryption encryption_method,
+                     encryption::Session *session, u32 features);
+    void Seal(std::unique_ptr<const u8[]> content_buf, usize content_size,
+              encryption::Session *session, u32 features);
     MessageType m_type;
     MessageEncryption m_encryption;
+    MessageFlags m_flags = MESSAGE_FLAG_NONE;
+    ByteOrder m_order = BYTE_ORDER_NETWORK;
     std::unique_ptr<const u8[]> m_buf{};
     usize m_size = 0;
+    usize m_payloadSize = 0;
 };
 
 }  // namespace proto
@@ -3,42 +3,58 @@
 
 #include <cstring>
 #include <memory>
+#include <memory_resource>
 
 #include "../alias.hpp"
 #include "../tcp_utils.hpp"
 
 namespace proto {
+// Byte order of multi-byte fields on the wire. Network (big-endian) order is
+// the default; native order is only used once both peers have agreed on it
+// during the key exchange (see handshake.hpp).
+enum ByteOrder : u8 {
+    BYTE_ORDER_NETWORK,
+    BYTE_ORDER_NATIVE,
+};
+
 struct Packable {
-    virtual std::unique_ptr<const u8[]> pack(usize *size) const = 0;
+    virtual std::unique_ptr<const u8[]> pack(usize *size,
+                                             ByteOrder order) const = 0;
 };
 
+// The working buffer comes from mem, so contexts built while serving a
+// request can live in its arena (see arena.hpp). Parsed containers should use
+// resource() for the same reason.
 class PackCtx {
 public:
-    PackCtx() {
+    explicit PackCtx(
+        ByteOrder order = BYTE_ORDER_NETWORK,
+        std::pmr::memory_resource *mem = std::pmr::get_default_resource())
+        : m_order(order), m_mem(mem) {
         m_size = sizeof(m_size);
-        m_tmp_buf_size = m_size;
-        m_tmp_buf = std::make_unique<u8[]>(m_size);
+        m_tmp_buf_size = INITIAL_SIZE;
+        m_tmp_buf = static_cast<u8 *>(m_mem->allocate(m_tmp_buf_size));
     }
 
-    PackCtx(const u8 *buf) {
+    explicit PackCtx(
+        const u8 *buf, ByteOrder order = BYTE_ORDER_NETWORK,
+        std::pmr::memory_resource *mem = std::pmr::get_default_resource())
+        : m_order(order), m_mem(mem) {
         m_size = *reinterpret_cast<const usize *>(buf);
-        m_tmp_buf = std::make_unique<u8[]>(m_size);
-        std::memcpy(m_tmp_buf.get(), buf, m_size);
+        m_tmp_buf_size = m_size;
+        m_tmp_buf = static_cast<u8 *>(m_mem->allocate(m_tmp_buf_size));
+        std::memcpy(m_tmp_buf, buf, m_size);
     }
 
-    ~PackCtx() = default;
+    PackCtx(const PackCtx &) = delete;
+    PackCtx &operator=(const PackCtx &) = delete;
+
+    ~PackCtx() { m_mem->deallocate(m_tmp_buf, m_tmp_buf_size); }
 
     template <typename T>
     void push(T val) {
-        while (m_size + sizeof(val) >= m_tmp_buf_size) {
-            usize old_size = m_tmp_buf_size;
-            m_tmp_buf_size *= 2;
-            auto tmp = std::make_unique<u8[]>(m_tmp_buf_size);
-            std::memcpy(tmp.get(), m_tmp_buf.get(), old_size);
-            m_tmp_buf = std::move(tmp);
-        }
-        *reinterpret_cast<T *>(m_tmp_buf.get() + m_size) =
-            utils::hton_generic(val);
+        reserve(sizeof(val));
+        *reinterpret_cast<T *>(m_tmp_buf + m_size) = toWire(val);
         m_size += sizeof(val);
     }
 
@@ -46,6 +62,12 @@ public:
     void push(T *val, usize size) {
         u32 count = size / sizeof(*val);
         push(size);
+        if (sizeof(*val) == 1 || m_order == BYTE_ORDER_NATIVE) {
+            reserve(size);
+            std::memcpy(m_tmp_buf + m_size, val, size);
+            m_size += size;
+            return;
+        }
         for (u32 i = 0; i < count; i++) {
             push(val[i]);
         }
@@ -54,7 +76,7 @@ public:
     std::unique_ptr<const u8[]> pack(usize *size) const {
         *size = m_size;
         auto res = std::make_unique<u8[]>(m_size);
-        std::memcpy(res.get(), m_tmp_buf.get(), m_size);
+        std::memcpy(res.get(), m_tmp_buf, m_size);
         *reinterpret_cast<usize *>(res.get()) = m_size;
 
         return res;
@@ -62,8 +84,8 @@ public:
 
     template <typename T>
     T pop() {
-        T res = utils::ntoh_generic(
-            *reinterpret_cast<T *>(m_tmp_buf.get() + m_pop_offset));
+        T res =
+            fromWire(*reinterpret_cast<T *>(m_tmp_buf + m_pop_offset));
         m_pop_offset += sizeof(T);
         return res;
     }
@@ -71,20 +93,74 @@ public:
     template <typename T>
     std::unique_ptr<T[]> pop(usize *size) {
         *size = pop<usize>();
-        auto ptr = reinterpret_cast<T *>(m_tmp_buf.get() + m_pop_offset);
+        auto ptr = reinterpret_cast<T *>(m_tmp_buf + m_pop_offset);
         m_pop_offset += *size;
         auto res = std::make_unique<T[]>(*size);
-        for (u64 i = 0; i < *size; i++) {
-            res[i] = utils::ntoh_generic(ptr[i]);
+        if (sizeof(T) == 1 || m_order == BYTE_ORDER_NATIVE) {
+            std::memcpy(res.get(), ptr, *size);
+            return res;
+        }
+        for (u64 i = 0; i < *size / sizeof(T); i++) {
+            res[i] = fromWire(ptr[i]);
         }
         return res;
     }
 
+    // Same as pop(usize *) for byte arrays, but points into the buffer
+    // instead of copying. Valid as long as the context.
+    template <typename T>
+        requires(sizeof(T) == 1)
+    const T *popView(usize *size) {
+        *size = pop<usize>();
+        auto ptr = reinterpret_cast<const T *>(m_tmp_buf + m_pop_offset);
+        m_pop_offset += *size;
+        return ptr;
+    }
+
+    // Bytes left to pop, 0 once a corrupt size has led past the end.
+    [[nodiscard]] usize remaining() const {
+        return m_pop_offset < m_size ? m_size - m_pop_offset : 0;
+    }
+
+    [[nodiscard]] ByteOrder order() const { return m_order; }
+
+    [[nodiscard]] std::pmr::memory_resource *resource() const { return m_mem; }
+
 private:
+    // Most responses fit without growing.
+    static constexpr usize INITIAL_SIZE = 256;
+
     usize m_size = 0;
     usize m_tmp_buf_size = 0;
     usize m_pop_offset = sizeof(m_size);
-    std::unique_ptr<u8[]> m_tmp_buf{};
+    u8 *m_tmp_buf = nullptr;
+    ByteOrder m_order = BYTE_ORDER_NETWORK;
+    std::pmr::memory_resource *m_mem;
+
+    void reserve(usize extra) {
+        if (m_size + extra < m_tmp_buf_size) return;
+        usize new_size = m_tmp_buf_size;
+        while (m_size + extra >= new_size) {
+            new_size *= 2;
+        }
+        auto tmp = static_cast<u8 *>(m_mem->allocate(new_size));
+        std::memcpy(tmp, m_tmp_buf, m_size);
+        m_mem->deallocate(m_tmp_buf, m_tmp_buf_size);
+        m_tmp_buf = tmp;
+        m_tmp_buf_size = new_size;
+    }
+
+    template <typename T>
+    T toWire(T val) const {
+        if (m_order == BYTE_ORDER_NATIVE) return val;
+        return utils::hton_generic(val);
+    }
+
+    template <typename T>
+    T fromWire(T val) const {
+        if (m_order == BYTE_ORDER_NATIVE) return val;
+        return utils::ntoh_generic(val);
+    }
 };
 }  // namespace proto
 
@@ -3,7 +3,12 @@
 namespace proto {
     Response *ParseResponse(Message *msg, ERR *err) {
         *err = ERR_Ok;
-        PackCtx ctx(msg->buf());
+        // Flat payloads are read in place through flat::View.
+        if (!msg->buf() || (msg->flags() & MESSAGE_FLAG_FLAT)) {
+            *err = ERR_Invalid_Response;
+            return nullptr;
+        }
+        PackCtx ctx(msg->buf(), msg->order());
         auto type = ctx.pop<ResponseType>();
         switch (type) {
             case RESP_OS_INFO:
@@ -18,6 +23,10 @@ namespace proto {
                 return new RightsResponse(&ctx, err);
             case RESP_OWNER:
                 return new OwnerResponse(&ctx, err);
+            case RESP_RIGHTS_BULK:
+                return new BulkRightsResponse(&ctx, err);
+            case RESP_OWNER_BULK:
+                return new BulkOwnerResponse(&ctx, err);
             default:
                 *err = ERR_Invalid_Response;
                 return nullptr;
@@ -1,34 +1,139 @@
 #include "request.hpp"
 
-#include "../str_utils.hpp"
+#include "../logging.hpp"
+#include "../utf/utf.hpp"
 
 namespace proto {
-std::unique_ptr<const u8[]> Request::pack(usize *size) const {
-    PackCtx ctx;
+namespace {
+// PackCtx size prefix, type, layout, depth and path count.
+constexpr usize BULK_HEADER_SIZE = sizeof(usize) + sizeof(RequestType) +
+                                   sizeof(ResponseLayout) + sizeof(u8) +
+                                   sizeof(usize);
+
+void PushPath(PackCtx *ctx, std::wstring_view path) {
+    // Always UTF-16 on the wire, whatever the size of wchar_t.
+    std::u16string utf16;
+    utils::utf::ToUtf16(path, &utf16, utils::utf::UTF_REPLACE);
+    ctx->push(utf16.data(), utf16.size() * sizeof(utf16[0]));
+}
+
+// False if the size of the path runs past the end of the frame.
+bool PopPath(PackCtx *ctx, std::pmr::wstring *path) {
+    if (ctx->remaining() < sizeof(usize)) return false;
+    usize left = ctx->remaining() - sizeof(usize);
+    usize size;
+    const u8 *bytes = ctx->popView<u8>(&size);
+    if (size > left) return false;
+    std::u16string_view utf16(reinterpret_cast<const char16_t *>(bytes),
+                              size / sizeof(char16_t));
+    // Decoded straight from the frame, unless the units need swapping first.
+    std::pmr::u16string swapped(ctx->resource());
+    if (ctx->order() != BYTE_ORDER_NATIVE) {
+        swapped.assign(utf16);
+        for (auto &unit : swapped) {
+            unit = utils::ntoh_generic(unit);
+        }
+        utf16 = swapped;
+    }
+    if (!utils::utf::ToWide(utf16, path, utils::utf::UTF_REPLACE)) {
+        WARN("Request argument is not valid UTF-16");
+    }
+    return true;
+}
+}  // namespace
+
+std::unique_ptr<const u8[]> Request::pack(usize *size,
+                                          ByteOrder order) const {
+    PackCtx ctx(order);
     ctx.push(type);
-    if (!arg.empty()) {
-        if constexpr (sizeof(wchar_t) == 4) {
-            std::u16string utf16_bytes = utils::make_u16string(arg);
-            ctx.push(utf16_bytes.data(),
-                     utf16_bytes.size() * sizeof(utf16_bytes[0]));
-        } else {
-            ctx.push(arg.data(), arg.size() * sizeof(arg[0]));
+    ctx.push(layout);
+    if (bulk()) {
+        ctx.push(depth);
+        ctx.push(static_cast<usize>(paths.size()));
+        for (const auto &path : paths) {
+            PushPath(&ctx, path);
         }
+    } else if (type == REQ_RIGHTS || type == REQ_OWNER) {
+        PushPath(&ctx, arg);
+    }
+    if (!filter.empty()) {
+        filter.push(&ctx);
     }
     return ctx.pack(size);
 }
 
 Request::Request(RequestType type) : type(type) {}
 
-Request::Request(RequestType type, std::wstring arg)
-    : type(type), arg(std::move(arg)) {}
+Request::Request(RequestType type, std::wstring_view arg)
+    : type(type), arg(arg) {}
 
-Request::Request(const u8 *buf) {
-    PackCtx ctx(buf);
+Request::Request(RequestType type, std::span<const std::wstring> paths,
+                 u8 depth)
+    : type(type), paths(paths.begin(), paths.end()), depth(depth) {}
+
+Request::Request(const u8 *buf, ByteOrder order,
+                 std::pmr::memory_resource *mem)
+    : arg(mem), paths(mem), filter(mem) {
+    PackCtx ctx(buf, order, mem);
     type = ctx.pop<RequestType>();
-    if (type != REQ_RIGHTS && type != REQ_OWNER) return;
-    usize arg_size;
-    auto wbuf = ctx.pop<wchar_t>(&arg_size);
-    arg.assign(wbuf.get(), arg_size / sizeof(wchar_t));
+    layout = ctx.pop<ResponseLayout>();
+    if (bulk()) {
+        if (ctx.remaining() < sizeof(depth) + sizeof(usize)) {
+            malformed = true;
+            return;
+        }
+        depth = ctx.pop<u8>();
+        // Every path takes at least its size prefix, so a larger count can
+        // only come from a corrupt frame, which runs out of paths first.
+        auto count = ctx.pop<usize>();
+        paths.reserve(MIN(count, MAX_REQUEST_SIZE / sizeof(usize)));
+        for (usize i = 0; i < count; i++) {
+            if (!PopPath(&ctx, &paths.emplace_back())) {
+                paths.clear();
+                malformed = true;
+                return;
+            }
+        }
+    } else if (type == REQ_RIGHTS || type == REQ_OWNER) {
+        if (!PopPath(&ctx, &arg)) {
+            malformed = true;
+            return;
+        }
+    }
+    // Requests without a filter end here.
+    if (ctx.remaining() > 0 &&
+        (!filter.pop(&ctx) || !filter.Compile(filterTarget()))) {
+        WARN("Invalid request filter, nothing matches");
+    }
+}
+
+bool Request::bulk() const {
+    return type == REQ_RIGHTS_BULK || type == REQ_OWNER_BULK;
+}
+
+FilterTarget Request::filterTarget() const {
+    switch (type) {
+        case REQ_DRIVES:
+            return FILTER_TARGET_DRIVE;
+        case REQ_RIGHTS:
+        case REQ_RIGHTS_BULK:
+            return FILTER_TARGET_ACE;
+        case REQ_OWNER_BULK:
+            return FILTER_TARGET_OWNER;
+        default:
+            return FILTER_TARGET_NONE;
+    }
+}
+
+usize Request::FitPaths(std::span<const std::wstring> paths, usize max_size) {
+    usize packed = BULK_HEADER_SIZE;
+    usize count = 0;
+    for (const auto &path : paths) {
+        // A wchar_t never takes more bytes in UTF-16 than in memory.
+        packed += sizeof(usize) + path.size() * sizeof(wchar_t);
+        if (packed > max_size) break;
+        count++;
+    }
+    return count;
 }
 }  // namespace proto
@@ -1,10 +1,20 @@
 #ifndef REQUESTS_HPP
 #define REQUESTS_HPP
 
+#include <memory_resource>
+#include <span>
 #include <string>
+#include <string_view>
+#include <vector>
 
 #include "../alias.hpp"
+#include "filter.hpp"
 #include "packable.hpp"
+#include "response.hpp"
+
+// Largest request frame a server reads. Bulk requests with more paths are
+// split by the client, see Request::FitPaths.
+#define MAX_REQUEST_SIZE 4096
 
 namespace proto {
 enum RequestType : u8 {
@@ -15,16 +25,44 @@ enum RequestType : u8 {
     REQ_DRIVES,
     REQ_RIGHTS,
     REQ_OWNER,
+    // Rights or owners of every path in Request::paths, streamed back as
+    // they are looked up.
+    REQ_RIGHTS_BULK,
+    REQ_OWNER_BULK,
 };
 
 struct Request : Packable {
     RequestType type;
-    std::wstring arg;
+    std::pmr::wstring arg;
+    ResponseLayout layout = LAYOUT_PACKED;
+    // Paths of a bulk request. Directories among them are expanded up to
+    // depth levels below, 0 queries the paths themselves only.
+    std::pmr::vector<std::pmr::wstring> paths;
+    u8 depth = 0;
+    // Entries of the response the client wants, compiled against
+    // filterTarget() when a server reads the request.
+    Filter filter;
+    // Set when a size in the frame runs past its end. Nothing after it is
+    // read, the request must not be served.
+    bool malformed = false;
 
-    std::unique_ptr<const u8[]> pack(usize *size) const override;
+    std::unique_ptr<const u8[]> pack(usize *size,
+                                     ByteOrder order) const override;
     explicit Request(RequestType type);
-    Request(RequestType type, std::wstring arg);
-    explicit Request(const u8 *buf);
+    Request(RequestType type, std::wstring_view arg);
+    Request(RequestType type, std::span<const std::wstring> paths, u8 depth);
+    // Strings, paths and filter of the request are allocated from mem.
+    explicit Request(
+        const u8 *buf, ByteOrder order = BYTE_ORDER_NETWORK,
+        std::pmr::memory_resource *mem = std::pmr::get_default_resource());
+
+    [[nodiscard]] bool bulk() const;
+    [[nodiscard]] FilterTarget filterTarget() const;
+
+    // Number of paths from the front of paths that fit a bulk request of at
+    // most max_size packed bytes without its filter. 0 if not even the first
+    // one does.
+    static usize FitPaths(std::span<const std::wstring> paths, usize max_size);
 };
 }  // namespace proto
 
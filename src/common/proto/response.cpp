@@ -5,10 +5,136 @@
 #include <utility>
 
 #include "../logging.hpp"
+#include "../utf/utf.hpp"
+#include "flat.hpp"
 
 namespace proto {
-std::unique_ptr<const u8[]>OsInfoResponse::pack(usize *size) const {
-    PackCtx ctx;
+namespace {
+// Bytes taken by the PackCtx size prefix, the response type and the entry
+// count of a list-shaped response.
+constexpr usize LIST_HEADER_SIZE =
+    sizeof(usize) + sizeof(ResponseType) + sizeof(usize);
+
+usize PackedSize(const DriveInfo &drive) {
+    return sizeof(drive.type) + sizeof(drive.free_bytes) + sizeof(usize) +
+           drive.name.size() * sizeof(drive.name[0]);
+}
+
+u8 WireType(const DriveInfo &drive) {
+    return drive.type | (drive.stale ? DRIVE_FLAG_STALE : 0);
+}
+
+usize PackedSize(const AccessControlEntry &entry) {
+    return sizeof(entry.accessMask) + sizeof(entry.aceType) +
+           sizeof(entry.scope) + sizeof(usize) + entry.sid.size();
+}
+
+usize PackedSize(const SharedAcl &acl) {
+    usize size = sizeof(acl.id) + sizeof(usize);
+    for (const auto &entry : acl.info.entries) {
+        size += PackedSize(entry);
+    }
+    return size;
+}
+
+usize PackedSize(const PathAclInfo &result) {
+    return sizeof(usize) + result.path.size() + sizeof(u8) +
+           sizeof(result.acl);
+}
+
+usize PackedSize(const PathOwnerInfo &result) {
+    return sizeof(usize) + result.path.size() + sizeof(u8) + sizeof(usize) +
+           result.info.ownerDomain.size() + sizeof(usize) +
+           result.info.ownerName.size() + sizeof(usize) +
+           result.info.sid.size();
+}
+
+// Names travel as UTF-8. Invalid ones are repaired into storage instead of
+// being handed to the caller as they are.
+std::string_view ValidName(std::string_view name, std::string *storage) {
+    if (utils::utf::ValidUtf8(name)) return name;
+    WARN("Name is not valid UTF-8");
+    std::u32string code_points;
+    utils::utf::ToUtf32(name, &code_points, utils::utf::UTF_REPLACE);
+    utils::utf::ToUtf8(code_points, storage);
+    return *storage;
+}
+
+void PushAce(PackCtx *ctx, const AccessControlEntry &entry) {
+    ctx->push(entry.accessMask);
+    ctx->push(entry.aceType);
+    ctx->push(entry.scope);
+    ctx->push(entry.sid.data(), entry.sid.size());
+}
+
+AccessControlEntry PopAce(PackCtx *ctx) {
+    AccessControlEntry entry{};
+    entry.accessMask = ctx->pop<u32>();
+    entry.aceType = ctx->pop<AceType>();
+    entry.scope = ctx->pop<Scope>();
+    usize sid_size;
+    auto sid = ctx->popView<u8>(&sid_size);
+    std::memcpy(entry.sid.data(), sid, MIN(sid_size, entry.sid.size()));
+    return entry;
+}
+
+void PutAce(flat::Builder *builder, const AccessControlEntry &entry) {
+    builder->put(entry.accessMask);
+    builder->put(entry.aceType);
+    builder->put(entry.scope);
+    builder->putBytes(entry.sid.data(), entry.sid.size());
+}
+
+// Returns the end of the longest run of the count entries starting at first
+// whose packed size, as told by packed_size(i), stays within max_size after
+// header bytes. Always takes at least one entry so a stream can not stall on
+// an oversized one.
+template <typename F>
+usize FitEntries(usize count, usize first, usize max_size, usize header,
+                 F &&packed_size) {
+    usize packed = header;
+    usize last = first;
+    while (last < count) {
+        packed += packed_size(last);
+        if (packed > max_size && last > first) break;
+        last++;
+    }
+    return last;
+}
+
+template <typename Entries>
+usize FitEntries(const Entries &entries, usize first, usize max_size) {
+    return FitEntries(entries.size(), first, max_size, LIST_HEADER_SIZE,
+                      [&](usize i) { return PackedSize(entries[i]); });
+}
+}  // namespace
+
+std::unique_ptr<const u8[]> Response::packChunk(usize *size, ByteOrder order,
+                                                usize max_size, usize *cursor,
+                                                ResponseLayout layout) const {
+    *cursor = entryCount();
+    if (layout == LAYOUT_FLAT) {
+        return packFlatRange(size, order, 0, *cursor);
+    }
+    return pack(size, order);
+}
+
+std::unique_ptr<const u8[]> Response::packFlatRange(usize *size,
+                                                    ByteOrder order,
+                                                    usize first,
+                                                    usize last) const {
+    flat::Builder builder(order, mem);
+    packFlat(&builder, first, last);
+    return builder.finish(size);
+}
+
+usize Response::entryCount() const { return 1; }
+
+ERR Response::append(const Response &part) { return ERR_Invalid_Response; }
+
+std::unique_ptr<const u8[]>OsInfoResponse::pack(usize *size,
+                                                ByteOrder order) const {
+    PackCtx ctx(order, mem);
     ctx.push(RESP_OS_INFO);
     ctx.push(info.type);
     ctx.push(info.version.major);
@@ -17,17 +143,29 @@ std::unique_ptr<const u8[]>OsInfoResponse::pack(usize *size) const {
     return ctx.pack(size);
 }
 
-OsInfoResponse::OsInfoResponse(PackCtx *ctx, ERR *err) {
+void OsInfoResponse::packFlat(flat::Builder *builder, usize first,
+                              usize last) const {
+    builder->begin(RESP_OS_INFO, 1);
+    builder->record();
+    builder->put(info.type);
+    builder->put(info.version.major);
+    builder->put(info.version.minor);
+}
+
+OsInfoResponse::OsInfoResponse(PackCtx *ctx, ERR *err)
+    : Response(ctx->resource()) {
     info.type = ctx->pop<OSType>();
     info.version.major = ctx->pop<u16>();
     info.version.minor = ctx->pop<u16>();
     *err = ERR_Ok;
 }
 
-OsInfoResponse::OsInfoResponse(OSInfo info) : info(info) {}
+OsInfoResponse::OsInfoResponse(OSInfo info, std::pmr::memory_resource *mem)
+    : Response(mem), info(info) {}
 
-std::unique_ptr<const u8[]>TimeResponse::pack(usize *size) const {
-    PackCtx ctx;
+std::unique_ptr<const u8[]>TimeResponse::pack(usize *size,
+                                              ByteOrder order) const {
+    PackCtx ctx(order, mem);
     ctx.push(RESP_TIME);
     ctx.push(time_ms);
     ctx.push(time_zone);
@@ -35,44 +173,101 @@ std::unique_ptr<const u8[]>TimeResponse::pack(usize *size) const {
     return ctx.pack(size);
 }
 
-TimeResponse::TimeResponse(PackCtx *ctx, ERR *err) {
+void TimeResponse::packFlat(flat::Builder *builder, usize first,
+                            usize last) const {
+    builder->begin(RESP_TIME, 1);
+    builder->record();
+    builder->put(time_ms);
+    builder->put(time_zone);
+}
+
+TimeResponse::TimeResponse(PackCtx *ctx, ERR *err)
+    : Response(ctx->resource()) {
     time_ms = ctx->pop<u64>();
     time_zone = ctx->pop<i8>();
 
     *err = ERR_Ok;
 }
 
-TimeResponse::TimeResponse(u64 time, i8 time_zone)
-    : time_ms(time), time_zone(time_zone) {}
+TimeResponse::TimeResponse(u64 time, i8 time_zone,
+                           std::pmr::memory_resource *mem)
+    : Response(mem), time_ms(time), time_zone(time_zone) {}
 
-std::unique_ptr<const u8[]>DrivesResponse::pack(usize *size) const {
-    PackCtx ctx;
+std::unique_ptr<const u8[]>DrivesResponse::pack(usize *size,
+                                                ByteOrder order) const {
+    usize cursor = 0;
+    return packChunk(size, order, usize_max, &cursor, LAYOUT_PACKED);
+}
+
+std::unique_ptr<const u8[]> DrivesResponse::packChunk(
+    usize *size, ByteOrder order, usize max_size, usize *cursor,
+    ResponseLayout layout) const {
+    // Flat entries are never larger than packed ones, so the packed sizes
+    // bound both layouts.
+    usize last = FitEntries(drives, *cursor, max_size);
+    if (layout == LAYOUT_FLAT) {
+        auto res = packFlatRange(size, order, *cursor, last);
+        *cursor = last;
+        return res;
+    }
+    PackCtx ctx(order, mem);
     ctx.push(RESP_DRIVES);
-    ctx.push(static_cast<usize>(drives.size()));
-    for (const auto &drive : drives) {
-        ctx.push(drive.type);
+    ctx.push(static_cast<usize>(last - *cursor));
+    for (usize i = *cursor; i < last; i++) {
+        const auto &drive = drives[i];
+        ctx.push(WireType(drive));
         ctx.push(drive.free_bytes);
         ctx.push(drive.name.data(), drive.name.size() * sizeof(drive.name[0]));
     }
+    *cursor = last;
 
     return ctx.pack(size);
 }
 
-DrivesResponse::DrivesResponse(PackCtx *ctx, ERR *err) {
+void DrivesResponse::packFlat(flat::Builder *builder, usize first,
+                              usize last) const {
+    builder->begin(RESP_DRIVES, last - first);
+    for (usize i = first; i < last; i++) {
+        const auto &drive = drives[i];
+        builder->record();
+        builder->put(drive.free_bytes);
+        builder->put(WireType(drive));
+        builder->putBytes(drive.name.data(),
+                          drive.name.size() * sizeof(drive.name[0]));
+    }
+}
+
+usize DrivesResponse::entryCount() const { return drives.size(); }
+
+ERR DrivesResponse::append(const Response &part) {
+    auto drives_part = dynamic_cast<const DrivesResponse *>(&part);
+    if (!drives_part) return ERR_Invalid_Response;
+    drives.insert(drives.end(), drives_part->drives.begin(),
+                  drives_part->drives.end());
+    return ERR_Ok;
+}
+
+DrivesResponse::DrivesResponse(PackCtx *ctx, ERR *err)
+    : Response(ctx->resource()), drives(ctx->resource()) {
     auto count = ctx->pop<usize>();
     INFO("Parsing DrivesResponse");
     INFO("Drives count: %llu", count);
+    drives.reserve(count);
     for (u64 i = 0; i < count; i++) {
-        DriveInfo di;
-        di.type = ctx->pop<DriveType>();
-        INFO("Drive type: %d", di.type);
-        di.free_bytes = ctx->pop<u64>();
-        INFO("Free bytes: %llu", di.free_bytes);
+        auto wire_type = ctx->pop<u8>();
+        auto type = static_cast<DriveType>(wire_type & ~DRIVE_FLAG_STALE);
+        INFO("Drive type: %d", type);
+        auto free_bytes = ctx->pop<u64>();
+        INFO("Free bytes: %llu", free_bytes);
         usize name_size;
-        auto name = ctx->pop<char>(&name_size);
-        INFO("Name: %s", name.get());
+        auto name = ctx->popView<char>(&name_size);
+        INFO("Name: %.*s", static_cast<int>(name_size), name);
         /*#ifdef _WIN32*/
-        di.name.assign(name.get(), name_size);
+        std::string repaired;
+        drives.emplace_back(
+            type, ValidName(std::string_view(name, name_size), &repaired),
+            free_bytes);
+        drives.back().stale = wire_type & DRIVE_FLAG_STALE;
         OKAY("Assigned name");
         /*#else*/
         /*        std::wstring_convert<std::codecvt_utf16<char32_t>, char32_t>
@@ -83,17 +278,18 @@ DrivesResponse::DrivesResponse(PackCtx *ctx, ERR *err) {
         /*            u16_bytes, u16_bytes + name_size * sizeof(char16_t));*/
         /*        di.name = std::string(u32_str.begin(), u32_str.end());*/
         /*#endif*/
-        drives.push_back(di);
     }
 
     *err = ERR_Ok;
 }
 
-DrivesResponse::DrivesResponse(const std::vector<DriveInfo> &drives)
-    : drives(drives) {}
+DrivesResponse::DrivesResponse(std::span<const DriveInfo> drives,
+                               std::pmr::memory_resource *mem)
+    : Response(mem), drives(drives.begin(), drives.end(), mem) {}
 
-std::unique_ptr<const u8[]>MemoryResponse::pack(usize *size) const {
-    PackCtx ctx;
+std::unique_ptr<const u8[]>MemoryResponse::pack(usize *size,
+                                                ByteOrder order) const {
+    PackCtx ctx(order, mem);
     ctx.push(RESP_MEMORY);
     ctx.push(mem_info.free_bytes);
     ctx.push(mem_info.total_bytes);
@@ -101,50 +297,95 @@ std::unique_ptr<const u8[]>MemoryResponse::pack(usize *size) const {
     return ctx.pack(size);
 }
 
-MemoryResponse::MemoryResponse(PackCtx *ctx, ERR *err) {
+void MemoryResponse::packFlat(flat::Builder *builder, usize first,
+                              usize last) const {
+    builder->begin(RESP_MEMORY, 1);
+    builder->record();
+    builder->put(mem_info.total_bytes);
+    builder->put(mem_info.free_bytes);
+}
+
+MemoryResponse::MemoryResponse(PackCtx *ctx, ERR *err)
+    : Response(ctx->resource()) {
     mem_info.free_bytes = ctx->pop<u64>();
     mem_info.total_bytes = ctx->pop<u64>();
 
     *err = ERR_Ok;
 }
 
-MemoryResponse::MemoryResponse(MemInfo mem_info) : mem_info(mem_info) {}
+MemoryResponse::MemoryResponse(MemInfo mem_info,
+                               std::pmr::memory_resource *mem)
+    : Response(mem), mem_info(mem_info) {}
+
+std::unique_ptr<const u8[]>RightsResponse::pack(usize *size,
+                                                ByteOrder order) const {
+    usize cursor = 0;
+    return packChunk(size, order, usize_max, &cursor, LAYOUT_PACKED);
+}
 
-std::unique_ptr<const u8[]>RightsResponse::pack(usize *size) const {
-    PackCtx ctx;
+std::unique_ptr<const u8[]> RightsResponse::packChunk(
+    usize *size, ByteOrder order, usize max_size, usize *cursor,
+    ResponseLayout layout) const {
+    const auto &entries = rights_info.entries;
+    usize last = FitEntries(entries, *cursor, max_size);
+    if (layout == LAYOUT_FLAT) {
+        auto res = packFlatRange(size, order, *cursor, last);
+        *cursor = last;
+        return res;
+    }
+    PackCtx ctx(order, mem);
     ctx.push(RESP_RIGHTS);
-    ctx.push(static_cast<usize>(rights_info.entries.size()));
-    for (const auto &entry : rights_info.entries) {
-        ctx.push(entry.accessMask);
-        ctx.push(entry.aceType);
-        ctx.push(entry.scope);
-        ctx.push(entry.sid.data(), entry.sid.size());
+    ctx.push(static_cast<usize>(last - *cursor));
+    for (usize i = *cursor; i < last; i++) {
+        PushAce(&ctx, entries[i]);
     }
+    *cursor = last;
 
     return ctx.pack(size);
 }
 
-RightsResponse::RightsResponse(PackCtx *ctx, ERR *err) {
+void RightsResponse::packFlat(flat::Builder *builder, usize first,
+                              usize last) const {
+    const auto &entries = rights_info.entries;
+    builder->begin(RESP_RIGHTS, last - first);
+    for (usize i = first; i < last; i++) {
+        builder->record();
+        PutAce(builder, entries[i]);
+    }
+}
+
+usize RightsResponse::entryCount() const { return rights_info.entries.size(); }
+
+ERR RightsResponse::append(const Response &part) {
+    auto rights_part = dynamic_cast<const RightsResponse *>(&part);
+    if (!rights_part) return ERR_Invalid_Response;
+    const auto &entries = rights_part->rights_info.entries;
+    rights_info.entries.insert(rights_info.entries.end(), entries.begin(),
+                               entries.end());
+    return ERR_Ok;
+}
+
+RightsResponse::RightsResponse(PackCtx *ctx, ERR *err)
+    : Response(ctx->resource()),
+      rights_info{std::pmr::vector<AccessControlEntry>(ctx->resource())} {
     auto count = ctx->pop<usize>();
+    rights_info.entries.reserve(count);
     for (u64 i = 0; i < count; i++) {
-        AccessControlEntry entry{};
-        entry.accessMask = ctx->pop<u32>();
-        entry.aceType = ctx->pop<AceType>();
-        entry.scope = ctx->pop<Scope>();
-        usize sid_size;
-        auto sid = ctx->pop<u8>(&sid_size);
-        std::memcpy(entry.sid.data(), sid.get(), entry.sid.size());
-        rights_info.entries.push_back(entry);
+        rights_info.entries.push_back(PopAce(ctx));
     }
 
     *err = ERR_Ok;
 }
 
-RightsResponse::RightsResponse(AccessRightsInfo rights_info)
-    : rights_info(std::move(rights_info)) {}
+RightsResponse::RightsResponse(const AccessRightsInfo &rights_info,
+                               std::pmr::memory_resource *mem)
+    : Response(mem),
+      rights_info{std::pmr::vector<AccessControlEntry>(
+          rights_info.entries.begin(), rights_info.entries.end(), mem)} {}
 
-std::unique_ptr<const u8[]>OwnerResponse::pack(usize *size) const {
-    PackCtx ctx;
+std::unique_ptr<const u8[]>OwnerResponse::pack(usize *size,
+                                               ByteOrder order) const {
+    PackCtx ctx(order, mem);
     ctx.push(RESP_OWNER);
     ctx.push(info.ownerDomain.data(), info.ownerDomain.size());
     ctx.push(info.ownerName.data(), info.ownerName.size());
@@ -153,18 +394,261 @@ std::unique_ptr<const u8[]>OwnerResponse::pack(usize *size) const {
     return ctx.pack(size);
 }
 
-OwnerResponse::OwnerResponse(PackCtx *ctx, ERR *err) {
+void OwnerResponse::packFlat(flat::Builder *builder, usize first,
+                             usize last) const {
+    builder->begin(RESP_OWNER, 1);
+    builder->record();
+    builder->putBytes(info.sid.data(), info.sid.size());
+    builder->put(static_cast<u32>(info.ownerName.size()));
+    builder->putBytes(info.ownerName.data(), info.ownerName.size());
+    builder->putBytes(info.ownerDomain.data(), info.ownerDomain.size());
+}
+
+OwnerResponse::OwnerResponse(PackCtx *ctx, ERR *err)
+    : Response(ctx->resource()) {
     usize name_size;
-    auto domainName = ctx->pop<char>(&name_size);
-    info.ownerDomain.assign(domainName.get(), name_size);
-    auto name = ctx->pop<char>(&name_size);
-    info.ownerName.assign(name.get(), name_size);
+    std::string repaired;
+    auto domainName = ctx->popView<char>(&name_size);
+    info.ownerDomain = ValidName({domainName, name_size}, &repaired);
+    auto name = ctx->popView<char>(&name_size);
+    info.ownerName = ValidName({name, name_size}, &repaired);
     usize sid_size;
-    auto sid = ctx->pop<u8>(&sid_size);
-    std::memcpy(info.sid.data(), sid.get(), sid_size);
+    auto sid = ctx->popView<u8>(&sid_size);
+    std::memcpy(info.sid.data(), sid, MIN(sid_size, info.sid.size()));
+
+    *err = ERR_Ok;
+}
+
+OwnerResponse::OwnerResponse(OwnerInfo info, std::pmr::memory_resource *mem)
+    : Response(mem), info(std::move(info)) {}
+
+std::unique_ptr<const u8[]> BulkRightsResponse::pack(usize *size,
+                                                     ByteOrder order) const {
+    usize cursor = 0;
+    return packChunk(size, order, usize_max, &cursor, LAYOUT_PACKED);
+}
+
+std::unique_ptr<const u8[]> BulkRightsResponse::packChunk(
+    usize *size, ByteOrder order, usize max_size, usize *cursor,
+    ResponseLayout layout) const {
+    usize last = FitEntries(
+        entryCount(), *cursor, max_size, LIST_HEADER_SIZE + sizeof(usize),
+        [this](usize i) {
+            return i < acls.size() ? PackedSize(acls[i])
+                                   : PackedSize(results[i - acls.size()]);
+        });
+    if (layout == LAYOUT_FLAT) {
+        auto res = packFlatRange(size, order, *cursor, last);
+        *cursor = last;
+        return res;
+    }
+    // Split [*cursor, last) into its ACLs and its paths.
+    usize acl_first = MIN(*cursor, acls.size());
+    usize acl_last = MIN(last, acls.size());
+    usize result_first = *cursor - acl_first;
+    usize result_last = last - acl_last;
+
+    PackCtx ctx(order, mem);
+    ctx.push(RESP_RIGHTS_BULK);
+    ctx.push(static_cast<usize>(acl_last - acl_first));
+    for (usize i = acl_first; i < acl_last; i++) {
+        const auto &acl = acls[i];
+        ctx.push(acl.id);
+        ctx.push(static_cast<usize>(acl.info.entries.size()));
+        for (const auto &entry : acl.info.entries) {
+            PushAce(&ctx, entry);
+        }
+    }
+    ctx.push(static_cast<usize>(result_last - result_first));
+    for (usize i = result_first; i < result_last; i++) {
+        const auto &result = results[i];
+        ctx.push(result.path.data(), result.path.size());
+        ctx.push(result.err);
+        ctx.push(result.acl);
+    }
+    *cursor = last;
+
+    return ctx.pack(size);
+}
+
+void BulkRightsResponse::packFlat(flat::Builder *builder, usize first,
+                                  usize last) const {
+    builder->begin(RESP_RIGHTS_BULK, last - first);
+    for (usize i = first; i < last; i++) {
+        builder->record();
+        if (i < acls.size()) {
+            const auto &acl = acls[i];
+            builder->put(flat::BULK_RECORD_ACL);
+            builder->put(acl.id);
+            for (const auto &entry : acl.info.entries) {
+                PutAce(builder, entry);
+            }
+            continue;
+        }
+        const auto &result = results[i - acls.size()];
+        builder->put(flat::BULK_RECORD_PATH);
+        builder->put(result.err);
+        builder->put(result.acl);
+        builder->putBytes(result.path.data(), result.path.size());
+    }
+}
+
+usize BulkRightsResponse::entryCount() const {
+    return acls.size() + results.size();
+}
+
+ERR BulkRightsResponse::append(const Response &part) {
+    auto bulk_part = dynamic_cast<const BulkRightsResponse *>(&part);
+    if (!bulk_part) return ERR_Invalid_Response;
+    acls.insert(acls.end(), bulk_part->acls.begin(), bulk_part->acls.end());
+    results.insert(results.end(), bulk_part->results.begin(),
+                   bulk_part->results.end());
+    return ERR_Ok;
+}
+
+void BulkRightsResponse::resolve(std::vector<PathRightsInfo> *res) const {
+    // Ids are dense, but do not trust the peer with the size of the index.
+    std::vector<const AccessRightsInfo *> index;
+    for (const auto &acl : acls) {
+        if (acl.id >= acls.size()) continue;
+        if (acl.id >= index.size()) index.resize(acl.id + 1);
+        index[acl.id] = &acl.info;
+    }
+    res->reserve(res->size() + results.size());
+    for (const auto &result : results) {
+        PathRightsInfo info{result.path, result.err};
+        const AccessRightsInfo *acl =
+            result.acl < index.size() ? index[result.acl] : nullptr;
+        if (acl) {
+            info.info.entries.assign(acl->entries.begin(), acl->entries.end());
+        } else if (info.err == ERR_Ok) {
+            info.err = ERR_Invalid_Response;
+        }
+        res->push_back(std::move(info));
+    }
+}
+
+BulkRightsResponse::BulkRightsResponse(PackCtx *ctx, ERR *err)
+    : Response(ctx->resource()),
+      acls(ctx->resource()),
+      results(ctx->resource()) {
+    auto count = ctx->pop<usize>();
+    acls.resize(count);
+    for (auto &acl : acls) {
+        acl.id = ctx->pop<u32>();
+        auto entries = ctx->pop<usize>();
+        acl.info.entries.reserve(entries);
+        for (usize i = 0; i < entries; i++) {
+            acl.info.entries.push_back(PopAce(ctx));
+        }
+    }
+    count = ctx->pop<usize>();
+    results.resize(count);
+    for (auto &result : results) {
+        usize path_size;
+        std::string repaired;
+        auto path = ctx->popView<char>(&path_size);
+        result.path = ValidName({path, path_size}, &repaired);
+        result.err = ctx->pop<ERR>();
+        result.acl = ctx->pop<u32>();
+    }
+
+    *err = ERR_Ok;
+}
+
+BulkRightsResponse::BulkRightsResponse(std::vector<SharedAcl> acls,
+                                       std::vector<PathAclInfo> results,
+                                       std::pmr::memory_resource *mem)
+    : Response(mem),
+      acls(std::make_move_iterator(acls.begin()),
+           std::make_move_iterator(acls.end()), mem),
+      results(std::make_move_iterator(results.begin()),
+              std::make_move_iterator(results.end()), mem) {}
+
+std::unique_ptr<const u8[]> BulkOwnerResponse::pack(usize *size,
+                                                    ByteOrder order) const {
+    usize cursor = 0;
+    return packChunk(size, order, usize_max, &cursor, LAYOUT_PACKED);
+}
+
+std::unique_ptr<const u8[]> BulkOwnerResponse::packChunk(
+    usize *size, ByteOrder order, usize max_size, usize *cursor,
+    ResponseLayout layout) const {
+    usize last = FitEntries(results, *cursor, max_size);
+    if (layout == LAYOUT_FLAT) {
+        auto res = packFlatRange(size, order, *cursor, last);
+        *cursor = last;
+        return res;
+    }
+    PackCtx ctx(order, mem);
+    ctx.push(RESP_OWNER_BULK);
+    ctx.push(static_cast<usize>(last - *cursor));
+    for (usize i = *cursor; i < last; i++) {
+        const auto &result = results[i];
+        const auto &info = result.info;
+        ctx.push(result.path.data(), result.path.size());
+        ctx.push(result.err);
+        ctx.push(info.ownerDomain.data(), info.ownerDomain.size());
+        ctx.push(info.ownerName.data(), info.ownerName.size());
+        ctx.push(info.sid.data(), info.sid.size());
+    }
+    *cursor = last;
+
+    return ctx.pack(size);
+}
+
+void BulkOwnerResponse::packFlat(flat::Builder *builder, usize first,
+                                 usize last) const {
+    builder->begin(RESP_OWNER_BULK, last - first);
+    for (usize i = first; i < last; i++) {
+        const auto &result = results[i];
+        const auto &info = result.info;
+        builder->record();
+        builder->put(result.err);
+        builder->putBytes(info.sid.data(), info.sid.size());
+        builder->put(static_cast<u32>(result.path.size()));
+        builder->put(static_cast<u32>(info.ownerName.size()));
+        builder->putBytes(result.path.data(), result.path.size());
+        builder->putBytes(info.ownerName.data(), info.ownerName.size());
+        builder->putBytes(info.ownerDomain.data(), info.ownerDomain.size());
+    }
+}
+
+usize BulkOwnerResponse::entryCount() const { return results.size(); }
+
+ERR BulkOwnerResponse::append(const Response &part) {
+    auto bulk_part = dynamic_cast<const BulkOwnerResponse *>(&part);
+    if (!bulk_part) return ERR_Invalid_Response;
+    results.insert(results.end(), bulk_part->results.begin(),
+                   bulk_part->results.end());
+    return ERR_Ok;
+}
+
+BulkOwnerResponse::BulkOwnerResponse(PackCtx *ctx, ERR *err)
+    : Response(ctx->resource()), results(ctx->resource()) {
+    auto count = ctx->pop<usize>();
+    results.resize(count);
+    for (auto &result : results) {
+        usize size;
+        std::string repaired;
+        auto path = ctx->popView<char>(&size);
+        result.path = ValidName({path, size}, &repaired);
+        result.err = ctx->pop<ERR>();
+        auto domain = ctx->popView<char>(&size);
+        result.info.ownerDomain = ValidName({domain, size}, &repaired);
+        auto name = ctx->popView<char>(&size);
+        result.info.ownerName = ValidName({name, size}, &repaired);
+        auto sid = ctx->popView<u8>(&size);
+        std::memcpy(result.info.sid.data(), sid,
+                    MIN(size, result.info.sid.size()));
+    }
 
     *err = ERR_Ok;
 }
 
-OwnerResponse::OwnerResponse(OwnerInfo info) : info(std::move(info)) {}
+BulkOwnerResponse::BulkOwnerResponse(std::vector<PathOwnerInfo> results,
+                                     std::pmr::memory_resource *mem)
+    : Response(mem),
+      results(std::make_move_iterator(results.begin()),
+              std::make_move_iterator(results.end()), mem) {}
 }  // namespace proto
@@ -1,12 +1,19 @@
 #ifndef RESPONSE_HPP
 #define RESPONSE_HPP
 
+#include <memory_resource>
+#include <span>
+
 #include "../alias.hpp"
 #include "../data.hpp"
 #include "../errors.hpp"
 #include "packable.hpp"
 
 namespace proto {
+namespace flat {
+class Builder;
+}
+
 enum ResponseType : u8 {
     RESP_OS_INFO,
     RESP_TIME,
@@ -14,22 +21,70 @@ enum ResponseType : u8 {
     RESP_DRIVES,
     RESP_RIGHTS,
     RESP_OWNER,
+    RESP_RIGHTS_BULK,
+    RESP_OWNER_BULK,
+};
+
+// Wire layout a request asks its response to be packed in. Packed is the
+// sequential PackCtx encoding parsed by ParseResponse, flat is read in place
+// through the views in flat.hpp.
+enum ResponseLayout : u8 {
+    LAYOUT_PACKED,
+    LAYOUT_FLAT,
 };
 
 struct Response : Packable {
     ERR err = ERR_Ok;
+    // Backs the entry containers and the packing buffers. Responses built
+    // while serving a request use the arena of its connection.
+    std::pmr::memory_resource *mem = std::pmr::get_default_resource();
+    // Set on a slice of a stream whose entries are produced while it is
+    // sent: the stream goes on in a later response even after the last
+    // frame of this one.
+    bool more = false;
+
+    // List-shaped responses can be streamed as several frames, each one a
+    // complete response of the same type carrying a slice of the entries.
+    // Packs the entries starting at *cursor that fit into max_size bytes (at
+    // least one) and advances *cursor. Scalar responses are a single entry.
+    virtual std::unique_ptr<const u8[]> packChunk(usize *size, ByteOrder order,
+                                                  usize max_size, usize *cursor,
+                                                  ResponseLayout layout) const;
+
+    // Writes entries [first, last) as flat records, see flat.hpp.
+    virtual void packFlat(flat::Builder *builder, usize first,
+                          usize last) const = 0;
+
+    // Number of entries packChunk walks over.
+    [[nodiscard]] virtual usize entryCount() const;
+
+    // Merges a later frame of the same stream into this response.
+    virtual ERR append(const Response &part);
 
     virtual ~Response() = default;
+
+protected:
+    Response() = default;
+    explicit Response(std::pmr::memory_resource *mem) : mem(mem) {}
+
+    std::unique_ptr<const u8[]> packFlatRange(usize *size, ByteOrder order,
+                                              usize first, usize last) const;
 };
 
 struct OsInfoResponse : Response {
     OSInfo info{};
 
-    std::unique_ptr<const u8[]> pack(usize *size) const override;
+    std::unique_ptr<const u8[]> pack(usize *size,
+                                     ByteOrder order) const override;
+
+    void packFlat(flat::Builder *builder, usize first,
+                  usize last) const override;
 
     OsInfoResponse(PackCtx *ctx, ERR *err);
 
-    explicit OsInfoResponse(OSInfo info);
+    explicit OsInfoResponse(
+        OSInfo info,
+        std::pmr::memory_resource *mem = std::pmr::get_default_resource());
 
     ~OsInfoResponse() override = default;
 };
@@ -38,23 +93,43 @@ struct TimeResponse : Response {
     u64 time_ms = 0;
     i8 time_zone = 0;
 
-    std::unique_ptr<const u8[]> pack(usize *size) const override;
+    std::unique_ptr<const u8[]> pack(usize *size,
+                                     ByteOrder order) const override;
+
+    void packFlat(flat::Builder *builder, usize first,
+                  usize last) const override;
 
     TimeResponse(PackCtx *ctx, ERR *err);
 
-    explicit TimeResponse(u64 time, i8 time_zone = 0);
+    explicit TimeResponse(
+        u64 time, i8 time_zone = 0,
+        std::pmr::memory_resource *mem = std::pmr::get_default_resource());
 
     ~TimeResponse() override = default;
 };
 
 struct DrivesResponse : Response {
-    std::vector<DriveInfo> drives;
+    std::pmr::vector<DriveInfo> drives;
+
+    std::unique_ptr<const u8[]> pack(usize *size,
+                                     ByteOrder order) const override;
+
+    void packFlat(flat::Builder *builder, usize first,
+                  usize last) const override;
 
-    std::unique_ptr<const u8[]> pack(usize *size) const override;
+    std::unique_ptr<const u8[]> packChunk(usize *size, ByteOrder order,
+                                          usize max_size, usize *cursor,
+                                          ResponseLayout layout) const override;
+
+    [[nodiscard]] usize entryCount() const override;
+
+    ERR append(const Response &part) override;
 
     DrivesResponse(PackCtx *ctx, ERR *err);
 
-    explicit DrivesResponse(const std::vector<DriveInfo> &drives);
+    explicit DrivesResponse(
+        std::span<const DriveInfo> drives,
+        std::pmr::memory_resource *mem = std::pmr::get_default_resource());
 
     ~DrivesResponse() override = default;
 };
@@ -62,11 +137,17 @@ struct DrivesResponse : Response {
 struct MemoryResponse : Response {
     MemInfo mem_info{};
 
-    std::unique_ptr<const u8[]> pack(usize *size) const override;
+    std::unique_ptr<const u8[]> pack(usize *size,
+                                     ByteOrder order) const override;
+
+    void packFlat(flat::Builder *builder, usize first,
+                  usize last) const override;
 
     MemoryResponse(PackCtx *ctx, ERR *err);
 
-    explicit MemoryResponse(MemInfo mem_info);
+    explicit MemoryResponse(
+        MemInfo mem_info,
+        std::pmr::memory_resource *mem = std::pmr::get_default_resource());
 
     ~MemoryResponse() override = default;
 };
@@ -74,11 +155,25 @@ struct MemoryResponse : Response {
 struct RightsResponse : Response {
     AccessRightsInfo rights_info{};
 
-    std::unique_ptr<const u8[]> pack(usize *size) const override;
+    std::unique_ptr<const u8[]> pack(usize *size,
+                                     ByteOrder order) const override;
+
+    void packFlat(flat::Builder *builder, usize first,
+                  usize last) const override;
+
+    std::unique_ptr<const u8[]> packChunk(usize *size, ByteOrder order,
+                                          usize max_size, usize *cursor,
+                                          ResponseLayout layout) const override;
+
+    [[nodiscard]] usize entryCount() const override;
+
+    ERR append(const Response &part) override;
 
     RightsResponse(PackCtx *ctx, ERR *err);
 
-    explicit RightsResponse(AccessRightsInfo rights_info);
+    explicit RightsResponse(
+        const AccessRightsInfo &rights_info,
+        std::pmr::memory_resource *mem = std::pmr::get_default_resource());
 
     ~RightsResponse() override = default;
 };
@@ -86,14 +181,83 @@ struct RightsResponse : Response {
 struct OwnerResponse : Response {
     OwnerInfo info{};
 
-    std::unique_ptr<const u8[]> pack(usize *size) const override;
+    std::unique_ptr<const u8[]> pack(usize *size,
+                                     ByteOrder order) const override;
+
+    void packFlat(flat::Builder *builder, usize first,
+                  usize last) const override;
 
     OwnerResponse(PackCtx *ctx, ERR *err);
 
-    explicit OwnerResponse(OwnerInfo info);
+    explicit OwnerResponse(
+        OwnerInfo info,
+        std::pmr::memory_resource *mem = std::pmr::get_default_resource());
 
     ~OwnerResponse() override = default;
 };
+
+// Answer to REQ_RIGHTS_BULK, one entry per path in the order they were
+// looked up. Most paths of a tree share a handful of ACLs, so each ACL is
+// sent once per stream, in the first response with a path that refers to
+// it. packChunk walks over acls first and results after, a frame never
+// refers to an ACL that comes later.
+struct BulkRightsResponse : Response {
+    std::pmr::vector<SharedAcl> acls;
+    std::pmr::vector<PathAclInfo> results;
+
+    std::unique_ptr<const u8[]> pack(usize *size,
+                                     ByteOrder order) const override;
+
+    void packFlat(flat::Builder *builder, usize first,
+                  usize last) const override;
+
+    std::unique_ptr<const u8[]> packChunk(usize *size, ByteOrder order,
+                                          usize max_size, usize *cursor,
+                                          ResponseLayout layout) const override;
+
+    [[nodiscard]] usize entryCount() const override;
+
+    ERR append(const Response &part) override;
+
+    // Appends results with their ACL filled in. A path whose ACL was lost
+    // with a frame too large to send gets ERR_Invalid_Response.
+    void resolve(std::vector<PathRightsInfo> *res) const;
+
+    BulkRightsResponse(PackCtx *ctx, ERR *err);
+
+    BulkRightsResponse(
+        std::vector<SharedAcl> acls, std::vector<PathAclInfo> results,
+        std::pmr::memory_resource *mem = std::pmr::get_default_resource());
+
+    ~BulkRightsResponse() override = default;
+};
+
+// Answer to REQ_OWNER_BULK, see BulkRightsResponse.
+struct BulkOwnerResponse : Response {
+    std::pmr::vector<PathOwnerInfo> results;
+
+    std::unique_ptr<const u8[]> pack(usize *size,
+                                     ByteOrder order) const override;
+
+    void packFlat(flat::Builder *builder, usize first,
+                  usize last) const override;
+
+    std::unique_ptr<const u8[]> packChunk(usize *size, ByteOrder order,
+                                          usize max_size, usize *cursor,
+                                          ResponseLayout layout) const override;
+
+    [[nodiscard]] usize entryCount() const override;
+
+    ERR append(const Response &part) override;
+
+    BulkOwnerResponse(PackCtx *ctx, ERR *err);
+
+    explicit BulkOwnerResponse(
+        std::vector<PathOwnerInfo> results,
+        std::pmr::memory_resource *mem = std::pmr::get_default_resource());
+
+    ~BulkOwnerResponse() override = default;
+};
 }  // namespace proto
 
 #endif
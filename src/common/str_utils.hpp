@@ -14,9 +14,8 @@ std::u16string make_u16string(const std::wstring &ws);
  * value U+FFFD, per the Unicode documentation.
  * (http://www.unicode.org/faq/private_use.html retrieved 12 March 2017.)
  * Unpaired surrogates in ws are also converted to sentinel values.
- * Noncharacters, however, are left intact.  As a fallback, if wide
- * characters are the same size as char16_t, this does a more trivial
- * construction using that implicit conversion.
+ * Noncharacters, however, are left intact.  If wide characters are the
+ * same size as char16_t, ws already is UTF-16 and is only validated.
  */
 }  // namespace utils
 #endif
@@ -0,0 +1,35 @@
+#ifndef BSIT_3_UTF_KERNELS_HPP
+#define BSIT_3_UTF_KERNELS_HPP
+
+#include "../alias.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || \
+    defined(_M_IX86)
+#define BSIT_3_UTF_X86
+#endif
+
+// Every kernel converts the longest prefix of in that maps one code unit to
+// one code unit and returns its length. Vector kernels store whole blocks,
+// so up to one block of output past the returned length may be written; the
+// callers size out for the worst case, which always leaves room for it.
+namespace utils::utf {
+struct Kernels {
+    usize (*utf32_to_utf16)(const char32_t *in, usize n, char16_t *out);
+    usize (*utf16_to_utf32)(const char16_t *in, usize n, char32_t *out);
+    usize (*utf16_to_utf8)(const char16_t *in, usize n, char *out);
+    usize (*utf8_to_utf16)(const char *in, usize n, char16_t *out);
+    usize (*utf32_to_utf8)(const char32_t *in, usize n, char *out);
+    usize (*utf8_to_utf32)(const char *in, usize n, char32_t *out);
+    // Same prefixes without converting, for validation.
+    usize (*ascii_prefix)(const char *in, usize n);
+    usize (*bmp_prefix)(const char16_t *in, usize n);
+};
+
+extern const Kernels SCALAR_KERNELS;
+#ifdef BSIT_3_UTF_X86
+extern const Kernels SSE41_KERNELS;
+extern const Kernels AVX2_KERNELS;
+#endif
+}  // namespace utils::utf
+
+#endif
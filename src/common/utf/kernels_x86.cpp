@@ -0,0 +1,338 @@
+#include "kernels.hpp"
+
+#ifdef BSIT_3_UTF_X86
+
+#include <immintrin.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#define TARGET_SSE41
+#define TARGET_AVX2
+#else
+#define TARGET_SSE41 __attribute__((target("sse4.1")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+// Each kernel tests a whole block, stores the converted block and stops at
+// the first lane that is not one-to-one. The tail shorter than a block goes
+// through the scalar kernel.
+namespace utils::utf {
+namespace {
+u32 FirstSet(u32 mask) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+template <typename T>
+__m128i *Ptr128(T *ptr) {
+    return reinterpret_cast<__m128i *>(ptr);
+}
+
+template <typename T>
+const __m128i *Ptr128(const T *ptr) {
+    return reinterpret_cast<const __m128i *>(ptr);
+}
+
+template <typename T>
+__m256i *Ptr256(T *ptr) {
+    return reinterpret_cast<__m256i *>(ptr);
+}
+
+template <typename T>
+const __m256i *Ptr256(const T *ptr) {
+    return reinterpret_cast<const __m256i *>(ptr);
+}
+
+// All ones in the 32-bit lanes holding a BMP code point outside the
+// surrogates.
+TARGET_SSE41 __m128i Bmp32(__m128i v) {
+    __m128i in_bmp = _mm_cmpeq_epi32(_mm_srli_epi32(v, 16), _mm_setzero_si128());
+    __m128i surrogate = _mm_cmpeq_epi32(
+        _mm_and_si128(v, _mm_set1_epi32(0xF800)), _mm_set1_epi32(0xD800));
+    return _mm_andnot_si128(surrogate, in_bmp);
+}
+
+TARGET_SSE41 u32 Surrogates16(__m128i v) {
+    return _mm_movemask_epi8(_mm_cmpeq_epi16(
+        _mm_and_si128(v, _mm_set1_epi16(static_cast<short>(0xF800))),
+        _mm_set1_epi16(static_cast<short>(0xD800))));
+}
+
+TARGET_SSE41 usize Utf32ToUtf16Sse41(const char32_t *in, usize n,
+                                     char16_t *out) {
+    usize i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i a = _mm_loadu_si128(Ptr128(in + i));
+        __m128i b = _mm_loadu_si128(Ptr128(in + i + 4));
+        _mm_storeu_si128(Ptr128(out + i), _mm_packus_epi32(a, b));
+        u32 good = _mm_movemask_ps(_mm_castsi128_ps(Bmp32(a))) |
+                   _mm_movemask_ps(_mm_castsi128_ps(Bmp32(b))) << 4;
+        if (good != 0xFF) return i + FirstSet(~good);
+    }
+    return i + SCALAR_KERNELS.utf32_to_utf16(in + i, n - i, out + i);
+}
+
+TARGET_SSE41 usize Utf16ToUtf32Sse41(const char16_t *in, usize n,
+                                     char32_t *out) {
+    usize i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i v = _mm_loadu_si128(Ptr128(in + i));
+        _mm_storeu_si128(Ptr128(out + i), _mm_cvtepu16_epi32(v));
+        _mm_storeu_si128(Ptr128(out + i + 4),
+                         _mm_cvtepu16_epi32(_mm_srli_si128(v, 8)));
+        u32 bad = Surrogates16(v);
+        if (bad) return i + FirstSet(bad) / 2;
+    }
+    return i + SCALAR_KERNELS.utf16_to_utf32(in + i, n - i, out + i);
+}
+
+TARGET_SSE41 usize Utf16ToUtf8Sse41(const char16_t *in, usize n, char *out) {
+    const __m128i high = _mm_set1_epi16(static_cast<short>(0xFF80));
+    usize i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i a = _mm_loadu_si128(Ptr128(in + i));
+        __m128i b = _mm_loadu_si128(Ptr128(in + i + 8));
+        _mm_storeu_si128(Ptr128(out + i), _mm_packus_epi16(a, b));
+        __m128i ascii_a = _mm_cmpeq_epi16(_mm_and_si128(a, high),
+                                          _mm_setzero_si128());
+        __m128i ascii_b = _mm_cmpeq_epi16(_mm_and_si128(b, high),
+                                          _mm_setzero_si128());
+        u32 good = _mm_movemask_epi8(_mm_packs_epi16(ascii_a, ascii_b));
+        if (good != 0xFFFF) return i + FirstSet(~good);
+    }
+    return i + SCALAR_KERNELS.utf16_to_utf8(in + i, n - i, out + i);
+}
+
+TARGET_SSE41 usize Utf8ToUtf16Sse41(const char *in, usize n, char16_t *out) {
+    usize i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128(Ptr128(in + i));
+        _mm_storeu_si128(Ptr128(out + i), _mm_cvtepu8_epi16(v));
+        _mm_storeu_si128(Ptr128(out + i + 8),
+                         _mm_cvtepu8_epi16(_mm_srli_si128(v, 8)));
+        u32 bad = _mm_movemask_epi8(v);
+        if (bad) return i + FirstSet(bad);
+    }
+    return i + SCALAR_KERNELS.utf8_to_utf16(in + i, n - i, out + i);
+}
+
+TARGET_SSE41 usize Utf32ToUtf8Sse41(const char32_t *in, usize n, char *out) {
+    const __m128i high = _mm_set1_epi32(~0x7F);
+    const __m128i zero = _mm_setzero_si128();
+    usize i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i v[4];
+        __m128i ascii[4];
+        for (int k = 0; k < 4; k++) {
+            v[k] = _mm_loadu_si128(Ptr128(in + i + 4 * k));
+            ascii[k] = _mm_cmpeq_epi32(_mm_and_si128(v[k], high), zero);
+        }
+        __m128i lo = _mm_packus_epi32(v[0], v[1]);
+        __m128i hi = _mm_packus_epi32(v[2], v[3]);
+        _mm_storeu_si128(Ptr128(out + i), _mm_packus_epi16(lo, hi));
+        u32 good = _mm_movemask_epi8(
+            _mm_packs_epi16(_mm_packs_epi32(ascii[0], ascii[1]),
+                            _mm_packs_epi32(ascii[2], ascii[3])));
+        if (good != 0xFFFF) return i + FirstSet(~good);
+    }
+    return i + SCALAR_KERNELS.utf32_to_utf8(in + i, n - i, out + i);
+}
+
+TARGET_SSE41 usize Utf8ToUtf32Sse41(const char *in, usize n, char32_t *out) {
+    usize i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128(Ptr128(in + i));
+        _mm_storeu_si128(Ptr128(out + i), _mm_cvtepu8_epi32(v));
+        _mm_storeu_si128(Ptr128(out + i + 4),
+                         _mm_cvtepu8_epi32(_mm_srli_si128(v, 4)));
+        _mm_storeu_si128(Ptr128(out + i + 8),
+                         _mm_cvtepu8_epi32(_mm_srli_si128(v, 8)));
+        _mm_storeu_si128(Ptr128(out + i + 12),
+                         _mm_cvtepu8_epi32(_mm_srli_si128(v, 12)));
+        u32 bad = _mm_movemask_epi8(v);
+        if (bad) return i + FirstSet(bad);
+    }
+    return i + SCALAR_KERNELS.utf8_to_utf32(in + i, n - i, out + i);
+}
+
+TARGET_SSE41 usize AsciiPrefixSse41(const char *in, usize n) {
+    usize i = 0;
+    for (; i + 16 <= n; i += 16) {
+        u32 bad = _mm_movemask_epi8(_mm_loadu_si128(Ptr128(in + i)));
+        if (bad) return i + FirstSet(bad);
+    }
+    return i + SCALAR_KERNELS.ascii_prefix(in + i, n - i);
+}
+
+TARGET_SSE41 usize BmpPrefixSse41(const char16_t *in, usize n) {
+    usize i = 0;
+    for (; i + 8 <= n; i += 8) {
+        u32 bad = Surrogates16(_mm_loadu_si128(Ptr128(in + i)));
+        if (bad) return i + FirstSet(bad) / 2;
+    }
+    return i + SCALAR_KERNELS.bmp_prefix(in + i, n - i);
+}
+
+TARGET_AVX2 __m256i Bmp32(__m256i v) {
+    __m256i in_bmp =
+        _mm256_cmpeq_epi32(_mm256_srli_epi32(v, 16), _mm256_setzero_si256());
+    __m256i surrogate =
+        _mm256_cmpeq_epi32(_mm256_and_si256(v, _mm256_set1_epi32(0xF800)),
+                           _mm256_set1_epi32(0xD800));
+    return _mm256_andnot_si256(surrogate, in_bmp);
+}
+
+TARGET_AVX2 u32 Surrogates16(__m256i v) {
+    return _mm256_movemask_epi8(_mm256_cmpeq_epi16(
+        _mm256_and_si256(v, _mm256_set1_epi16(static_cast<short>(0xF800))),
+        _mm256_set1_epi16(static_cast<short>(0xD800))));
+}
+
+// The 256-bit packs work per 128-bit lane, this restores the element order.
+TARGET_AVX2 __m256i Unlane(__m256i v) {
+    return _mm256_permute4x64_epi64(v, 0xD8);
+}
+
+TARGET_AVX2 usize Utf32ToUtf16Avx2(const char32_t *in, usize n,
+                                   char16_t *out) {
+    usize i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i a = _mm256_loadu_si256(Ptr256(in + i));
+        __m256i b = _mm256_loadu_si256(Ptr256(in + i + 8));
+        _mm256_storeu_si256(Ptr256(out + i),
+                            Unlane(_mm256_packus_epi32(a, b)));
+        u32 good = _mm256_movemask_ps(_mm256_castsi256_ps(Bmp32(a))) |
+                   _mm256_movemask_ps(_mm256_castsi256_ps(Bmp32(b))) << 8;
+        if (good != 0xFFFF) return i + FirstSet(~good);
+    }
+    return i + SCALAR_KERNELS.utf32_to_utf16(in + i, n - i, out + i);
+}
+
+TARGET_AVX2 usize Utf16ToUtf32Avx2(const char16_t *in, usize n,
+                                   char32_t *out) {
+    usize i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i v = _mm256_loadu_si256(Ptr256(in + i));
+        _mm256_storeu_si256(Ptr256(out + i),
+                            _mm256_cvtepu16_epi32(_mm256_castsi256_si128(v)));
+        _mm256_storeu_si256(
+            Ptr256(out + i + 8),
+            _mm256_cvtepu16_epi32(_mm256_extracti128_si256(v, 1)));
+        u32 bad = Surrogates16(v);
+        if (bad) return i + FirstSet(bad) / 2;
+    }
+    return i + SCALAR_KERNELS.utf16_to_utf32(in + i, n - i, out + i);
+}
+
+TARGET_AVX2 usize Utf16ToUtf8Avx2(const char16_t *in, usize n, char *out) {
+    const __m256i high = _mm256_set1_epi16(static_cast<short>(0xFF80));
+    const __m256i zero = _mm256_setzero_si256();
+    usize i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i a = _mm256_loadu_si256(Ptr256(in + i));
+        __m256i b = _mm256_loadu_si256(Ptr256(in + i + 16));
+        _mm256_storeu_si256(Ptr256(out + i),
+                            Unlane(_mm256_packus_epi16(a, b)));
+        __m256i ascii_a = _mm256_cmpeq_epi16(_mm256_and_si256(a, high), zero);
+        __m256i ascii_b = _mm256_cmpeq_epi16(_mm256_and_si256(b, high), zero);
+        u32 good = _mm256_movemask_epi8(
+            Unlane(_mm256_packs_epi16(ascii_a, ascii_b)));
+        if (good != 0xFFFFFFFF) return i + FirstSet(~good);
+    }
+    return i + SCALAR_KERNELS.utf16_to_utf8(in + i, n - i, out + i);
+}
+
+TARGET_AVX2 usize Utf8ToUtf16Avx2(const char *in, usize n, char16_t *out) {
+    usize i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i v = _mm256_loadu_si256(Ptr256(in + i));
+        _mm256_storeu_si256(Ptr256(out + i),
+                            _mm256_cvtepu8_epi16(_mm256_castsi256_si128(v)));
+        _mm256_storeu_si256(
+            Ptr256(out + i + 16),
+            _mm256_cvtepu8_epi16(_mm256_extracti128_si256(v, 1)));
+        u32 bad = _mm256_movemask_epi8(v);
+        if (bad) return i + FirstSet(bad);
+    }
+    return i + SCALAR_KERNELS.utf8_to_utf16(in + i, n - i, out + i);
+}
+
+TARGET_AVX2 usize Utf32ToUtf8Avx2(const char32_t *in, usize n, char *out) {
+    const __m256i high = _mm256_set1_epi32(~0x7F);
+    const __m256i zero = _mm256_setzero_si256();
+    usize i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i v[4];
+        __m256i ascii[4];
+        for (int k = 0; k < 4; k++) {
+            v[k] = _mm256_loadu_si256(Ptr256(in + i + 8 * k));
+            ascii[k] = _mm256_cmpeq_epi32(_mm256_and_si256(v[k], high), zero);
+        }
+        __m256i lo = Unlane(_mm256_packus_epi32(v[0], v[1]));
+        __m256i hi = Unlane(_mm256_packus_epi32(v[2], v[3]));
+        _mm256_storeu_si256(Ptr256(out + i),
+                            Unlane(_mm256_packus_epi16(lo, hi)));
+        __m256i ascii_lo = Unlane(_mm256_packs_epi32(ascii[0], ascii[1]));
+        __m256i ascii_hi = Unlane(_mm256_packs_epi32(ascii[2], ascii[3]));
+        u32 good = _mm256_movemask_epi8(
+            Unlane(_mm256_packs_epi16(ascii_lo, ascii_hi)));
+        if (good != 0xFFFFFFFF) return i + FirstSet(~good);
+    }
+    return i + SCALAR_KERNELS.utf32_to_utf8(in + i, n - i, out + i);
+}
+
+TARGET_AVX2 usize Utf8ToUtf32Avx2(const char *in, usize n, char32_t *out) {
+    usize i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i v = _mm256_loadu_si256(Ptr256(in + i));
+        __m128i lo = _mm256_castsi256_si128(v);
+        __m128i hi = _mm256_extracti128_si256(v, 1);
+        _mm256_storeu_si256(Ptr256(out + i), _mm256_cvtepu8_epi32(lo));
+        _mm256_storeu_si256(Ptr256(out + i + 8),
+                            _mm256_cvtepu8_epi32(_mm_srli_si128(lo, 8)));
+        _mm256_storeu_si256(Ptr256(out + i + 16), _mm256_cvtepu8_epi32(hi));
+        _mm256_storeu_si256(Ptr256(out + i + 24),
+                            _mm256_cvtepu8_epi32(_mm_srli_si128(hi, 8)));
+        u32 bad = _mm256_movemask_epi8(v);
+        if (bad) return i + FirstSet(bad);
+    }
+    return i + SCALAR_KERNELS.utf8_to_utf32(in + i, n - i, out + i);
+}
+
+TARGET_AVX2 usize AsciiPrefixAvx2(const char *in, usize n) {
+    usize i = 0;
+    for (; i + 32 <= n; i += 32) {
+        u32 bad = _mm256_movemask_epi8(_mm256_loadu_si256(Ptr256(in + i)));
+        if (bad) return i + FirstSet(bad);
+    }
+    return i + SCALAR_KERNELS.ascii_prefix(in + i, n - i);
+}
+
+TARGET_AVX2 usize BmpPrefixAvx2(const char16_t *in, usize n) {
+    usize i = 0;
+    for (; i + 16 <= n; i += 16) {
+        u32 bad = Surrogates16(_mm256_loadu_si256(Ptr256(in + i)));
+        if (bad) return i + FirstSet(bad) / 2;
+    }
+    return i + SCALAR_KERNELS.bmp_prefix(in + i, n - i);
+}
+}  // namespace
+
+const Kernels SSE41_KERNELS = {
+    Utf32ToUtf16Sse41, Utf16ToUtf32Sse41, Utf16ToUtf8Sse41,
+    Utf8ToUtf16Sse41,  Utf32ToUtf8Sse41,  Utf8ToUtf32Sse41,
+    AsciiPrefixSse41,  BmpPrefixSse41,
+};
+
+const Kernels AVX2_KERNELS = {
+    Utf32ToUtf16Avx2, Utf16ToUtf32Avx2, Utf16ToUtf8Avx2, Utf8ToUtf16Avx2,
+    Utf32ToUtf8Avx2,  Utf8ToUtf32Avx2,  AsciiPrefixAvx2, BmpPrefixAvx2,
+};
+}  // namespace utils::utf
+
+#endif
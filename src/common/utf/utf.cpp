@@ -0,0 +1,427 @@
+#include "utf.hpp"
+
+#include <type_traits>
+
+#include "kernels.hpp"
+
+#ifdef BSIT_3_UTF_X86
+#ifdef _MSC_VER
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+#endif
+
+namespace utils::utf {
+namespace {
+constexpr char32_t REPLACEMENT = 0xFFFD;
+
+bool IsSurrogate(char32_t cp) { return cp >= 0xD800 && cp <= 0xDFFF; }
+
+bool IsScalarValue(char32_t cp) { return cp <= 0x10FFFF && !IsSurrogate(cp); }
+
+// Decoders read one code point at in[*i] and advance *i past it. On invalid
+// input they return false and skip a single code unit.
+bool Decode(const char32_t *in, usize n, usize *i, char32_t *cp) {
+    *cp = in[(*i)++];
+    return IsScalarValue(*cp);
+}
+
+bool Decode(const char16_t *in, usize n, usize *i, char32_t *cp) {
+    char32_t lead = in[(*i)++];
+    if (!IsSurrogate(lead)) {
+        *cp = lead;
+        return true;
+    }
+    if (lead >= 0xDC00 || *i == n || in[*i] < 0xDC00 || in[*i] > 0xDFFF) {
+        return false;
+    }
+    char32_t trail = in[(*i)++];
+    *cp = 0x10000 + ((lead - 0xD800) << 10) + (trail - 0xDC00);
+    return true;
+}
+
+// Rejects overlong forms, surrogates and code points past U+10FFFF.
+bool Decode(const char *in, usize n, usize *i, char32_t *cp) {
+    auto byte = [&](usize at) { return static_cast<u8>(in[at]); };
+    u8 lead = byte(*i);
+    usize len;
+    char32_t min;
+    if (lead < 0x80) {
+        *cp = lead;
+        (*i)++;
+        return true;
+    } else if ((lead & 0xE0) == 0xC0) {
+        len = 2;
+        min = 0x80;
+        *cp = lead & 0x1F;
+    } else if ((lead & 0xF0) == 0xE0) {
+        len = 3;
+        min = 0x800;
+        *cp = lead & 0x0F;
+    } else if ((lead & 0xF8) == 0xF0) {
+        len = 4;
+        min = 0x10000;
+        *cp = lead & 0x07;
+    } else {
+        (*i)++;
+        return false;
+    }
+    if (n - *i < len) {
+        (*i)++;
+        return false;
+    }
+    for (usize k = 1; k < len; k++) {
+        u8 cont = byte(*i + k);
+        if ((cont & 0xC0) != 0x80) {
+            (*i)++;
+            return false;
+        }
+        *cp = (*cp << 6) | (cont & 0x3F);
+    }
+    if (*cp < min || !IsScalarValue(*cp)) {
+        (*i)++;
+        return false;
+    }
+    *i += len;
+    return true;
+}
+
+usize Encode(char32_t cp, char32_t *out) {
+    *out = cp;
+    return 1;
+}
+
+usize Encode(char32_t cp, char16_t *out) {
+    if (cp < 0x10000) {
+        *out = static_cast<char16_t>(cp);
+        return 1;
+    }
+    cp -= 0x10000;
+    out[0] = static_cast<char16_t>(0xD800 + (cp >> 10));
+    out[1] = static_cast<char16_t>(0xDC00 + (cp & 0x3FF));
+    return 2;
+}
+
+usize Encode(char32_t cp, char *out) {
+    if (cp < 0x80) {
+        out[0] = static_cast<char>(cp);
+        return 1;
+    }
+    if (cp < 0x800) {
+        out[0] = static_cast<char>(0xC0 | (cp >> 6));
+        out[1] = static_cast<char>(0x80 | (cp & 0x3F));
+        return 2;
+    }
+    if (cp < 0x10000) {
+        out[0] = static_cast<char>(0xE0 | (cp >> 12));
+        out[1] = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out[2] = static_cast<char>(0x80 | (cp & 0x3F));
+        return 3;
+    }
+    out[0] = static_cast<char>(0xF0 | (cp >> 18));
+    out[1] = static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+    out[2] = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+    out[3] = static_cast<char>(0x80 | (cp & 0x3F));
+    return 4;
+}
+
+// Largest number of output units a single input unit can turn into,
+// counting U+FFFD written for an invalid one.
+template <typename In, typename Out>
+constexpr usize MaxRatio() {
+    if constexpr (sizeof(Out) >= sizeof(In)) {
+        return 1;
+    } else if constexpr (sizeof(In) == 4 && sizeof(Out) == 2) {
+        return 2;
+    } else if constexpr (sizeof(In) == 2) {
+        return 3;
+    } else {
+        return 4;
+    }
+}
+
+// Whether unit converts to a single unit of Out, i.e. starts a run the
+// kernels handle.
+template <typename In, typename Out>
+bool OneToOne(In unit) {
+    auto value = static_cast<std::make_unsigned_t<In>>(unit);
+    if constexpr (sizeof(In) == 1 || sizeof(Out) == 1) {
+        return value < 0x80;
+    } else {
+        return value < 0x10000 && !IsSurrogate(value);
+    }
+}
+
+// Hands one-to-one runs to the kernel and everything between them to the
+// scalar decoder, so a kernel call never ends up converting nothing.
+template <typename In, typename Out, typename Str>
+bool Transcode(const In *in, usize n, Str *out,
+               usize (*kernel)(const In *, usize, Out *),
+               ErrorPolicy policy) {
+    static_assert(sizeof(typename Str::value_type) == sizeof(Out));
+    out->resize(n * MaxRatio<In, Out>());
+    auto dst = reinterpret_cast<Out *>(out->data());
+    usize i = 0;
+    usize o = 0;
+    bool valid = true;
+    while (i < n) {
+        if (OneToOne<In, Out>(in[i])) {
+            usize done = kernel(in + i, n - i, dst + o);
+            i += done;
+            o += done;
+            continue;
+        }
+        char32_t cp;
+        if (!Decode(in, n, &i, &cp)) {
+            valid = false;
+            if (policy == UTF_STRICT) break;
+            cp = REPLACEMENT;
+        }
+        o += Encode(cp, dst + o);
+    }
+    out->resize(o);
+    return valid;
+}
+
+template <typename In>
+bool Validate(const In *in, usize n, usize (*kernel)(const In *, usize)) {
+    usize i = 0;
+    while (i < n) {
+        if (OneToOne<In, In>(in[i])) {
+            i += kernel(in + i, n - i);
+            continue;
+        }
+        char32_t cp;
+        if (!Decode(in, n, &i, &cp)) return false;
+    }
+    return true;
+}
+
+Isa DetectIsa() {
+#ifdef BSIT_3_UTF_X86
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    bool sse41 = info[2] & (1 << 19);
+    bool os_avx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) &&
+                  (_xgetbv(0) & 6) == 6;
+    __cpuidex(info, 7, 0);
+    bool avx2 = os_avx && (info[1] & (1 << 5));
+#else
+    __builtin_cpu_init();
+    bool sse41 = __builtin_cpu_supports("sse4.1");
+    bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+    if (avx2) return ISA_AVX2;
+    if (sse41) return ISA_SSE41;
+#endif
+    return ISA_SCALAR;
+}
+
+const Kernels &KernelsFor(Isa isa) {
+#ifdef BSIT_3_UTF_X86
+    if (isa == ISA_AVX2) return AVX2_KERNELS;
+    if (isa == ISA_SSE41) return SSE41_KERNELS;
+#endif
+    return SCALAR_KERNELS;
+}
+
+Isa &ActiveIsaRef() {
+    static Isa isa = SupportedIsa();
+    return isa;
+}
+
+const Kernels &Active() { return KernelsFor(ActiveIsaRef()); }
+
+usize Utf32ToUtf16Scalar(const char32_t *in, usize n, char16_t *out) {
+    usize i = 0;
+    for (; i < n && in[i] < 0x10000 && !IsSurrogate(in[i]); i++) {
+        out[i] = static_cast<char16_t>(in[i]);
+    }
+    return i;
+}
+
+usize Utf16ToUtf32Scalar(const char16_t *in, usize n, char32_t *out) {
+    usize i = 0;
+    for (; i < n && !IsSurrogate(in[i]); i++) {
+        out[i] = in[i];
+    }
+    return i;
+}
+
+usize Utf16ToUtf8Scalar(const char16_t *in, usize n, char *out) {
+    usize i = 0;
+    for (; i < n && in[i] < 0x80; i++) {
+        out[i] = static_cast<char>(in[i]);
+    }
+    return i;
+}
+
+usize Utf8ToUtf16Scalar(const char *in, usize n, char16_t *out) {
+    usize i = 0;
+    for (; i < n && static_cast<u8>(in[i]) < 0x80; i++) {
+        out[i] = static_cast<char16_t>(in[i]);
+    }
+    return i;
+}
+
+usize Utf32ToUtf8Scalar(const char32_t *in, usize n, char *out) {
+    usize i = 0;
+    for (; i < n && in[i] < 0x80; i++) {
+        out[i] = static_cast<char>(in[i]);
+    }
+    return i;
+}
+
+usize Utf8ToUtf32Scalar(const char *in, usize n, char32_t *out) {
+    usize i = 0;
+    for (; i < n && static_cast<u8>(in[i]) < 0x80; i++) {
+        out[i] = static_cast<char32_t>(in[i]);
+    }
+    return i;
+}
+
+usize AsciiPrefixScalar(const char *in, usize n) {
+    usize i = 0;
+    while (i < n && static_cast<u8>(in[i]) < 0x80) i++;
+    return i;
+}
+
+usize BmpPrefixScalar(const char16_t *in, usize n) {
+    usize i = 0;
+    while (i < n && !IsSurrogate(in[i])) i++;
+    return i;
+}
+}  // namespace
+
+const Kernels SCALAR_KERNELS = {
+    Utf32ToUtf16Scalar, Utf16ToUtf32Scalar, Utf16ToUtf8Scalar,
+    Utf8ToUtf16Scalar,  Utf32ToUtf8Scalar,  Utf8ToUtf32Scalar,
+    AsciiPrefixScalar,  BmpPrefixScalar,
+};
+
+Isa SupportedIsa() {
+    static Isa isa = DetectIsa();
+    return isa;
+}
+
+Isa ActiveIsa() { return ActiveIsaRef(); }
+
+void UseIsa(Isa isa) { ActiveIsaRef() = MIN(isa, SupportedIsa()); }
+
+bool ToUtf16(std::u32string_view in, std::u16string *out, ErrorPolicy policy) {
+    return Transcode(in.data(), in.size(), out, Active().utf32_to_utf16,
+                     policy);
+}
+
+bool ToUtf16(std::string_view in, std::u16string *out, ErrorPolicy policy) {
+    return Transcode(in.data(), in.size(), out, Active().utf8_to_utf16,
+                     policy);
+}
+
+bool ToUtf32(std::u16string_view in, std::u32string *out, ErrorPolicy policy) {
+    return Transcode(in.data(), in.size(), out, Active().utf16_to_utf32,
+                     policy);
+}
+
+bool ToUtf32(std::string_view in, std::u32string *out, ErrorPolicy policy) {
+    return Transcode(in.data(), in.size(), out, Active().utf8_to_utf32,
+                     policy);
+}
+
+bool ToUtf8(std::u16string_view in, std::string *out, ErrorPolicy policy) {
+    return Transcode(in.data(), in.size(), out, Active().utf16_to_utf8,
+                     policy);
+}
+
+bool ToUtf8(std::u32string_view in, std::string *out, ErrorPolicy policy) {
+    return Transcode(in.data(), in.size(), out, Active().utf32_to_utf8,
+                     policy);
+}
+
+bool ValidUtf8(std::string_view in) {
+    return Validate(in.data(), in.size(), Active().ascii_prefix);
+}
+
+bool ValidUtf16(std::u16string_view in) {
+    return Validate(in.data(), in.size(), Active().bmp_prefix);
+}
+
+bool ToUtf16(std::wstring_view in, std::u16string *out, ErrorPolicy policy) {
+    if constexpr (sizeof(wchar_t) == sizeof(char16_t)) {
+        std::u16string_view units(
+            reinterpret_cast<const char16_t *>(in.data()), in.size());
+        if (ValidUtf16(units)) {
+            out->assign(units);
+            return true;
+        }
+        std::u32string code_points;
+        ToUtf32(units, &code_points, policy);
+        ToUtf16(code_points, out, policy);
+        return false;
+    } else {
+        return ToUtf16(
+            std::u32string_view(reinterpret_cast<const char32_t *>(in.data()),
+                                in.size()),
+            out, policy);
+    }
+}
+
+bool ToUtf8(std::wstring_view in, std::string *out, ErrorPolicy policy) {
+    if constexpr (sizeof(wchar_t) == sizeof(char16_t)) {
+        return ToUtf8(
+            std::u16string_view(reinterpret_cast<const char16_t *>(in.data()),
+                                in.size()),
+            out, policy);
+    } else {
+        return ToUtf8(
+            std::u32string_view(reinterpret_cast<const char32_t *>(in.data()),
+                                in.size()),
+            out, policy);
+    }
+}
+
+namespace {
+// Shared by the std::wstring and std::pmr::wstring overloads, so a string on
+// an arena is filled in place.
+template <typename Str>
+bool Utf16ToWide(std::u16string_view in, Str *out, ErrorPolicy policy) {
+    if constexpr (sizeof(wchar_t) == sizeof(char16_t)) {
+        if (ValidUtf16(in)) {
+            out->assign(reinterpret_cast<const wchar_t *>(in.data()),
+                        in.size());
+            return true;
+        }
+        std::u32string code_points;
+        ToUtf32(in, &code_points, policy);
+        std::u16string units;
+        ToUtf16(code_points, &units, policy);
+        out->assign(reinterpret_cast<const wchar_t *>(units.data()),
+                    units.size());
+        return false;
+    } else {
+        return Transcode(in.data(), in.size(), out,
+                         Active().utf16_to_utf32, policy);
+    }
+}
+}  // namespace
+
+bool ToWide(std::u16string_view in, std::wstring *out, ErrorPolicy policy) {
+    return Utf16ToWide(in, out, policy);
+}
+
+bool ToWide(std::u16string_view in, std::pmr::wstring *out,
+            ErrorPolicy policy) {
+    return Utf16ToWide(in, out, policy);
+}
+
+bool ToWide(std::string_view in, std::wstring *out, ErrorPolicy policy) {
+    if constexpr (sizeof(wchar_t) == sizeof(char16_t)) {
+        return Transcode(in.data(), in.size(), out, Active().utf8_to_utf16,
+                         policy);
+    } else {
+        return Transcode(in.data(), in.size(), out, Active().utf8_to_utf32,
+                         policy);
+    }
+}
+}  // namespace utils::utf
@@ -0,0 +1,65 @@
+#ifndef BSIT_3_UTF_HPP
+#define BSIT_3_UTF_HPP
+
+#include <memory_resource>
+#include <string>
+#include <string_view>
+
+#include "../alias.hpp"
+
+// Validating transcoding between UTF-8, UTF-16 and UTF-32. Runs of
+// characters that map one code unit to one code unit (ASCII for UTF-8,
+// BMP outside the surrogates for UTF-16/32) go through SSE4.1/AVX2 kernels
+// picked at runtime, everything else through a scalar decoder.
+namespace utils::utf {
+enum ErrorPolicy : u8 {
+    // Output ends before the first invalid sequence.
+    UTF_STRICT,
+    // Invalid sequences are written as U+FFFD and the output is complete.
+    UTF_REPLACE,
+};
+
+enum Isa : u8 {
+    ISA_SCALAR,
+    ISA_SSE41,
+    ISA_AVX2,
+};
+
+// Best instruction set of the host.
+Isa SupportedIsa();
+Isa ActiveIsa();
+// Selects the kernels, clamped to SupportedIsa(). Meant for benchmarks and
+// tests, not to be called while other threads transcode.
+void UseIsa(Isa isa);
+
+// All conversions return false if the input was not valid in its encoding.
+bool ToUtf16(std::u32string_view in, std::u16string *out,
+             ErrorPolicy policy = UTF_STRICT);
+bool ToUtf16(std::string_view in, std::u16string *out,
+             ErrorPolicy policy = UTF_STRICT);
+bool ToUtf32(std::u16string_view in, std::u32string *out,
+             ErrorPolicy policy = UTF_STRICT);
+bool ToUtf32(std::string_view in, std::u32string *out,
+             ErrorPolicy policy = UTF_STRICT);
+bool ToUtf8(std::u16string_view in, std::string *out,
+            ErrorPolicy policy = UTF_STRICT);
+bool ToUtf8(std::u32string_view in, std::string *out,
+            ErrorPolicy policy = UTF_STRICT);
+
+bool ValidUtf8(std::string_view in);
+bool ValidUtf16(std::u16string_view in);
+
+// wchar_t strings are UTF-16 on Windows and UTF-32 elsewhere.
+bool ToUtf16(std::wstring_view in, std::u16string *out,
+             ErrorPolicy policy = UTF_STRICT);
+bool ToUtf8(std::wstring_view in, std::string *out,
+            ErrorPolicy policy = UTF_STRICT);
+bool ToWide(std::u16string_view in, std::wstring *out,
+            ErrorPolicy policy = UTF_STRICT);
+bool ToWide(std::u16string_view in, std::pmr::wstring *out,
+            ErrorPolicy policy = UTF_STRICT);
+bool ToWide(std::string_view in, std::wstring *out,
+            ErrorPolicy policy = UTF_STRICT);
+}  // namespace utils::utf
+
+#endif
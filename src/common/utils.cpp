@@ -6,6 +6,7 @@
 #include <sstream>
 
 #include "data.hpp"
+#include "utf/utf.hpp"
 
 #ifdef _WIN32
 #include <windows.h>
@@ -204,15 +205,7 @@ void print_access_rights(const AccessRightsInfo &rightsInfo) {
 }
 std::string to_string(const std::wstring &wstr) {
     std::string res;
-    res.reserve(wstr.size());
-    for (wchar_t wc : wstr) {
-        if (wc <= 0x7F) {
-            res.push_back(static_cast<char>(wc));
-        } else {
-            throw std::runtime_error(
-                "to_string: non-ASCII character encountered");
-        }
-    }
+    utf::ToUtf8(wstr, &res, utf::UTF_REPLACE);
     return res;
 }
 }  // namespace utils
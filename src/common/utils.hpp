@@ -15,6 +15,7 @@ void print_access_rights(const AccessRightsInfo &rightsInfo);
 
 std::string format_time(u64 ms);
 
+// UTF-8, invalid characters are replaced with U+FFFD.
 std::string to_string(const std::wstring &wstr);
 }  // namespace utils
 
@@ -0,0 +1,62 @@
+#include "histogram.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+namespace loadgen {
+void Histogram::Record(u64 ns) {
+    m_counts[Index(ns)]++;
+    m_count++;
+    m_max = std::max(m_max, ns);
+}
+
+void Histogram::Merge(const Histogram &other) {
+    for (u32 i = 0; i < BUCKETS; i++) {
+        m_counts[i] += other.m_counts[i];
+    }
+    m_count += other.m_count;
+    m_max = std::max(m_max, other.m_max);
+}
+
+u64 Histogram::Count() const { return m_count; }
+
+u64 Histogram::Max() const { return m_max; }
+
+u64 Histogram::Percentile(double q) const {
+    if (m_count == 0) {
+        return 0;
+    }
+    auto rank = static_cast<u64>(std::ceil(q * static_cast<double>(m_count)));
+    rank = std::clamp<u64>(rank, 1, m_count);
+    u64 seen = 0;
+    for (u32 i = 0; i < BUCKETS; i++) {
+        seen += m_counts[i];
+        if (seen >= rank) {
+            return std::min(UpperBound(i), m_max);
+        }
+    }
+    return m_max;
+}
+
+// Values below SUB_BUCKETS get a bucket each, above that the top SUB_BITS
+// bits below the leading one pick the bucket within its power of two.
+u32 Histogram::Index(u64 ns) {
+    if (ns < SUB_BUCKETS) {
+        return static_cast<u32>(ns);
+    }
+    u32 exp = std::bit_width(ns) - 1;
+    u32 sub = static_cast<u32>(ns >> (exp - SUB_BITS)) & (SUB_BUCKETS - 1);
+    return (exp - SUB_BITS + 1) * SUB_BUCKETS + sub;
+}
+
+u64 Histogram::UpperBound(u32 index) {
+    if (index < SUB_BUCKETS) {
+        return index;
+    }
+    u32 exp = index / SUB_BUCKETS + SUB_BITS - 1;
+    u64 sub = index % SUB_BUCKETS;
+    u64 width = u64{1} << (exp - SUB_BITS);
+    return (u64{1} << exp) + (sub + 1) * width - 1;
+}
+}  // namespace loadgen
@@ -0,0 +1,41 @@
+#ifndef BSIT_3_HISTOGRAM_HPP
+#define BSIT_3_HISTOGRAM_HPP
+
+#include <array>
+
+#include "../common/alias.hpp"
+
+namespace loadgen {
+// Latency histogram in nanoseconds with log-linear buckets: every power of
+// two is split into SUB_BUCKETS equal parts, so values are kept to within
+// about 3% up to several hours. Recording is a few instructions and never
+// allocates, merging is a sum.
+class Histogram {
+public:
+    void Record(u64 ns);
+
+    void Merge(const Histogram &other);
+
+    [[nodiscard]] u64 Count() const;
+
+    [[nodiscard]] u64 Max() const;
+
+    // Smallest recorded value that q of all values are below or equal to,
+    // rounded up to its bucket. q is in [0, 1].
+    [[nodiscard]] u64 Percentile(double q) const;
+
+private:
+    static constexpr u32 SUB_BITS = 5;
+    static constexpr u32 SUB_BUCKETS = 1 << SUB_BITS;
+    static constexpr u32 BUCKETS = (64 - SUB_BITS + 1) * SUB_BUCKETS;
+
+    std::array<u64, BUCKETS> m_counts{};
+    u64 m_count = 0;
+    u64 m_max = 0;
+
+    static u32 Index(u64 ns);
+    static u64 UpperBound(u32 index);
+};
+}  // namespace loadgen
+
+#endif
@@ -0,0 +1,250 @@
+#include "loadgen.hpp"
+
+#include <algorithm>
+#include <barrier>
+#include <memory>
+#include <queue>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "../client/connector/connector.hpp"
+
+namespace loadgen {
+namespace {
+using clock = std::chrono::steady_clock;
+
+struct Session {
+    std::unique_ptr<connector::Connector> conn;
+    bool connected = false;
+    u64 requests = 0;
+    // When the next request is due.
+    clock::time_point next;
+};
+
+ERR Execute(connector::Connector *conn, proto::RequestType type,
+            const Config &cfg) {
+    const std::wstring &path = cfg.path;
+    switch (type) {
+        case proto::REQ_OS_INFO:
+            return conn->getOsInfo(nullptr);
+        case proto::REQ_TIME:
+            return conn->getTime(nullptr);
+        case proto::REQ_UPTIME:
+            return conn->getUptime(nullptr);
+        case proto::REQ_MEMORY:
+            return conn->getMemory(nullptr);
+        case proto::REQ_DRIVES:
+            return conn->getDrives(nullptr);
+        case proto::REQ_RIGHTS:
+            return conn->getRights(nullptr, path);
+        case proto::REQ_OWNER:
+            return conn->getOwner(nullptr, path);
+        case proto::REQ_RIGHTS_BULK: {
+            std::vector<PathRightsInfo> res;
+            return conn->getBulkRights(&res, {path}, cfg.depth);
+        }
+        case proto::REQ_OWNER_BULK: {
+            std::vector<PathOwnerInfo> res;
+            return conn->getBulkOwners(&res, {path}, cfg.depth);
+        }
+    }
+    return ERR_InvalidArgument;
+}
+
+class Worker {
+public:
+    Worker(const Config &cfg, u32 first, u32 count)
+        : m_cfg(cfg),
+          m_rng(first),
+          m_mix(cfg.mix.begin(), cfg.mix.end()),
+          m_first(first) {
+        for (u32 i = 0; i < count; i++) {
+            m_sessions.push_back(
+                {std::make_unique<connector::Connector>(first + i, cfg.host,
+                                                        cfg.port)});
+        }
+    }
+
+    void Connect() {
+        for (auto &session : m_sessions) {
+            Reconnect(&session);
+        }
+    }
+
+    void Run(clock::time_point start) {
+        auto end = start + m_cfg.duration;
+        auto later = [this](u32 a, u32 b) {
+            return m_sessions[a].next > m_sessions[b].next;
+        };
+        std::priority_queue<u32, std::vector<u32>, decltype(later)> due(later);
+        for (u32 i = 0; i < m_sessions.size(); i++) {
+            m_sessions[i].next = start + FirstGap(m_first + i);
+            due.push(i);
+        }
+
+        while (!due.empty()) {
+            u32 i = due.top();
+            due.pop();
+            Session &session = m_sessions[i];
+            if (session.next >= end) {
+                continue;
+            }
+            if (m_cfg.rate > 0) {
+                std::this_thread::sleep_until(session.next);
+            } else {
+                session.next = clock::now();
+            }
+            Step(&session);
+            m_result.elapsed = std::max(
+                m_result.elapsed,
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    clock::now() - start));
+            session.next = m_cfg.rate > 0 ? session.next + Gap() : clock::now();
+            due.push(i);
+        }
+
+        for (auto &session : m_sessions) {
+            session.conn->disconnect();
+        }
+    }
+
+    [[nodiscard]] const Result &result() const { return m_result; }
+
+private:
+    const Config &m_cfg;
+    std::vector<Session> m_sessions;
+    std::mt19937_64 m_rng;
+    std::discrete_distribution<u32> m_mix;
+    u32 m_first;
+    Result m_result;
+
+    // One request of a session, reconnecting first if the mode or the last
+    // error asks for it. The latency counts from session->next.
+    void Step(Session *session) {
+        if (!session->connected) {
+            Reconnect(session);
+        }
+        auto type = static_cast<proto::RequestType>(m_mix(m_rng));
+        ERR err = ERR_Ok;
+        if (session->connected) {
+            err = Execute(session->conn.get(), type, m_cfg);
+        }
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      clock::now() - session->next)
+                      .count();
+        if (!session->connected || err != ERR_Ok) {
+            // A failed request leaves the connector disconnected.
+            m_result.errors++;
+            session->connected = false;
+            return;
+        }
+        m_result.latency.Record(ns);
+        m_result.latencyByType[type].Record(ns);
+
+        session->requests++;
+        if (m_cfg.mode != MODE_STEADY &&
+            session->requests % m_cfg.reconnectEvery == 0) {
+            if (m_cfg.mode == MODE_HANDSHAKE) {
+                // Forgets the ticket.
+                session->conn->setServer(m_cfg.host, m_cfg.port);
+            }
+            session->conn->disconnect();
+            session->connected = false;
+        }
+    }
+
+    void Reconnect(Session *session) {
+        auto start = clock::now();
+        ERR err = session->conn->reconnect();
+        if (err != ERR_Ok) {
+            m_result.connectErrors++;
+            session->conn->disconnect();
+            return;
+        }
+        m_result.connect.Record(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() -
+                                                                 start)
+                .count());
+        session->connected = true;
+    }
+
+    // Mean time between two requests of one session.
+    [[nodiscard]] std::chrono::duration<double> Interval() const {
+        return std::chrono::duration<double>(m_cfg.sessions / m_cfg.rate);
+    }
+
+    clock::duration Gap() {
+        auto interval = Interval();
+        if (m_cfg.arrivals == ARRIVALS_POISSON) {
+            interval *= std::exponential_distribution<double>(1.0)(m_rng);
+        }
+        return std::chrono::duration_cast<clock::duration>(interval);
+    }
+
+    // Fixed arrivals are staggered over the first interval so the sessions
+    // do not fire in lockstep.
+    clock::duration FirstGap(u32 session) {
+        if (m_cfg.rate <= 0) {
+            return clock::duration::zero();
+        }
+        if (m_cfg.arrivals == ARRIVALS_POISSON) {
+            return Gap();
+        }
+        return std::chrono::duration_cast<clock::duration>(Interval() *
+                                                           session) /
+               m_cfg.sessions;
+    }
+};
+}  // namespace
+
+void Result::Merge(const Result &other) {
+    latency.Merge(other.latency);
+    for (u32 i = 0; i < REQUEST_TYPES; i++) {
+        latencyByType[i].Merge(other.latencyByType[i]);
+    }
+    connect.Merge(other.connect);
+    errors += other.errors;
+    connectErrors += other.connectErrors;
+    elapsed = std::max(elapsed, other.elapsed);
+}
+
+Result Run(const Config &cfg) {
+    u32 threads = cfg.threads ? cfg.threads : MAX_THREADS;
+    threads = std::clamp<u32>(threads, 1, std::max<u32>(cfg.sessions, 1));
+
+    // Sessions are dealt out in contiguous slices, the first ones get the
+    // remainder.
+    std::vector<std::unique_ptr<Worker>> workers;
+    u32 first = 0;
+    for (u32 i = 0; i < threads; i++) {
+        u32 count = cfg.sessions / threads + (i < cfg.sessions % threads);
+        workers.push_back(std::make_unique<Worker>(cfg, first, count));
+        first += count;
+    }
+
+    // The clock starts once every session has connected, so the initial
+    // handshakes do not count against the rate.
+    clock::time_point start;
+    std::barrier connected(threads, [&start]() noexcept {
+        start = clock::now();
+    });
+    std::vector<std::thread> pool;
+    for (auto &worker : workers) {
+        pool.emplace_back([&worker, &connected, &start] {
+            worker->Connect();
+            connected.arrive_and_wait();
+            worker->Run(start);
+        });
+    }
+    for (auto &thread : pool) {
+        thread.join();
+    }
+
+    Result res;
+    for (const auto &worker : workers) {
+        res.Merge(worker->result());
+    }
+    return res;
+}
+}  // namespace loadgen
@@ -0,0 +1,83 @@
+#ifndef BSIT_3_LOADGEN_HPP
+#define BSIT_3_LOADGEN_HPP
+
+#include <array>
+#include <chrono>
+#include <string>
+
+#include "../common/alias.hpp"
+#include "../common/proto/request.hpp"
+#include "histogram.hpp"
+
+namespace loadgen {
+constexpr u32 REQUEST_TYPES = proto::REQ_OWNER_BULK + 1;
+
+inline const char *requestName[REQUEST_TYPES] = {
+    "os_info", "time",  "uptime",      "memory",     "drives",
+    "rights",  "owner", "bulk_rights", "bulk_owner",
+};
+
+enum Mode : u8 {
+    // Every session connects once and keeps its connection.
+    MODE_STEADY,
+    // Sessions reconnect every Config::reconnectEvery requests and resume
+    // with their ticket.
+    MODE_CHURN,
+    // Same as churn, but tickets are dropped so every reconnect runs the
+    // full key exchange.
+    MODE_HANDSHAKE,
+};
+
+enum Arrivals : u8 {
+    // Requests of a session are evenly spaced.
+    ARRIVALS_FIXED,
+    // Exponential gaps, the merged stream of all sessions is Poisson.
+    ARRIVALS_POISSON,
+};
+
+struct Config {
+    std::string host;
+    u16 port = 6969;
+    u32 sessions = 100;
+    // Blocking worker threads the sessions are spread over, 0 picks one per
+    // session up to MAX_THREADS.
+    u32 threads = 0;
+    // Requests per second over all sessions. 0 runs closed loop: every
+    // session sends its next request as soon as the last one completed.
+    double rate = 0;
+    Arrivals arrivals = ARRIVALS_FIXED;
+    Mode mode = MODE_STEADY;
+    u32 reconnectEvery = 1;
+    std::chrono::seconds duration = std::chrono::seconds(10);
+    // Relative weight of every RequestType in the mix.
+    std::array<u32, REQUEST_TYPES> mix = {1, 1, 1, 1, 1, 0, 0, 0, 0};
+    // Argument of rights and owner requests, root of bulk ones.
+    std::wstring path = L"C:\\Windows";
+    // Levels below path a bulk request walks.
+    u8 depth = 1;
+};
+
+struct Result {
+    // Latency of every request. With a rate it is measured from the time
+    // the request was due rather than from when it was sent, so a stalled
+    // server shows up as queueing instead of being hidden by the requests
+    // that were never sent (coordinated omission).
+    Histogram latency;
+    std::array<Histogram, REQUEST_TYPES> latencyByType;
+    // Time spent in reconnect(), key exchange or resumption included.
+    Histogram connect;
+    u64 errors = 0;
+    u64 connectErrors = 0;
+    std::chrono::nanoseconds elapsed{0};
+
+    void Merge(const Result &other);
+};
+
+constexpr u32 MAX_THREADS = 256;
+
+// Connects cfg.sessions sessions, drives the request mix for cfg.duration
+// and returns the merged statistics of all of them.
+Result Run(const Config &cfg);
+}  // namespace loadgen
+
+#endif
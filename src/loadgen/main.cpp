@@ -0,0 +1,149 @@
+#include <algorithm>
+#include <cstdio>
+#include <exception>
+#include <numeric>
+#include <string>
+
+#include "../common/logging.hpp"
+#include "../common/proto/handshake.hpp"
+#include "loadgen.hpp"
+
+namespace {
+void PrintUsage() {
+    fprintf(stderr,
+            "usage: loadgen <host> <port> [options]\n"
+            "  --sessions N          concurrent sessions (100)\n"
+            "  --threads N           worker threads (one per session, at "
+            "most %u)\n"
+            "  --rate R              requests/s over all sessions, 0 runs "
+            "closed loop (0)\n"
+            "  --arrivals fixed|poisson\n"
+            "  --mode steady|churn|handshake\n"
+            "  --reconnect-every N   requests per connection in churn and "
+            "handshake modes (1)\n"
+            "  --duration S          seconds (10)\n"
+            "  --mix type=weight,... request types: os_info time uptime "
+            "memory drives rights owner bulk_rights bulk_owner\n"
+            "  --path P              argument of rights and owner requests, "
+            "root of bulk ones\n"
+            "  --depth N             levels below --path bulk requests walk "
+            "(1)\n"
+            "  --security aead|mac|none  lowest protection to accept "
+            "(aead)\n",
+            loadgen::MAX_THREADS);
+}
+
+bool ParseMix(const std::string &str,
+              std::array<u32, loadgen::REQUEST_TYPES> *mix) {
+    mix->fill(0);
+    usize pos = 0;
+    while (pos < str.size()) {
+        usize comma = str.find(',', pos);
+        if (comma == std::string::npos) comma = str.size();
+        std::string item = str.substr(pos, comma - pos);
+        pos = comma + 1;
+
+        usize eq = item.find('=');
+        std::string name = item.substr(0, eq);
+        u32 weight =
+            eq == std::string::npos ? 1 : std::stoul(item.substr(eq + 1));
+        bool found = false;
+        for (u32 i = 0; i < loadgen::REQUEST_TYPES; i++) {
+            if (name == loadgen::requestName[i]) {
+                (*mix)[i] = weight;
+                found = true;
+            }
+        }
+        if (!found) {
+            WARN("Unknown request type %s", name.c_str());
+            return false;
+        }
+    }
+    return std::accumulate(mix->begin(), mix->end(), 0u) > 0;
+}
+
+bool ParseArgs(int argc, char **argv, loadgen::Config *cfg) {
+    if (argc < 3) return false;
+    cfg->host = argv[1];
+    cfg->port = std::stoi(argv[2]);
+    for (int i = 3; i + 1 < argc; i += 2) {
+        std::string opt = argv[i];
+        std::string val = argv[i + 1];
+        if (opt == "--sessions") {
+            cfg->sessions = std::stoul(val);
+        } else if (opt == "--threads") {
+            cfg->threads = std::stoul(val);
+        } else if (opt == "--rate") {
+            cfg->rate = std::stod(val);
+        } else if (opt == "--arrivals" && val == "fixed") {
+            cfg->arrivals = loadgen::ARRIVALS_FIXED;
+        } else if (opt == "--arrivals" && val == "poisson") {
+            cfg->arrivals = loadgen::ARRIVALS_POISSON;
+        } else if (opt == "--mode" && val == "steady") {
+            cfg->mode = loadgen::MODE_STEADY;
+        } else if (opt == "--mode" && val == "churn") {
+            cfg->mode = loadgen::MODE_CHURN;
+        } else if (opt == "--mode" && val == "handshake") {
+            cfg->mode = loadgen::MODE_HANDSHAKE;
+        } else if (opt == "--reconnect-every") {
+            cfg->reconnectEvery = std::max<u32>(1, std::stoul(val));
+        } else if (opt == "--duration") {
+            cfg->duration = std::chrono::seconds(std::stoul(val));
+        } else if (opt == "--mix") {
+            if (!ParseMix(val, &cfg->mix)) return false;
+        } else if (opt == "--path") {
+            cfg->path.assign(val.begin(), val.end());
+        } else if (opt == "--security") {
+            u32 levels;
+            if (!proto::ParseSecurityLevel(val, &levels)) return false;
+            proto::AllowSecurityLevels(levels);
+        } else if (opt == "--depth") {
+            cfg->depth =
+                static_cast<u8>(std::min<u32>(std::stoul(val), UINT8_MAX));
+        } else {
+            WARN("Unknown option %s %s", opt.c_str(), val.c_str());
+            return false;
+        }
+    }
+    return (argc - 3) % 2 == 0 && cfg->sessions > 0;
+}
+
+// Same shape as the proto_bench output, one JSON object per line.
+void Report(const char *name, const loadgen::Histogram &hist, u64 errors,
+            double seconds) {
+    printf("{\"loadgen\":\"%s\",\"count\":%llu,\"errors\":%llu,"
+           "\"per_s\":%.3f,\"p50_us\":%.3f,\"p99_us\":%.3f,"
+           "\"p999_us\":%.3f,\"max_us\":%.3f}\n",
+           name, static_cast<unsigned long long>(hist.Count()),
+           static_cast<unsigned long long>(errors),
+           seconds > 0 ? hist.Count() / seconds : 0.0,
+           hist.Percentile(0.5) / 1e3, hist.Percentile(0.99) / 1e3,
+           hist.Percentile(0.999) / 1e3, hist.Max() / 1e3);
+    fflush(stdout);
+}
+}  // namespace
+
+int main(int argc, char **argv) {
+    loadgen::Config cfg;
+    try {
+        if (!ParseArgs(argc, argv, &cfg)) {
+            PrintUsage();
+            return 1;
+        }
+    } catch (const std::exception &) {
+        PrintUsage();
+        return 1;
+    }
+
+    auto res = loadgen::Run(cfg);
+    double seconds = std::chrono::duration<double>(res.elapsed).count();
+    Report("requests", res.latency, res.errors, seconds);
+    Report("connect", res.connect, res.connectErrors, seconds);
+    for (u32 i = 0; i < loadgen::REQUEST_TYPES; i++) {
+        if (res.latencyByType[i].Count()) {
+            Report(loadgen::requestName[i], res.latencyByType[i], 0, seconds);
+        }
+    }
+
+    return 0;
+}
@@ -1,11 +1,40 @@
+#include "../common/proto/handshake.hpp"
+#include "os_utils/fake.hpp"
 #include "server/handlers.hpp"
 
 int main(int argc, char **argv) {
     u16 port = 6969;
-    if (argc == 2) {
+    if (argc >= 2) {
         auto portStr = std::string(argv[1]);
         port = std::stoi(portStr);
     }
+    // Lowest protection clients may pick: aead (default), mac or none. Only
+    // for links that are trusted or already encrypted.
+    if (argc >= 3) {
+        auto level = std::string(argv[2]);
+        u32 levels = 0;
+        if (!proto::ParseSecurityLevel(level, &levels)) {
+            WARN("Unknown security level %s, using aead", level.c_str());
+            level = "aead";
+        }
+        proto::AllowSecurityLevels(levels);
+        INFO("Lowest security level %s", level.c_str());
+    }
+    // Where answers come from: os (default) or fake[:<FakeConfig spec>] for
+    // benchmarks that should not depend on the host.
+    if (argc >= 4) {
+        auto provider = std::string(argv[3]);
+        os_utils::FakeConfig cfg;
+        bool fake = provider == "fake" || provider.rfind("fake:", 0) == 0;
+        if (fake && os_utils::ParseFakeConfig(
+                        provider.size() > 5 ? provider.substr(5) : "", &cfg)) {
+            os_utils::g_provider = new os_utils::FakeProvider(cfg);
+        } else if (provider != "os") {
+            WARN("Unknown provider %s, using os", provider.c_str());
+        }
+    }
+    os_utils::init();
+    INFO("Using %s provider", os_utils::g_provider->Name());
     INFO("Using port %d", port);
     server::tcp::Server srv(port);
     server::handlers::Init(&srv);
@@ -0,0 +1,79 @@
+#include "drive_probe.hpp"
+
+#include <algorithm>
+#include <system_error>
+#include <thread>
+
+#include "../../common/logging.hpp"
+
+namespace os_utils {
+DriveProber::DriveProber(std::chrono::milliseconds deadline,
+                         std::chrono::milliseconds ttl)
+    : m_deadline(deadline), m_ttl(ttl) {}
+
+std::vector<DriveInfo> DriveProber::Probe(std::vector<MountProbe> mounts) {
+    auto deadline = clock::now() + m_deadline;
+    std::unique_lock lock(m_state->lock);
+
+    for (auto &mount : mounts) {
+        Entry &entry = m_state->entries[mount.name];
+        if (entry.inFlight ||
+            (entry.known && clock::now() - entry.probedAt < m_ttl)) {
+            continue;
+        }
+        entry.inFlight = true;
+        try {
+            std::thread([state = m_state, name = mount.name,
+                         probe = std::move(mount.probe)] {
+                DriveInfo info(DRIVE_TYPE_UNKNOWN, name, 0);
+                bool listed = probe(&info);
+                std::lock_guard lock(state->lock);
+                Entry &entry = state->entries[name];
+                entry.inFlight = false;
+                entry.known = true;
+                entry.listed = listed;
+                entry.last = std::move(info);
+                entry.probedAt = clock::now();
+                state->done.notify_all();
+            }).detach();
+        } catch (const std::system_error &e) {
+            WARN("Failed to probe %s: %s", mount.name.c_str(), e.what());
+            entry.inFlight = false;
+        }
+    }
+
+    m_state->done.wait_until(lock, deadline, [&] {
+        return std::none_of(mounts.begin(), mounts.end(), [&](auto &mount) {
+            return m_state->entries[mount.name].inFlight;
+        });
+    });
+
+    std::vector<DriveInfo> drives;
+    drives.reserve(mounts.size());
+    for (const auto &mount : mounts) {
+        const Entry &entry = m_state->entries[mount.name];
+        if (entry.known && !entry.listed) {
+            continue;
+        }
+        if (entry.known) {
+            drives.push_back(entry.last);
+        } else {
+            drives.emplace_back(DRIVE_TYPE_UNKNOWN, mount.name, 0);
+        }
+        if (entry.inFlight) {
+            WARN("Drive %s did not answer in time", mount.name.c_str());
+            drives.back().stale = true;
+        }
+    }
+
+    // Forget mounts that are gone, unless their probe is still running.
+    std::erase_if(m_state->entries, [&](const auto &item) {
+        return !item.second.inFlight &&
+               std::none_of(mounts.begin(), mounts.end(), [&](auto &mount) {
+                   return mount.name == item.first;
+               });
+    });
+
+    return drives;
+}
+}  // namespace os_utils
@@ -0,0 +1,65 @@
+#ifndef BSIT_3_DRIVE_PROBE_HPP
+#define BSIT_3_DRIVE_PROBE_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../../common/data.hpp"
+
+namespace os_utils {
+constexpr auto DRIVE_PROBE_DEADLINE = std::chrono::milliseconds(500);
+// Results younger than this are reused without probing the mount again.
+constexpr auto DRIVE_CACHE_TTL = std::chrono::seconds(2);
+
+struct MountProbe {
+    std::string name;
+    // Fills in the type and free bytes of the drive, may block for as long
+    // as the mount does. Returning false drops the mount from the list.
+    std::function<bool(DriveInfo *)> probe;
+};
+
+// Probes every mount on a thread of its own and waits for at most the
+// deadline. A mount that did not answer in time is reported with its last
+// known value and marked stale; it is not probed again until the hung probe
+// returns, so a dead network share costs one blocked thread, not one per
+// request.
+class DriveProber {
+public:
+    explicit DriveProber(
+        std::chrono::milliseconds deadline = DRIVE_PROBE_DEADLINE,
+        std::chrono::milliseconds ttl = DRIVE_CACHE_TTL);
+
+    // Drives in the order of mounts.
+    std::vector<DriveInfo> Probe(std::vector<MountProbe> mounts);
+
+private:
+    using clock = std::chrono::steady_clock;
+
+    struct Entry {
+        bool inFlight = false;
+        bool known = false;
+        bool listed = false;
+        DriveInfo last;
+        clock::time_point probedAt;
+    };
+
+    // Shared with the probe threads, which may outlive a request.
+    struct State {
+        std::mutex lock;
+        std::condition_variable done;
+        std::unordered_map<std::string, Entry> entries;
+    };
+
+    std::chrono::milliseconds m_deadline;
+    std::chrono::milliseconds m_ttl;
+    std::shared_ptr<State> m_state = std::make_shared<State>();
+};
+}  // namespace os_utils
+
+#endif
@@ -0,0 +1,178 @@
+#include "fake.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string_view>
+#include <thread>
+
+namespace os_utils {
+namespace {
+// 2024-10-19 12:00 UTC.
+constexpr u64 FAKE_TIME_MS = 1729339200000;
+constexpr u64 FAKE_UPTIME_MS = 3 * 24 * 3600 * 1000ull;
+
+// FNV-1a over the code units, stable across runs unlike std::hash.
+u64 HashPath(const std::wstring &path) {
+    u64 hash = 14695981039346656037ull;
+    for (wchar_t c : path) {
+        hash ^= static_cast<u64>(c);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// S-1-5-21-<domain>-<rid> in the binary layout GetLengthSid reports.
+std::array<u8, 32> MakeSid(u32 rid) {
+    std::array<u8, 32> sid{};
+    const u32 sub_auths[] = {21, 3623811015, 3361044348, 30300820, rid};
+    sid[0] = 1;
+    sid[1] = 5;
+    sid[7] = 5;
+    for (usize i = 0; i < 5; i++) {
+        std::memcpy(sid.data() + 8 + i * sizeof(u32), &sub_auths[i],
+                    sizeof(u32));
+    }
+    return sid;
+}
+}  // namespace
+
+bool ParseFakeConfig(const std::string &spec, FakeConfig *cfg) {
+    usize pos = 0;
+    while (pos < spec.size()) {
+        usize comma = spec.find(',', pos);
+        if (comma == std::string::npos) comma = spec.size();
+        std::string item = spec.substr(pos, comma - pos);
+        pos = comma + 1;
+
+        unsigned long val;
+        char key[32];
+        if (sscanf(item.c_str(), "%31[a-z_]=%lu", key, &val) != 2) {
+            return false;
+        }
+        if (!std::strcmp(key, "drives")) {
+            cfg->drives = val;
+        } else if (!std::strcmp(key, "aces")) {
+            cfg->aces = val;
+        } else if (!std::strcmp(key, "owners")) {
+            cfg->owners = std::max(1ul, val);
+        } else if (!std::strcmp(key, "dirs")) {
+            cfg->dirs = val;
+        } else if (!std::strcmp(key, "files")) {
+            cfg->files = val;
+        } else if (!std::strcmp(key, "latency_us")) {
+            cfg->latency = std::chrono::microseconds(val);
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+FakeProvider::FakeProvider(const FakeConfig &cfg) : m_cfg(cfg) {}
+
+const char *FakeProvider::Name() const { return "fake"; }
+
+OSType FakeProvider::GetType() {
+    Wait();
+    return OS_WIN64;
+}
+
+OSVersion FakeProvider::GetVersion() {
+    Wait();
+    return {10, 0};
+}
+
+u64 FakeProvider::GetUptimeMs() {
+    Wait();
+    return FAKE_UPTIME_MS;
+}
+
+u64 FakeProvider::GetTimeMs() {
+    Wait();
+    return FAKE_TIME_MS;
+}
+
+i8 FakeProvider::GetTimezoneHours() {
+    Wait();
+    return 3;
+}
+
+MemInfo FakeProvider::GetMeminfo() {
+    Wait();
+    return {32_GB, 11_GB};
+}
+
+std::vector<DriveInfo> FakeProvider::GetDrives() {
+    Wait();
+    std::vector<DriveInfo> drives;
+    drives.reserve(m_cfg.drives);
+    for (u32 i = 0; i < m_cfg.drives; i++) {
+        char name[64];
+        if (i < 26) {
+            snprintf(name, sizeof(name), "%c:\\", 'A' + i);
+        } else {
+            snprintf(name, sizeof(name), "\\\\fileserver\\share%04u\\", i);
+        }
+        drives.emplace_back(i % 4 ? DRIVE_TYPE_NET : DRIVE_TYPE_LOCAL, name,
+                            (i + 1) * 7_GB + i * 4096ull);
+    }
+    return drives;
+}
+
+AccessRightsInfo FakeProvider::GetAccessInfo(const std::wstring &path,
+                                             ERR *err) {
+    Wait();
+    *err = ERR_Ok;
+    u64 hash = HashPath(path);
+    AccessRightsInfo rights;
+    rights.entries.reserve(m_cfg.aces);
+    for (u32 i = 0; i < m_cfg.aces; i++) {
+        rights.entries.push_back({
+            .sid = MakeSid(1000 + (hash + i) % m_cfg.owners),
+            .aceType = i % 8 ? ACE_TYPE_ALLOWED : ACE_TYPE_DENIED,
+            .scope = static_cast<Scope>(i % 3),
+            .accessMask = i % 2 ? 0x001F01FFu : 0x001200A9u,
+        });
+    }
+    return rights;
+}
+
+OwnerInfo FakeProvider::GetOwnerInfo(const std::wstring &path, ERR *err) {
+    Wait();
+    *err = ERR_Ok;
+    auto owner = static_cast<u32>(HashPath(path) % m_cfg.owners);
+    return {"user" + std::to_string(owner), "FAKE", MakeSid(1000 + owner)};
+}
+
+ERR FakeProvider::ListDirectory(const std::wstring &path,
+                                std::vector<DirEntry> *entries) {
+    Wait();
+    usize slash = path.find_last_of(L"\\/");
+    std::wstring_view name(path);
+    if (slash != std::wstring::npos) {
+        name.remove_prefix(slash + 1);
+    }
+    if (name.starts_with(L"file")) {
+        return ERR_Ok;
+    }
+    std::wstring base = path;
+    if (!base.empty() && base.back() != L'\\') {
+        base += L'\\';
+    }
+    entries->reserve(entries->size() + m_cfg.dirs + m_cfg.files);
+    for (u32 i = 0; i < m_cfg.dirs; i++) {
+        entries->push_back({base + L"dir" + std::to_wstring(i), true});
+    }
+    for (u32 i = 0; i < m_cfg.files; i++) {
+        entries->push_back({base + L"file" + std::to_wstring(i), false});
+    }
+    return ERR_Ok;
+}
+
+void FakeProvider::Wait() const {
+    if (m_cfg.latency.count()) {
+        std::this_thread::sleep_for(m_cfg.latency);
+    }
+}
+}  // namespace os_utils
@@ -0,0 +1,56 @@
+#ifndef BSIT_3_FAKE_HPP
+#define BSIT_3_FAKE_HPP
+
+#include <chrono>
+#include <string>
+
+#include "os_utils.hpp"
+
+namespace os_utils {
+struct FakeConfig {
+    u32 drives = 4;
+    // Entries of every ACL, spread over owners distinct SIDs.
+    u32 aces = 8;
+    // Number of distinct owners, the owner of a path is picked by its hash.
+    u32 owners = 4;
+    // Children of every directory. Any path is a directory unless its last
+    // component is one of the files, so the tree is as deep as a walk asks.
+    u32 dirs = 4;
+    u32 files = 16;
+    // Added to every call, to model a slow backend.
+    std::chrono::microseconds latency{0};
+};
+
+// Parses "drives=N,aces=N,owners=N,dirs=N,files=N,latency_us=N", every key
+// is optional.
+bool ParseFakeConfig(const std::string &spec, FakeConfig *cfg);
+
+// Synthetic host: same answers for the same config and path on every run
+// and machine, sized by FakeConfig. The clock is frozen too.
+class FakeProvider : public Provider {
+public:
+    explicit FakeProvider(const FakeConfig &cfg);
+
+    const char *Name() const override;
+
+    OSType GetType() override;
+    OSVersion GetVersion() override;
+    u64 GetUptimeMs() override;
+    u64 GetTimeMs() override;
+    i8 GetTimezoneHours() override;
+    MemInfo GetMeminfo() override;
+    std::vector<DriveInfo> GetDrives() override;
+    AccessRightsInfo GetAccessInfo(const std::wstring &path,
+                                   ERR *err) override;
+    OwnerInfo GetOwnerInfo(const std::wstring &path, ERR *err) override;
+    ERR ListDirectory(const std::wstring &path,
+                      std::vector<DirEntry> *entries) override;
+
+private:
+    FakeConfig m_cfg;
+
+    void Wait() const;
+};
+}  // namespace os_utils
+
+#endif
@@ -0,0 +1,335 @@
+#include "info_cache.hpp"
+
+#include <algorithm>
+#include <cwctype>
+#include <string_view>
+#include <utility>
+
+namespace os_utils {
+namespace {
+#if defined(_WIN32)
+constexpr wchar_t SEP = L'\\';
+// A UNC path starts with two.
+constexpr usize ROOT_SEPS = 2;
+
+bool IsSep(wchar_t c) { return c == L'\\' || c == L'/'; }
+#else
+constexpr wchar_t SEP = L'/';
+constexpr usize ROOT_SEPS = 1;
+
+bool IsSep(wchar_t c) { return c == L'/'; }
+#endif
+
+// Length of the root of a canonical key, 0 for a relative one.
+usize RootSize(const std::wstring &key) {
+    usize size = 0;
+    while (size < key.size() && size < ROOT_SEPS && key[size] == SEP) {
+        size++;
+    }
+#if defined(_WIN32)
+    if (size == 0 && key.size() >= 3 && key[1] == L':' && key[2] == SEP) {
+        size = 3;
+    }
+#endif
+    return size;
+}
+
+// Rough heap footprint of an entry: the node, the key in the map and the
+// LRU list, and what the infos own.
+usize SizeOf(const std::wstring &key, const AccessRightsInfo &rights,
+             const OwnerInfo &owner) {
+    constexpr usize NODES = 64;
+    return NODES + 2 * key.capacity() * sizeof(wchar_t) +
+           rights.entries.capacity() * sizeof(AccessControlEntry) +
+           owner.ownerName.capacity() + owner.ownerDomain.capacity();
+}
+}  // namespace
+
+InfoCache::InfoCache(Provider *provider, usize bytes,
+                     std::chrono::seconds ttl,
+                     std::chrono::seconds unwatched_ttl,
+                     std::chrono::seconds negative_ttl)
+    : m_provider(provider),
+      m_shardBytes(std::max<usize>(1, bytes / SHARDS)),
+      m_ttl(ttl),
+      m_unwatchedTtl(unwatched_ttl),
+      m_negativeTtl(negative_ttl) {
+    m_watcher = provider->WatchChanges(
+        [this](const std::wstring &dir, const std::wstring &name) {
+            Changed(dir, name);
+        });
+}
+
+InfoCache::~InfoCache() { m_watcher.reset(); }
+
+AccessRightsInfo InfoCache::GetAccessInfo(const std::wstring &path,
+                                          ERR *err) {
+    return Lookup(
+        path, &Entry::rights,
+        [this](const std::wstring &p, ERR *e) {
+            return m_provider->GetAccessInfo(p, e);
+        },
+        err);
+}
+
+OwnerInfo InfoCache::GetOwnerInfo(const std::wstring &path, ERR *err) {
+    return Lookup(
+        path, &Entry::owner,
+        [this](const std::wstring &p, ERR *e) {
+            return m_provider->GetOwnerInfo(p, e);
+        },
+        err);
+}
+
+template <typename T, typename F>
+T InfoCache::Lookup(const std::wstring &path, Slot<T> Entry::*slot,
+                    F &&resolve, ERR *err) {
+    std::wstring key = Canonical(path);
+    Shard &shard = ShardOf(key);
+    u64 generation;
+    {
+        std::lock_guard lock(shard.lock);
+        Entry &entry = Find(shard, key);
+        const Slot<T> &cached = entry.*slot;
+        if (cached.valid && clock::now() < cached.expires) {
+            if (cached.err == ERR_Ok) {
+                m_hits.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                m_negativeHits.fetch_add(1, std::memory_order_relaxed);
+            }
+            *err = cached.err;
+            return cached.info;
+        }
+        generation = entry.generation;
+    }
+
+    m_misses.fetch_add(1, std::memory_order_relaxed);
+    T info = resolve(path, err);
+    // Other errors may well be gone on the next try.
+    if (*err != ERR_Ok && *err != ERR_Path_not_found) {
+        return info;
+    }
+
+    std::lock_guard lock(shard.lock);
+    auto it = shard.entries.find(key);
+    if (it == shard.entries.end() || it->second.generation != generation) {
+        return info;
+    }
+    Entry &entry = it->second;
+    Slot<T> &cached = entry.*slot;
+    cached.info = info;
+    cached.err = *err;
+    cached.valid = true;
+    cached.expires = clock::now() + (*err != ERR_Ok ? m_negativeTtl
+                                     : entry.watched ? m_ttl
+                                                     : m_unwatchedTtl);
+    Resize(shard, key, entry);
+    Evict(shard);
+    return info;
+}
+
+void InfoCache::Invalidate(const std::wstring &path) {
+    if (path.empty()) {
+        for (auto &shard : m_shards) {
+            std::lock_guard lock(shard.lock);
+            for (auto &[key, entry] : shard.entries) {
+                Reset(shard, key, entry);
+            }
+        }
+        return;
+    }
+    std::wstring key = Canonical(path);
+    Shard &shard = ShardOf(key);
+    std::lock_guard lock(shard.lock);
+    auto it = shard.entries.find(key);
+    if (it != shard.entries.end()) {
+        Reset(shard, key, it->second);
+    }
+}
+
+InfoCache::Stats InfoCache::GetStats() const {
+    return {
+        .hits = m_hits.load(std::memory_order_relaxed),
+        .negativeHits = m_negativeHits.load(std::memory_order_relaxed),
+        .misses = m_misses.load(std::memory_order_relaxed),
+        .invalidations = m_invalidations.load(std::memory_order_relaxed),
+        .evictions = m_evictions.load(std::memory_order_relaxed),
+        .bytes = m_bytes.load(std::memory_order_relaxed),
+    };
+}
+
+std::wstring InfoCache::Canonical(const std::wstring &path) {
+    std::wstring key;
+    key.reserve(path.size());
+    usize i = 0;
+    while (i < path.size() && i < ROOT_SEPS && IsSep(path[i])) {
+        key += SEP;
+        i++;
+    }
+    // Other leading separators are only repeated ones.
+    while (i < path.size() && IsSep(path[i])) {
+        i++;
+    }
+    usize root = key.size();
+    while (i < path.size()) {
+        usize end = i;
+        while (end < path.size() && !IsSep(path[end])) {
+            end++;
+        }
+        std::wstring_view part(path.data() + i, end - i);
+        if (!part.empty() && part != L".") {
+            if (key.size() > root) {
+                key += SEP;
+            }
+            key += part;
+#if defined(_WIN32)
+            // "C:\" is the root of the drive, "C:" its working directory.
+            if (root == 0 && key.size() == 2 && key[1] == L':' &&
+                end < path.size()) {
+                key += SEP;
+                root = key.size();
+            }
+#endif
+        }
+        i = end + 1;
+    }
+#if defined(_WIN32)
+    for (auto &c : key) {
+        c = static_cast<wchar_t>(std::towlower(c));
+    }
+#endif
+    if (key.empty()) {
+        key = L".";
+    }
+    return key;
+}
+
+std::wstring InfoCache::Parent(const std::wstring &key) {
+    usize root = RootSize(key);
+    usize pos = key.rfind(SEP);
+    std::wstring_view name(key);
+    name.remove_prefix(pos == std::wstring::npos ? 0 : pos + 1);
+    // The parent of ".." is not what a lexical parent would say.
+    if (key.size() <= root || name == L"." || name == L"..") {
+        return L"";
+    }
+    if (pos == std::wstring::npos || pos < root) {
+        return root ? key.substr(0, root) : L".";
+    }
+    return key.substr(0, pos);
+}
+
+InfoCache::Shard &InfoCache::ShardOf(const std::wstring &key) {
+    return m_shards[std::hash<std::wstring>()(key) % SHARDS];
+}
+
+InfoCache::Entry &InfoCache::Find(Shard &shard, const std::wstring &key) {
+    auto it = shard.entries.find(key);
+    if (it != shard.entries.end()) {
+        shard.lru.splice(shard.lru.begin(), shard.lru, it->second.lru);
+        return it->second;
+    }
+    shard.lru.push_front(key);
+    Entry &entry = shard.entries[key];
+    entry.lru = shard.lru.begin();
+    std::wstring dir = Parent(key);
+    entry.watched = !dir.empty() && WatchDir(dir);
+    Resize(shard, key, entry);
+    Evict(shard);
+    return entry;
+}
+
+void InfoCache::Reset(Shard &shard, const std::wstring &key, Entry &entry) {
+    if (entry.rights.valid || entry.owner.valid) {
+        m_invalidations.fetch_add(1, std::memory_order_relaxed);
+    }
+    entry.rights = {};
+    entry.owner = {};
+    entry.generation++;
+    Resize(shard, key, entry);
+}
+
+void InfoCache::Resize(Shard &shard, const std::wstring &key, Entry &entry) {
+    usize bytes = SizeOf(key, entry.rights.info, entry.owner.info);
+    shard.bytes = shard.bytes - entry.bytes + bytes;
+    // Unsigned wrap-around makes this a subtraction for a smaller entry.
+    m_bytes.fetch_add(bytes - entry.bytes, std::memory_order_relaxed);
+    entry.bytes = bytes;
+}
+
+void InfoCache::Evict(Shard &shard) {
+    while (shard.bytes > m_shardBytes && shard.lru.size() > 1) {
+        Erase(shard, shard.entries.find(shard.lru.back()));
+        m_evictions.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void InfoCache::Erase(Shard &shard,
+                      std::unordered_map<std::wstring, Entry>::iterator it) {
+    Entry &entry = it->second;
+    shard.bytes -= entry.bytes;
+    m_bytes.fetch_sub(entry.bytes, std::memory_order_relaxed);
+    if (entry.watched) {
+        UnwatchDir(Parent(it->first));
+    }
+    shard.lru.erase(entry.lru);
+    shard.entries.erase(it);
+}
+
+void InfoCache::Changed(const std::wstring &dir, const std::wstring &name) {
+    if (dir.empty()) {
+        Invalidate(L"");
+        return;
+    }
+    if (name.empty()) {
+        Unwatched(dir);
+    } else if (dir == L".") {
+        Invalidate(name);
+    } else if (dir.back() == SEP) {
+        Invalidate(dir + name);
+    } else {
+        Invalidate(dir + SEP + name);
+    }
+}
+
+void InfoCache::Unwatched(const std::wstring &dir) {
+    // Paths added from now on watch the directory anew, if it is there.
+    {
+        std::lock_guard lock(m_dirsLock);
+        m_dirs.erase(dir);
+    }
+    for (auto &shard : m_shards) {
+        std::lock_guard lock(shard.lock);
+        for (auto &[key, entry] : shard.entries) {
+            if (entry.watched && Parent(key) == dir) {
+                entry.watched = false;
+                Reset(shard, key, entry);
+            }
+        }
+    }
+}
+
+bool InfoCache::WatchDir(const std::wstring &dir) {
+    if (!m_watcher) {
+        return false;
+    }
+    std::lock_guard lock(m_dirsLock);
+    auto [it, added] = m_dirs.emplace(dir, 0);
+    if (added && !m_watcher->Watch(dir)) {
+        m_dirs.erase(it);
+        return false;
+    }
+    it->second++;
+    return true;
+}
+
+void InfoCache::UnwatchDir(const std::wstring &dir) {
+    std::lock_guard lock(m_dirsLock);
+    auto it = m_dirs.find(dir);
+    if (it == m_dirs.end() || --it->second > 0) {
+        return;
+    }
+    m_watcher->Unwatch(dir);
+    m_dirs.erase(it);
+}
+}  // namespace os_utils
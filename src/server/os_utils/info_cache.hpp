@@ -0,0 +1,157 @@
+#ifndef BSIT_3_INFO_CACHE_HPP
+#define BSIT_3_INFO_CACHE_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "../../common/alias.hpp"
+#include "os_utils.hpp"
+
+namespace os_utils {
+// Paths, ACLs and owner names of all entries together.
+constexpr usize INFO_CACHE_BYTES = 8 << 20;
+// An entry of a watched directory only expires in case a change was missed.
+constexpr auto INFO_TTL = std::chrono::minutes(10);
+// Without change notifications an answer may be this stale.
+constexpr auto INFO_UNWATCHED_TTL = std::chrono::minutes(2);
+// Paths that did not exist. A watched directory reports their creation, the
+// TTL bounds how long an unwatched one is missed.
+constexpr auto INFO_NEGATIVE_TTL = std::chrono::seconds(30);
+
+// Rights and owners by path in front of a provider, for clients that ask
+// about the same paths over and over.
+//
+// Paths are keyed by their canonical spelling, see Canonical. The provider
+// watches the parent directory of every cached path, so a change to the
+// permissions or owner of a path, or its creation or removal, drops its
+// entry right away. Without a watcher entries live for a shorter TTL.
+//
+// Bounded LRU split into shards with a lock each, like NameCache. Size is
+// counted in bytes since an ACL may have a few or hundreds of entries.
+class InfoCache {
+public:
+    struct Stats {
+        u64 hits;
+        u64 negativeHits;
+        u64 misses;
+        u64 invalidations;
+        u64 evictions;
+        u64 bytes;
+    };
+
+    explicit InfoCache(
+        Provider *provider, usize bytes = INFO_CACHE_BYTES,
+        std::chrono::seconds ttl = INFO_TTL,
+        std::chrono::seconds unwatched_ttl = INFO_UNWATCHED_TTL,
+        std::chrono::seconds negative_ttl = INFO_NEGATIVE_TTL);
+    ~InfoCache();
+
+    InfoCache(const InfoCache &) = delete;
+    InfoCache &operator=(const InfoCache &) = delete;
+
+    // Same as the methods of Provider.
+    AccessRightsInfo GetAccessInfo(const std::wstring &path, ERR *err);
+    OwnerInfo GetOwnerInfo(const std::wstring &path, ERR *err);
+
+    // Drops the entry of path, or all of them if path is empty.
+    void Invalidate(const std::wstring &path);
+
+    [[nodiscard]] Stats GetStats() const;
+
+    // Separators collapsed, "." components and trailing separators dropped,
+    // on Windows also case folded. ".." is kept, it can not be resolved
+    // without asking the file system.
+    static std::wstring Canonical(const std::wstring &path);
+    // Directory that holds key, empty for a root.
+    static std::wstring Parent(const std::wstring &key);
+
+private:
+    using clock = std::chrono::steady_clock;
+
+    static constexpr usize SHARDS = 16;
+
+    // Rights and owner are looked up on their own, an entry holds either
+    // or both.
+    template <typename T>
+    struct Slot {
+        T info;
+        ERR err = ERR_Ok;
+        bool valid = false;
+        clock::time_point expires;
+    };
+
+    struct Entry {
+        Slot<AccessRightsInfo> rights;
+        Slot<OwnerInfo> owner;
+        // Bumped by every invalidation, a lookup that overlapped one does
+        // not store its result.
+        u64 generation = 0;
+        bool watched = false;
+        usize bytes = 0;
+        std::list<std::wstring>::iterator lru;
+    };
+
+    struct Shard {
+        std::mutex lock;
+        // Most recently used first.
+        std::list<std::wstring> lru;
+        std::unordered_map<std::wstring, Entry> entries;
+        usize bytes = 0;
+    };
+
+    Provider *m_provider;
+    usize m_shardBytes;
+    std::chrono::seconds m_ttl;
+    std::chrono::seconds m_unwatchedTtl;
+    std::chrono::seconds m_negativeTtl;
+    std::array<Shard, SHARDS> m_shards;
+
+    std::atomic<u64> m_hits = 0;
+    std::atomic<u64> m_negativeHits = 0;
+    std::atomic<u64> m_misses = 0;
+    std::atomic<u64> m_invalidations = 0;
+    std::atomic<u64> m_evictions = 0;
+    std::atomic<u64> m_bytes = 0;
+
+    // Cached paths by directory, a directory is watched while it has any.
+    std::mutex m_dirsLock;
+    std::unordered_map<std::wstring, usize> m_dirs;
+    // Reset first on destruction, so it stops calling back.
+    std::unique_ptr<ChangeWatcher> m_watcher;
+
+    template <typename T, typename F>
+    T Lookup(const std::wstring &path, Slot<T> Entry::*slot, F &&resolve,
+             ERR *err);
+
+    Shard &ShardOf(const std::wstring &key);
+    // Entry of key as the most recently used one, added and its directory
+    // watched if there is none. shard.lock held.
+    Entry &Find(Shard &shard, const std::wstring &key);
+    // Drops what entry holds, shard.lock held.
+    void Reset(Shard &shard, const std::wstring &key, Entry &entry);
+    // Recounts the size of entry after a store, shard.lock held.
+    void Resize(Shard &shard, const std::wstring &key, Entry &entry);
+    // Makes room down to the byte budget of the shard, the most recently
+    // used entry always stays. shard.lock held.
+    void Evict(Shard &shard);
+    void Erase(Shard &shard,
+               std::unordered_map<std::wstring, Entry>::iterator it);
+    void Changed(const std::wstring &dir, const std::wstring &name);
+    // dir lost its watch, its entries fall back to the unwatched TTL.
+    void Unwatched(const std::wstring &dir);
+    bool WatchDir(const std::wstring &dir);
+    void UnwatchDir(const std::wstring &dir);
+};
+
+// Cache over g_provider for single path requests, set up by init(). Walks
+// of bulk requests go around it, a large tree would only flush it.
+inline InfoCache *g_info_cache = nullptr;
+}  // namespace os_utils
+
+#endif
@@ -0,0 +1,801 @@
+#include "linux.hpp"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <grp.h>
+#include <poll.h>
+#include <pwd.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+#include <sys/utsname.h>
+#include <sys/xattr.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <string_view>
+#include <thread>
+
+#include "../../common/logging.hpp"
+#include "../../common/utf/utf.hpp"
+
+namespace os_utils {
+namespace {
+constexpr u32 RIGHTS_READ = 0x120089;
+constexpr u32 RIGHTS_WRITE = 0x120116;
+constexpr u32 RIGHTS_EXECUTE = 0x1200A0;
+
+// On-disk layout of system.posix_acl_access and system.posix_acl_default,
+// see linux/posix_acl_xattr.h.
+constexpr u32 ACL_XATTR_VERSION = 2;
+constexpr u16 ACL_USER_OBJ = 0x01;
+constexpr u16 ACL_USER = 0x02;
+constexpr u16 ACL_GROUP_OBJ = 0x04;
+constexpr u16 ACL_GROUP = 0x08;
+constexpr u16 ACL_MASK = 0x10;
+constexpr u16 ACL_OTHER = 0x20;
+
+struct AclXattrEntry {
+    u16 tag;
+    u16 perm;
+    u32 id;
+};
+
+// Room for a few hundred ACL entries.
+constexpr usize ACL_XATTR_MAX = 4096;
+
+enum UnixSidKind : u32 {
+    UNIX_SID_USER = 1,
+    UNIX_SID_GROUP = 2,
+};
+
+std::array<u8, 32> MakeUnixSid(UnixSidKind kind, u32 id) {
+    std::array<u8, 32> sid{};
+    sid[0] = 1;
+    sid[1] = 2;
+    sid[7] = 22;
+    std::memcpy(sid.data() + 8, &kind, sizeof(u32));
+    std::memcpy(sid.data() + 12, &id, sizeof(u32));
+    return sid;
+}
+
+std::array<u8, 32> MakeEveryoneSid() {
+    std::array<u8, 32> sid{};
+    sid[0] = 1;
+    sid[1] = 1;
+    sid[7] = 1;
+    return sid;
+}
+
+u32 RightsOf(u32 perm) {
+    u32 rights = 0;
+    if (perm & 4) rights |= RIGHTS_READ;
+    if (perm & 2) rights |= RIGHTS_WRITE;
+    if (perm & 1) rights |= RIGHTS_EXECUTE;
+    return rights;
+}
+
+// Reads the whole file behind fd from offset 0 into buf, returns the size
+// or -1. One syscall as long as the file fits.
+ssize_t ReadAt0(int fd, char *buf, usize size) {
+    usize done = 0;
+    while (done < size) {
+        ssize_t res = pread(fd, buf + done, size - done, done);
+        if (res < 0) return -1;
+        if (res == 0) break;
+        done += res;
+    }
+    return static_cast<ssize_t>(done);
+}
+
+// Value of "<key>: <n> kB" in /proc/meminfo, in bytes.
+u64 MeminfoBytes(std::string_view text, std::string_view key) {
+    usize pos = 0;
+    while (pos < text.size()) {
+        if (text.compare(pos, key.size(), key) == 0 &&
+            pos + key.size() < text.size() && text[pos + key.size()] == ':') {
+            pos += key.size() + 1;
+            while (pos < text.size() && text[pos] == ' ') pos++;
+            u64 val = 0;
+            while (pos < text.size() && text[pos] >= '0' && text[pos] <= '9') {
+                val = val * 10 + (text[pos++] - '0');
+            }
+            return val * 1024;
+        }
+        usize eol = text.find('\n', pos);
+        if (eol == std::string_view::npos) break;
+        pos = eol + 1;
+    }
+    return 0;
+}
+
+// Next space-separated field of a mountinfo line.
+std::string_view NextField(std::string_view *line) {
+    usize end = line->find(' ');
+    auto field = line->substr(0, end);
+    line->remove_prefix(end == std::string_view::npos ? line->size()
+                                                      : end + 1);
+    return field;
+}
+
+// Undoes the \ooo escapes mountinfo uses for spaces and the like. Returns
+// false if out is too small.
+bool Unescape(std::string_view in, char *out, usize size) {
+    usize n = 0;
+    for (usize i = 0; i < in.size(); i++) {
+        if (n + 1 >= size) return false;
+        if (in[i] == '\\' && i + 3 < in.size() && in[i + 1] >= '0' &&
+            in[i + 1] <= '3') {
+            out[n++] = static_cast<char>((in[i + 1] - '0') * 64 +
+                                         (in[i + 2] - '0') * 8 +
+                                         (in[i + 3] - '0'));
+            i += 3;
+        } else {
+            out[n++] = in[i];
+        }
+    }
+    out[n] = '\0';
+    return true;
+}
+
+bool IsNetworkFs(std::string_view fs) {
+    for (std::string_view net :
+         {"nfs", "nfs4", "cifs", "smb3", "smbfs", "ncpfs", "afs", "9p",
+          "ceph", "glusterfs", "fuse.sshfs", "fuse.glusterfs"}) {
+        if (fs == net) return true;
+    }
+    return false;
+}
+
+bool IsMemoryFs(std::string_view fs) { return fs == "tmpfs" || fs == "ramfs"; }
+
+// winCodeToErr for the errno of a failed call.
+ERR ErrnoToErr(int code) {
+    switch (code) {
+        case 0:
+            return ERR_Ok;
+        case ENOENT:
+        case ENOTDIR:
+        // Too many links to resolve, or a link where O_NOFOLLOW forbids one.
+        case ELOOP:
+            return ERR_Path_not_found;
+        case EACCES:
+        case EPERM:
+            return ERR_Permission_denied;
+        case ENAMETOOLONG:
+        case EINVAL:
+            return ERR_InvalidArgument;
+        default:
+            INFO("Unknown errno: %d", code);
+            return ERR_Unknown;
+    }
+}
+
+bool ToPath(const std::wstring &path, std::string *out) {
+    return utils::utf::ToUtf8(path, out, utils::utf::UTF_STRICT);
+}
+
+ERR StatPath(const std::wstring &path, u32 mask, std::string *utf8,
+             struct statx *st) {
+    if (!ToPath(path, utf8)) {
+        return ERR_InvalidArgument;
+    }
+    if (statx(AT_FDCWD, utf8->c_str(), 0, mask, st) != 0) {
+        return ErrnoToErr(errno);
+    }
+    return ERR_Ok;
+}
+
+// Appends the entries of one ACL xattr. Entries narrowed by the mask report
+// the effective rights.
+void AppendAcl(const u8 *buf, usize size, Scope scope,
+               AccessRightsInfo *info) {
+    if (size < sizeof(u32)) return;
+    u32 version;
+    std::memcpy(&version, buf, sizeof(version));
+    if (version != ACL_XATTR_VERSION) return;
+    usize count = (size - sizeof(u32)) / sizeof(AclXattrEntry);
+    const u8 *entries = buf + sizeof(u32);
+
+    u32 mask = 7;
+    for (usize i = 0; i < count; i++) {
+        AclXattrEntry entry;
+        std::memcpy(&entry, entries + i * sizeof(entry), sizeof(entry));
+        if (entry.tag == ACL_MASK) mask = entry.perm;
+    }
+    for (usize i = 0; i < count; i++) {
+        AclXattrEntry entry;
+        std::memcpy(&entry, entries + i * sizeof(entry), sizeof(entry));
+        AccessControlEntry ace = {.aceType = ACE_TYPE_ALLOWED, .scope = scope};
+        // The owning user, group and other are taken from the mode.
+        if (entry.tag == ACL_USER) {
+            ace.sid = MakeUnixSid(UNIX_SID_USER, entry.id);
+        } else if (entry.tag == ACL_GROUP) {
+            ace.sid = MakeUnixSid(UNIX_SID_GROUP, entry.id);
+        } else {
+            continue;
+        }
+        ace.accessMask = RightsOf(entry.perm & mask);
+        info->entries.push_back(ace);
+    }
+}
+
+// Entries of the default ACL of a directory, marked inheritable.
+void AppendDefaultAcl(const char *path, uid_t uid, gid_t gid,
+                      AccessRightsInfo *info) {
+    u8 buf[ACL_XATTR_MAX];
+    ssize_t size =
+        getxattr(path, "system.posix_acl_default", buf, sizeof(buf));
+    if (size <= 0) return;
+    u32 version;
+    std::memcpy(&version, buf, sizeof(version));
+    if (version != ACL_XATTR_VERSION) return;
+
+    usize count = (size - sizeof(u32)) / sizeof(AclXattrEntry);
+    for (usize i = 0; i < count; i++) {
+        AclXattrEntry entry;
+        std::memcpy(&entry, buf + sizeof(u32) + i * sizeof(entry),
+                    sizeof(entry));
+        AccessControlEntry ace = {.aceType = ACE_TYPE_ALLOWED,
+                                  .scope = SCOPE_CONTAINER,
+                                  .accessMask = RightsOf(entry.perm)};
+        if (entry.tag == ACL_USER_OBJ) {
+            ace.sid = MakeUnixSid(UNIX_SID_USER, uid);
+        } else if (entry.tag == ACL_GROUP_OBJ) {
+            ace.sid = MakeUnixSid(UNIX_SID_GROUP, gid);
+        } else if (entry.tag == ACL_OTHER) {
+            ace.sid = MakeEveryoneSid();
+        } else {
+            continue;
+        }
+        info->entries.push_back(ace);
+    }
+    AppendAcl(buf, size, SCOPE_CONTAINER, info);
+}
+// Names of S-1-22 SIDs from NSS, which may ask an LDAP server.
+bool ResolveUnixSid(const Sid &sid, AccountName *res) {
+    if (sid[7] != 22) {
+        return false;
+    }
+    u32 kind;
+    u32 id;
+    std::memcpy(&kind, sid.data() + 8, sizeof(kind));
+    std::memcpy(&id, sid.data() + 12, sizeof(id));
+
+    char buf[1024];
+    if (kind == UNIX_SID_USER) {
+        passwd pw;
+        passwd *found = nullptr;
+        if (getpwuid_r(id, &pw, buf, sizeof(buf), &found) != 0 || !found) {
+            return false;
+        }
+        res->name = pw.pw_name;
+        res->domain = "Unix User";
+        return true;
+    }
+    if (kind == UNIX_SID_GROUP) {
+        group gr;
+        group *found = nullptr;
+        if (getgrgid_r(id, &gr, buf, sizeof(buf), &found) != 0 || !found) {
+            return false;
+        }
+        res->name = gr.gr_name;
+        res->domain = "Unix Group";
+        return true;
+    }
+    return false;
+}
+
+// getdents64 records: u64 inode, i64 offset, u16 record size, u8 type, then
+// the name.
+constexpr usize DIRENT_RECLEN = 16;
+constexpr usize DIRENT_TYPE = 18;
+constexpr usize DIRENT_NAME = 19;
+// Large enough to read most directories in one call.
+constexpr usize DIRENT_BUFFER = 64 * 1024;
+
+// Directory read with getdents64, children are opened and stat'ed relative
+// to its descriptor.
+class LinuxDirectory : public Directory {
+public:
+    // Takes fd, path ends with a slash.
+    LinuxDirectory(int fd, std::string path)
+        : m_fd(fd), m_path(std::move(path)) {}
+    ~LinuxDirectory() override { close(m_fd); }
+
+    LinuxDirectory(const LinuxDirectory &) = delete;
+    LinuxDirectory &operator=(const LinuxDirectory &) = delete;
+
+    ERR List(std::vector<DirEntry> *entries) override {
+        thread_local std::unique_ptr<u8[]> buf;
+        if (!buf) {
+            buf = std::make_unique_for_overwrite<u8[]>(DIRENT_BUFFER);
+        }
+        std::string path = m_path;
+        while (true) {
+            long size = syscall(SYS_getdents64, m_fd, buf.get(), DIRENT_BUFFER);
+            if (size < 0) {
+                return ErrnoToErr(errno);
+            }
+            if (size == 0) {
+                return ERR_Ok;
+            }
+            for (long pos = 0; pos < size;) {
+                const u8 *rec = buf.get() + pos;
+                u16 reclen;
+                std::memcpy(&reclen, rec + DIRENT_RECLEN, sizeof(reclen));
+                pos += reclen;
+                const char *name =
+                    reinterpret_cast<const char *>(rec + DIRENT_NAME);
+                if (!std::strcmp(name, ".") || !std::strcmp(name, "..")) {
+                    continue;
+                }
+                bool directory = rec[DIRENT_TYPE] == DT_DIR;
+                if (rec[DIRENT_TYPE] == DT_UNKNOWN) {
+                    struct stat st;
+                    directory =
+                        fstatat(m_fd, name, &st, AT_SYMLINK_NOFOLLOW) == 0 &&
+                        S_ISDIR(st.st_mode);
+                }
+                // Names are bytes, ones that are not UTF-8 come back
+                // repaired and then fail to resolve with ERR_Path_not_found.
+                path.resize(m_path.size());
+                path += name;
+                DirEntry entry{.directory = directory, .name = name};
+                utils::utf::ToWide(path, &entry.path, utils::utf::UTF_REPLACE);
+                entries->push_back(std::move(entry));
+            }
+        }
+    }
+
+    std::unique_ptr<Directory> Open(const DirEntry &entry, ERR *err) override {
+        // A directory replaced by a link since it was listed is not
+        // followed.
+        int fd = openat(m_fd, entry.name.c_str(),
+                        O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+        if (fd < 0) {
+            *err = ErrnoToErr(errno);
+            return nullptr;
+        }
+        *err = ERR_Ok;
+        return std::make_unique<LinuxDirectory>(fd,
+                                                m_path + entry.name + '/');
+    }
+
+private:
+    int m_fd;
+    std::string m_path;
+};
+
+// Events of a directory cover the attribute changes of its children, so one
+// watch serves every cached path in it.
+constexpr u32 WATCH_MASK = IN_ATTRIB | IN_CREATE | IN_DELETE | IN_MOVED_FROM |
+                           IN_MOVED_TO | IN_MOVE_SELF | IN_ONLYDIR |
+                           IN_EXCL_UNLINK;
+
+class InotifyWatcher : public ChangeWatcher {
+public:
+    // Takes both descriptors, stop is an eventfd that ends the thread.
+    InotifyWatcher(int fd, int stop, Changed changed)
+        : m_fd(fd),
+          m_stop(stop),
+          m_changed(std::move(changed)),
+          m_thread(&InotifyWatcher::Run, this) {}
+
+    ~InotifyWatcher() override {
+        u64 one = 1;
+        if (write(m_stop, &one, sizeof(one)) != sizeof(one)) {
+            PRINT_ERROR("write", static_cast<unsigned long>(errno));
+        }
+        m_thread.join();
+        close(m_stop);
+        close(m_fd);
+    }
+
+    InotifyWatcher(const InotifyWatcher &) = delete;
+    InotifyWatcher &operator=(const InotifyWatcher &) = delete;
+
+    bool Watch(const std::wstring &dir) override {
+        std::string utf8;
+        if (!ToPath(dir, &utf8)) {
+            return false;
+        }
+        std::lock_guard lock(m_lock);
+        // Fails with ENOSPC once fs.inotify.max_user_watches are used up.
+        int wd = inotify_add_watch(m_fd, utf8.c_str(), WATCH_MASK);
+        if (wd < 0) {
+            return false;
+        }
+        m_dirs[wd].push_back(dir);
+        m_wds[dir] = wd;
+        return true;
+    }
+
+    void Unwatch(const std::wstring &dir) override {
+        std::lock_guard lock(m_lock);
+        auto it = m_wds.find(dir);
+        if (it == m_wds.end()) {
+            return;
+        }
+        int wd = it->second;
+        m_wds.erase(it);
+        auto &dirs = m_dirs[wd];
+        std::erase(dirs, dir);
+        if (dirs.empty()) {
+            m_dirs.erase(wd);
+            inotify_rm_watch(m_fd, wd);
+        }
+    }
+
+private:
+    int m_fd;
+    int m_stop;
+    Changed m_changed;
+
+    std::mutex m_lock;
+    // Paths by watch, one directory may be watched under several.
+    std::unordered_map<int, std::vector<std::wstring>> m_dirs;
+    std::unordered_map<std::wstring, int> m_wds;
+
+    std::thread m_thread;
+
+    void Run() {
+        alignas(inotify_event) char buf[16 * 1024];
+        pollfd fds[2] = {{m_fd, POLLIN, 0}, {m_stop, POLLIN, 0}};
+        while (true) {
+            if (poll(fds, 2, -1) < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                PRINT_ERROR("poll", static_cast<unsigned long>(errno));
+                return;
+            }
+            if (fds[1].revents) {
+                return;
+            }
+            ssize_t size = read(m_fd, buf, sizeof(buf));
+            for (ssize_t pos = 0; pos < size;) {
+                const auto *event =
+                    reinterpret_cast<const inotify_event *>(buf + pos);
+                pos += sizeof(inotify_event) + event->len;
+                Dispatch(*event);
+            }
+        }
+    }
+
+    // Calls back without m_lock, the callback may watch or unwatch.
+    void Dispatch(const inotify_event &event) {
+        if (event.mask & IN_Q_OVERFLOW) {
+            m_changed(L"", L"");
+            return;
+        }
+        std::vector<std::wstring> dirs;
+        {
+            std::lock_guard lock(m_lock);
+            auto it = m_dirs.find(event.wd);
+            if (it == m_dirs.end()) {
+                return;
+            }
+            dirs = it->second;
+            if (event.mask & IN_IGNORED) {
+                for (const auto &dir : dirs) {
+                    m_wds.erase(dir);
+                }
+                m_dirs.erase(it);
+            }
+        }
+        // A moved directory is no longer at the path it was watched under.
+        // Its IN_IGNORED follows.
+        if (event.mask & IN_MOVE_SELF) {
+            inotify_rm_watch(m_fd, event.wd);
+            return;
+        }
+        // An empty name tells that the directory was removed, moved or
+        // unmounted and is no longer watched.
+        std::wstring name;
+        if (!(event.mask & IN_IGNORED)) {
+            if (event.len == 0) {
+                return;
+            }
+            utils::utf::ToWide(std::string_view(event.name), &name,
+                               utils::utf::UTF_REPLACE);
+        }
+        for (const auto &dir : dirs) {
+            m_changed(dir, name);
+        }
+    }
+};
+}  // namespace
+
+LinuxProvider::LinuxProvider() : m_names(ResolveUnixSid) {
+    m_meminfo = open("/proc/meminfo", O_RDONLY | O_CLOEXEC);
+    if (m_meminfo < 0) {
+        PRINT_ERROR("open /proc/meminfo", static_cast<unsigned long>(errno));
+    }
+    m_mountinfo = open("/proc/self/mountinfo", O_RDONLY | O_CLOEXEC);
+    if (m_mountinfo < 0) {
+        PRINT_ERROR("open /proc/self/mountinfo",
+                    static_cast<unsigned long>(errno));
+    }
+}
+
+LinuxProvider::~LinuxProvider() {
+    if (m_meminfo >= 0) close(m_meminfo);
+    if (m_mountinfo >= 0) close(m_mountinfo);
+}
+
+const char *LinuxProvider::Name() const { return "linux"; }
+
+OSType LinuxProvider::GetType() {
+    utsname uts;
+    if (uname(&uts) != 0) return OS_UNKNOWN;
+    std::string_view machine = uts.machine;
+    if (machine == "x86_64") return OS_LINUX64;
+    if (machine == "aarch64" || machine == "arm64") return OS_LINUXARM64;
+    if (machine.starts_with("arm")) return OS_LINUXARM;
+    if (machine.starts_with("i") && machine.ends_with("86")) return OS_LINUX32;
+    return OS_UNKNOWN;
+}
+
+OSVersion LinuxProvider::GetVersion() {
+    OSVersion version = {0, 0};
+    utsname uts;
+    if (uname(&uts) == 0) {
+        sscanf(uts.release, "%hu.%hu", &version.major, &version.minor);
+    }
+    return version;
+}
+
+u64 LinuxProvider::GetUptimeMs() {
+    timespec ts;
+    clock_gettime(CLOCK_BOOTTIME, &ts);
+    return static_cast<u64>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+}
+
+u64 LinuxProvider::GetTimeMs() {
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return static_cast<u64>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+}
+
+i8 LinuxProvider::GetTimezoneHours() {
+    time_t now = time(nullptr);
+    tm local;
+    localtime_r(&now, &local);
+    return static_cast<i8>(local.tm_gmtoff / 3600);
+}
+
+MemInfo LinuxProvider::GetMeminfo() {
+    MemInfo memInfo = {0};
+    // /proc/meminfo is about 1.5 KB.
+    char buf[4096];
+    ssize_t size = ReadAt0(m_meminfo, buf, sizeof(buf));
+    if (size <= 0) {
+        WARN("Can't get memory info");
+        return memInfo;
+    }
+    std::string_view text(buf, size);
+    memInfo.total_bytes = MeminfoBytes(text, "MemTotal");
+    memInfo.free_bytes = MeminfoBytes(text, "MemAvailable");
+    return memInfo;
+}
+
+std::vector<DriveInfo> LinuxProvider::GetDrives() {
+    std::vector<MountProbe> mounts;
+
+    // Grown to the largest mount table seen by this thread, then reused.
+    thread_local std::vector<char> buf(16384);
+    ssize_t size;
+    while ((size = ReadAt0(m_mountinfo, buf.data(), buf.size())) ==
+           static_cast<ssize_t>(buf.size())) {
+        buf.resize(buf.size() * 2);
+    }
+    if (size <= 0) {
+        WARN("Can't read /proc/self/mountinfo");
+        return {};
+    }
+
+    std::string_view text(buf.data(), size);
+    while (!text.empty()) {
+        usize eol = text.find('\n');
+        std::string_view line = text.substr(0, eol);
+        text.remove_prefix(eol == std::string_view::npos ? text.size()
+                                                         : eol + 1);
+
+        NextField(&line);  // mount id
+        NextField(&line);  // parent id
+        auto dev = NextField(&line);
+        NextField(&line);  // root
+        auto mount_point = NextField(&line);
+        usize sep = line.find(" - ");
+        if (sep == std::string_view::npos) continue;
+        line.remove_prefix(sep + 3);
+        auto fs = NextField(&line);
+
+        char path[4096];
+        if (!Unescape(mount_point, path, sizeof(path))) continue;
+
+        u32 major = 0;
+        u32 minor = 0;
+        sscanf(dev.data(), "%u:%u", &major, &minor);
+        DriveType type = DRIVE_TYPE_UNKNOWN;
+        if (IsNetworkFs(fs)) {
+            type = DRIVE_TYPE_NET;
+        } else if (IsMemoryFs(fs)) {
+            type = DRIVE_TYPE_FS;
+        } else if (major != 0) {
+            type = IsRemovable(major, minor) ? DRIVE_TYPE_REMOVABLE
+                                             : DRIVE_TYPE_LOCAL;
+        }
+        // statvfs blocks for as long as a hung NFS server does.
+        mounts.push_back({path, [type](DriveInfo *drive) {
+                              struct statvfs st;
+                              // Pseudo file systems have no blocks.
+                              if (statvfs(drive->name.c_str(), &st) != 0 ||
+                                  st.f_blocks == 0) {
+                                  return false;
+                              }
+                              drive->type = type;
+                              drive->free_bytes =
+                                  static_cast<u64>(st.f_bfree) * st.f_frsize;
+                              return true;
+                          }});
+    }
+
+    return m_drives.Probe(std::move(mounts));
+}
+
+bool LinuxProvider::IsRemovable(u32 major, u32 minor) {
+    dev_t dev = makedev(major, minor);
+    std::lock_guard lock(m_removableLock);
+    auto it = m_removable.find(dev);
+    if (it != m_removable.end()) {
+        return it->second;
+    }
+
+    // Partitions have the flag on their parent device.
+    bool removable = false;
+    for (const char *fmt : {"/sys/dev/block/%u:%u/removable",
+                            "/sys/dev/block/%u:%u/../removable"}) {
+        char path[64];
+        snprintf(path, sizeof(path), fmt, major, minor);
+        int fd = open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) continue;
+        char flag = '0';
+        removable = pread(fd, &flag, 1, 0) == 1 && flag == '1';
+        close(fd);
+        break;
+    }
+    m_removable.emplace(dev, removable);
+    return removable;
+}
+
+AccessRightsInfo LinuxProvider::GetAccessInfo(const std::wstring &path,
+                                              ERR *err) {
+    AccessRightsInfo rightsInfo = {};
+    std::string utf8;
+    struct statx st;
+    *err = StatPath(path, STATX_MODE | STATX_UID | STATX_GID, &utf8, &st);
+    if (*err != ERR_Ok) {
+        return rightsInfo;
+    }
+
+    // The owning user, group and other classes come first, like the
+    // explicit entries of a Windows DACL.
+    u8 acl[ACL_XATTR_MAX];
+    ssize_t acl_size =
+        getxattr(utf8.c_str(), "system.posix_acl_access", acl, sizeof(acl));
+    u32 group_perm = (st.stx_mode >> 3) & 7;
+    if (acl_size > 0) {
+        // With an ACL the group bits of the mode are the mask, the owning
+        // group has its own entry.
+        for (usize off = sizeof(u32); off + sizeof(AclXattrEntry) <=
+                                      static_cast<usize>(acl_size);
+             off += sizeof(AclXattrEntry)) {
+            AclXattrEntry entry;
+            std::memcpy(&entry, acl + off, sizeof(entry));
+            if (entry.tag == ACL_GROUP_OBJ) {
+                group_perm = entry.perm & ((st.stx_mode >> 3) & 7);
+            }
+        }
+    }
+    rightsInfo.entries.push_back({
+        .sid = MakeUnixSid(UNIX_SID_USER, st.stx_uid),
+        .aceType = ACE_TYPE_ALLOWED,
+        .scope = SCOPE_DIRECT,
+        .accessMask = RightsOf((st.stx_mode >> 6) & 7),
+    });
+    rightsInfo.entries.push_back({
+        .sid = MakeUnixSid(UNIX_SID_GROUP, st.stx_gid),
+        .aceType = ACE_TYPE_ALLOWED,
+        .scope = SCOPE_DIRECT,
+        .accessMask = RightsOf(group_perm),
+    });
+    rightsInfo.entries.push_back({
+        .sid = MakeEveryoneSid(),
+        .aceType = ACE_TYPE_ALLOWED,
+        .scope = SCOPE_DIRECT,
+        .accessMask = RightsOf(st.stx_mode & 7),
+    });
+    if (acl_size > 0) {
+        AppendAcl(acl, acl_size, SCOPE_DIRECT, &rightsInfo);
+    }
+    if (S_ISDIR(st.stx_mode)) {
+        AppendDefaultAcl(utf8.c_str(), st.stx_uid, st.stx_gid, &rightsInfo);
+    }
+
+    return rightsInfo;
+}
+
+OwnerInfo LinuxProvider::GetOwnerInfo(const std::wstring &path, ERR *err) {
+    OwnerInfo ownerInfo = {};
+    std::string utf8;
+    struct statx st;
+    *err = StatPath(path, STATX_UID, &utf8, &st);
+    if (*err != ERR_Ok) {
+        return ownerInfo;
+    }
+
+    ownerInfo.sid = MakeUnixSid(UNIX_SID_USER, st.stx_uid);
+    AccountName account;
+    if (m_names.Lookup(ownerInfo.sid, &account)) {
+        ownerInfo.ownerName = std::move(account.name);
+    } else {
+        ownerInfo.ownerName = std::to_string(st.stx_uid);
+    }
+    ownerInfo.ownerDomain = "Unix User";
+
+    return ownerInfo;
+}
+
+ERR LinuxProvider::ListDirectory(const std::wstring &path,
+                                 std::vector<DirEntry> *entries) {
+    ERR err;
+    auto dir = OpenDirectory(path, &err);
+    if (!dir) {
+        return err;
+    }
+    return dir->List(entries);
+}
+
+std::unique_ptr<ChangeWatcher> LinuxProvider::WatchChanges(
+    ChangeWatcher::Changed changed) {
+    int fd = inotify_init1(IN_CLOEXEC);
+    if (fd < 0) {
+        PRINT_ERROR("inotify_init1", static_cast<unsigned long>(errno));
+        return nullptr;
+    }
+    int stop = eventfd(0, EFD_CLOEXEC);
+    if (stop < 0) {
+        PRINT_ERROR("eventfd", static_cast<unsigned long>(errno));
+        close(fd);
+        return nullptr;
+    }
+    return std::make_unique<InotifyWatcher>(fd, stop, std::move(changed));
+}
+
+std::unique_ptr<Directory> LinuxProvider::OpenDirectory(
+    const std::wstring &path, ERR *err) {
+    std::string utf8;
+    if (!ToPath(path, &utf8)) {
+        *err = ERR_InvalidArgument;
+        return nullptr;
+    }
+    int fd = open(utf8.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        *err = errno == ENOTDIR ? ERR_Ok : ErrnoToErr(errno);
+        return nullptr;
+    }
+    if (utf8.back() != '/') {
+        utf8 += '/';
+    }
+    *err = ERR_Ok;
+    return std::make_unique<LinuxDirectory>(fd, std::move(utf8));
+}
+}  // namespace os_utils
@@ -0,0 +1,65 @@
+#ifndef BSIT_3_LINUX_HPP
+#define BSIT_3_LINUX_HPP
+
+#include <sys/types.h>
+
+#include <mutex>
+#include <unordered_map>
+
+#include "drive_probe.hpp"
+#include "name_cache.hpp"
+#include "os_utils.hpp"
+
+namespace os_utils {
+// Reads /proc, sysfs and file metadata. The /proc files asked for on every
+// request are opened once and re-read with pread, which makes a memory query
+// a single syscall. Mounts are probed concurrently, see DriveProber.
+// Directories are read with getdents64 and opened relative to their parent.
+// Changes are watched with inotify.
+//
+// Unix users and groups are reported as S-1-22-1-<uid> and S-1-22-2-<gid>
+// like Samba does, "other" as Everyone (S-1-1-0). Permission bits map to the
+// generic file rights (read 0x120089, write 0x120116, execute 0x1200A0).
+class LinuxProvider : public Provider {
+public:
+    LinuxProvider();
+    ~LinuxProvider() override;
+
+    LinuxProvider(const LinuxProvider &) = delete;
+    LinuxProvider &operator=(const LinuxProvider &) = delete;
+
+    const char *Name() const override;
+
+    OSType GetType() override;
+    OSVersion GetVersion() override;
+    u64 GetUptimeMs() override;
+    u64 GetTimeMs() override;
+    i8 GetTimezoneHours() override;
+    MemInfo GetMeminfo() override;
+    std::vector<DriveInfo> GetDrives() override;
+    AccessRightsInfo GetAccessInfo(const std::wstring &path,
+                                   ERR *err) override;
+    OwnerInfo GetOwnerInfo(const std::wstring &path, ERR *err) override;
+    ERR ListDirectory(const std::wstring &path,
+                      std::vector<DirEntry> *entries) override;
+    std::unique_ptr<Directory> OpenDirectory(const std::wstring &path,
+                                             ERR *err) override;
+    std::unique_ptr<ChangeWatcher> WatchChanges(
+        ChangeWatcher::Changed changed) override;
+
+private:
+    int m_meminfo = -1;
+    int m_mountinfo = -1;
+    DriveProber m_drives;
+    NameCache m_names;
+
+    // sysfs removable flag of every block device seen so far, it does not
+    // change while the device exists.
+    std::mutex m_removableLock;
+    std::unordered_map<dev_t, bool> m_removable;
+
+    bool IsRemovable(u32 major, u32 minor);
+};
+}  // namespace os_utils
+
+#endif
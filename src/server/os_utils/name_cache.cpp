@@ -0,0 +1,157 @@
+#include "name_cache.hpp"
+
+#include <algorithm>
+#include <string_view>
+
+namespace os_utils {
+usize NameCache::SidHash::operator()(const Sid &sid) const {
+    return std::hash<std::string_view>()(std::string_view(
+        reinterpret_cast<const char *>(sid.data()), sid.size()));
+}
+
+NameCache::NameCache(Resolver resolve, usize capacity,
+                     std::chrono::seconds ttl,
+                     std::chrono::seconds negative_ttl)
+    : m_resolve(std::move(resolve)),
+      m_shardCapacity(std::max<usize>(1, capacity / SHARDS)),
+      m_ttl(ttl),
+      m_negativeTtl(negative_ttl),
+      m_refresher(&NameCache::Refresh, this) {}
+
+NameCache::~NameCache() {
+    {
+        std::lock_guard lock(m_refreshLock);
+        m_stopping = true;
+    }
+    m_refreshReady.notify_one();
+    m_refresher.join();
+}
+
+bool NameCache::Lookup(const Sid &sid, AccountName *res) {
+    Shard &shard = ShardOf(sid);
+    std::unique_lock lock(shard.lock);
+    auto it = shard.entries.find(sid);
+    while (it != shard.entries.end() && it->second.pending) {
+        shard.resolved.wait(lock);
+        it = shard.entries.find(sid);
+    }
+
+    auto now = clock::now();
+    if (it != shard.entries.end() && now < it->second.expires) {
+        Entry &entry = it->second;
+        shard.lru.splice(shard.lru.begin(), shard.lru, entry.lru);
+        if (!entry.found) {
+            m_negativeHits.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        m_hits.fetch_add(1, std::memory_order_relaxed);
+        if (!entry.refreshing && now > entry.expires - m_ttl / 5) {
+            entry.refreshing = true;
+            {
+                std::lock_guard refresh_lock(m_refreshLock);
+                m_refreshQueue.push_back(sid);
+            }
+            m_refreshReady.notify_one();
+        }
+        *res = entry.account;
+        return true;
+    }
+
+    m_misses.fetch_add(1, std::memory_order_relaxed);
+    if (it == shard.entries.end()) {
+        Evict(shard);
+        shard.lru.push_front(sid);
+        it = shard.entries.emplace(sid, Entry{}).first;
+        it->second.lru = shard.lru.begin();
+    }
+    it->second.pending = true;
+    lock.unlock();
+
+    AccountName account;
+    bool found = m_resolve(sid, &account);
+
+    lock.lock();
+    if (found) {
+        *res = account;
+    }
+    Store(shard, sid, found, std::move(account));
+    shard.resolved.notify_all();
+    return found;
+}
+
+NameCache::Stats NameCache::GetStats() const {
+    return {
+        .hits = m_hits.load(std::memory_order_relaxed),
+        .negativeHits = m_negativeHits.load(std::memory_order_relaxed),
+        .misses = m_misses.load(std::memory_order_relaxed),
+        .refreshes = m_refreshes.load(std::memory_order_relaxed),
+        .evictions = m_evictions.load(std::memory_order_relaxed),
+    };
+}
+
+NameCache::Shard &NameCache::ShardOf(const Sid &sid) {
+    return m_shards[SidHash()(sid) % SHARDS];
+}
+
+void NameCache::Store(Shard &shard, const Sid &sid, bool found,
+                      AccountName account) {
+    auto it = shard.entries.find(sid);
+    if (it == shard.entries.end()) {
+        return;
+    }
+    Entry &entry = it->second;
+    entry.account = std::move(account);
+    entry.found = found;
+    entry.pending = false;
+    entry.refreshing = false;
+    entry.expires = clock::now() + (found ? m_ttl : m_negativeTtl);
+}
+
+void NameCache::Evict(Shard &shard) {
+    if (shard.entries.size() < m_shardCapacity) {
+        return;
+    }
+    for (auto it = shard.lru.rbegin(); it != shard.lru.rend(); ++it) {
+        auto entry = shard.entries.find(*it);
+        if (entry->second.pending || entry->second.refreshing) {
+            continue;
+        }
+        shard.lru.erase(std::next(it).base());
+        shard.entries.erase(entry);
+        m_evictions.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+}
+
+void NameCache::Refresh() {
+    std::unique_lock lock(m_refreshLock);
+    while (true) {
+        m_refreshReady.wait(
+            lock, [this] { return m_stopping || !m_refreshQueue.empty(); });
+        if (m_stopping) {
+            return;
+        }
+        Sid sid = m_refreshQueue.front();
+        m_refreshQueue.pop_front();
+        lock.unlock();
+
+        AccountName account;
+        bool found = m_resolve(sid, &account);
+        m_refreshes.fetch_add(1, std::memory_order_relaxed);
+        {
+            Shard &shard = ShardOf(sid);
+            std::lock_guard shard_lock(shard.lock);
+            auto it = shard.entries.find(sid);
+            // An expired entry may have been picked up by a lookup in the
+            // meantime, its result wins.
+            if (it != shard.entries.end() && it->second.pending) {
+                it->second.refreshing = false;
+            } else {
+                Store(shard, sid, found, std::move(account));
+            }
+        }
+
+        lock.lock();
+    }
+}
+}  // namespace os_utils
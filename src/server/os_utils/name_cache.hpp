@@ -0,0 +1,119 @@
+#ifndef BSIT_3_NAME_CACHE_HPP
+#define BSIT_3_NAME_CACHE_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include "../../common/alias.hpp"
+
+namespace os_utils {
+using Sid = std::array<u8, 32>;
+
+struct AccountName {
+    std::string name;
+    std::string domain;
+};
+
+constexpr usize NAME_CACHE_CAPACITY = 4096;
+constexpr auto NAME_TTL = std::chrono::minutes(10);
+// Unknown SIDs are retried sooner, a new account should not stay unknown
+// for long.
+constexpr auto NAME_NEGATIVE_TTL = std::chrono::seconds(30);
+
+// SID to account name cache in front of LookupAccountSid or NSS, which may
+// be a round trip to a domain controller or LDAP server.
+//
+// Bounded LRU split into shards with a lock each. Concurrent misses on the
+// same SID wait for a single lookup. An entry used in the last fifth of its
+// TTL is refreshed on a background thread while the old value is still
+// served, so popular names never expire under load.
+class NameCache {
+public:
+    // Blocking lookup, false if the SID does not resolve.
+    using Resolver = std::function<bool(const Sid &sid, AccountName *res)>;
+
+    struct Stats {
+        u64 hits;
+        u64 negativeHits;
+        u64 misses;
+        u64 refreshes;
+        u64 evictions;
+    };
+
+    explicit NameCache(Resolver resolve, usize capacity = NAME_CACHE_CAPACITY,
+                       std::chrono::seconds ttl = NAME_TTL,
+                       std::chrono::seconds negative_ttl = NAME_NEGATIVE_TTL);
+    ~NameCache();
+
+    NameCache(const NameCache &) = delete;
+    NameCache &operator=(const NameCache &) = delete;
+
+    bool Lookup(const Sid &sid, AccountName *res);
+
+    [[nodiscard]] Stats GetStats() const;
+
+private:
+    using clock = std::chrono::steady_clock;
+
+    static constexpr usize SHARDS = 16;
+
+    struct SidHash {
+        usize operator()(const Sid &sid) const;
+    };
+
+    struct Entry {
+        AccountName account;
+        bool found = false;
+        // A lookup for a missing or expired entry is running.
+        bool pending = false;
+        bool refreshing = false;
+        clock::time_point expires;
+        std::list<Sid>::iterator lru;
+    };
+
+    struct Shard {
+        std::mutex lock;
+        std::condition_variable resolved;
+        // Most recently used first.
+        std::list<Sid> lru;
+        std::unordered_map<Sid, Entry, SidHash> entries;
+    };
+
+    Resolver m_resolve;
+    usize m_shardCapacity;
+    std::chrono::seconds m_ttl;
+    std::chrono::seconds m_negativeTtl;
+    std::array<Shard, SHARDS> m_shards;
+
+    std::atomic<u64> m_hits = 0;
+    std::atomic<u64> m_negativeHits = 0;
+    std::atomic<u64> m_misses = 0;
+    std::atomic<u64> m_refreshes = 0;
+    std::atomic<u64> m_evictions = 0;
+
+    std::mutex m_refreshLock;
+    std::condition_variable m_refreshReady;
+    std::deque<Sid> m_refreshQueue;
+    bool m_stopping = false;
+    std::thread m_refresher;
+
+    Shard &ShardOf(const Sid &sid);
+    // Stores a lookup result if the entry is still there, shard.lock held.
+    void Store(Shard &shard, const Sid &sid, bool found,
+               AccountName account);
+    // Makes room for one more entry, shard.lock held.
+    void Evict(Shard &shard);
+    void Refresh();
+};
+}  // namespace os_utils
+
+#endif
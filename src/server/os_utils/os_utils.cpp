@@ -0,0 +1,97 @@
+#include "os_utils.hpp"
+
+#include <utility>
+
+#include "info_cache.hpp"
+
+#if defined(_WIN32)
+#include "win.hpp"
+#elif defined(__linux__)
+#include "linux.hpp"
+#else
+#include "fake.hpp"
+#endif
+
+namespace os_utils {
+namespace {
+// Directory of a provider without relative opens, every level is listed by
+// its full path.
+class PathDirectory : public Directory {
+public:
+    PathDirectory(Provider *provider, std::wstring path)
+        : m_provider(provider), m_path(std::move(path)) {}
+
+    ERR List(std::vector<DirEntry> *entries) override {
+        return m_provider->ListDirectory(m_path, entries);
+    }
+
+    std::unique_ptr<Directory> Open(const DirEntry &entry, ERR *err) override {
+        *err = ERR_Ok;
+        return std::make_unique<PathDirectory>(m_provider, entry.path);
+    }
+
+private:
+    Provider *m_provider;
+    std::wstring m_path;
+};
+}  // namespace
+
+std::unique_ptr<Directory> Provider::OpenDirectory(const std::wstring &path,
+                                                   ERR *err) {
+    *err = ERR_Ok;
+    return std::make_unique<PathDirectory>(this, path);
+}
+
+std::unique_ptr<ChangeWatcher> Provider::WatchChanges(
+    ChangeWatcher::Changed changed) {
+    return nullptr;
+}
+
+void init() {
+    if (!g_provider) {
+#if defined(_WIN32)
+        g_provider = new WinProvider();
+#elif defined(__linux__)
+        g_provider = new LinuxProvider();
+#else
+        // No native provider for this platform yet.
+        g_provider = new FakeProvider(FakeConfig{});
+#endif
+    }
+    if (!g_info_cache) {
+        g_info_cache = new InfoCache(g_provider);
+    }
+}
+
+OSType get_type() { return g_provider->GetType(); }
+
+OSVersion get_version() { return g_provider->GetVersion(); }
+
+u64 get_uptime_ms() { return g_provider->GetUptimeMs(); }
+
+u64 get_time_ms() { return g_provider->GetTimeMs(); }
+
+i8 get_timezone_hours() { return g_provider->GetTimezoneHours(); }
+
+MemInfo get_meminfo() { return g_provider->GetMeminfo(); }
+
+std::vector<DriveInfo> get_drives() { return g_provider->GetDrives(); }
+
+AccessRightsInfo get_access_info(const std::wstring &path, ERR *err) {
+    ERR ignored;
+    return g_provider->GetAccessInfo(path, err ? err : &ignored);
+}
+
+OwnerInfo get_owner_info(const std::wstring &path, ERR *err) {
+    ERR ignored;
+    return g_provider->GetOwnerInfo(path, err ? err : &ignored);
+}
+
+ERR list_directory(const std::wstring &path, std::vector<DirEntry> *entries) {
+    return g_provider->ListDirectory(path, entries);
+}
+
+std::unique_ptr<Directory> open_directory(const std::wstring &path, ERR *err) {
+    return g_provider->OpenDirectory(path, err);
+}
+}  // namespace os_utils
@@ -0,0 +1,116 @@
+#ifndef OS_UTILS_H
+#define OS_UTILS_H
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../../common/data.hpp"
+#include "../../common/errors.hpp"
+
+namespace os_utils {
+// Child of a directory, path is the full path of the child.
+struct DirEntry {
+    std::wstring path;
+    bool directory;
+    // Name of the child as the provider spells it, set by providers that
+    // open children relative to their parent, see Directory::Open.
+    std::string name;
+};
+
+// Directory opened for a walk. A provider that can open a child relative to
+// its parent does so, which spares resolving the whole path again on every
+// level. Methods may be called from any thread, one at a time.
+class Directory {
+public:
+    virtual ~Directory() = default;
+
+    // Appends the children, see Provider::ListDirectory.
+    virtual ERR List(std::vector<DirEntry> *entries) = 0;
+
+    // Opens a directory listed by List, nullptr and *err set on failure.
+    virtual std::unique_ptr<Directory> Open(const DirEntry &entry,
+                                            ERR *err) = 0;
+};
+
+// Reports changes to the children of watched directories: their creation,
+// removal, renames and changes to their attributes, which include owner and
+// permissions. Callbacks come from a thread of the watcher.
+class ChangeWatcher {
+public:
+    // name of the child of dir that changed. An empty name means that dir
+    // was removed or moved and is no longer watched, an empty dir that
+    // events were lost and anything may have changed.
+    using Changed =
+        std::function<void(const std::wstring &dir, const std::wstring &name)>;
+
+    virtual ~ChangeWatcher() = default;
+
+    // false if dir can not be watched. A directory watched under two paths
+    // is reported under both.
+    virtual bool Watch(const std::wstring &dir) = 0;
+    virtual void Unwatch(const std::wstring &dir) = 0;
+};
+
+// Source of everything the handlers report. The real ones ask the host OS,
+// see win.hpp and linux.hpp; the synthetic one in fake.hpp answers from a
+// fixed model so the server can be benchmarked without the OS in the
+// measurement.
+//
+// Methods may be called from any thread.
+class Provider {
+public:
+    virtual ~Provider() = default;
+
+    // Name of the provider, for logs.
+    virtual const char *Name() const = 0;
+
+    virtual OSType GetType() = 0;
+    virtual OSVersion GetVersion() = 0;
+    virtual u64 GetUptimeMs() = 0;
+    virtual u64 GetTimeMs() = 0;
+    virtual i8 GetTimezoneHours() = 0;
+    virtual MemInfo GetMeminfo() = 0;
+    virtual std::vector<DriveInfo> GetDrives() = 0;
+    // Set *err and return an empty info if path can not be queried.
+    virtual AccessRightsInfo GetAccessInfo(const std::wstring &path,
+                                           ERR *err) = 0;
+    virtual OwnerInfo GetOwnerInfo(const std::wstring &path, ERR *err) = 0;
+    // Children of the directory at path, without "." and "..". Links to
+    // directories are listed as files so a walk can not loop. A path that is
+    // not a directory has no children.
+    virtual ERR ListDirectory(const std::wstring &path,
+                              std::vector<DirEntry> *entries) = 0;
+    // Directory at path to be listed later. nullptr with *err set if it can
+    // not be opened, or with ERR_Ok if path is not a directory. The default
+    // one lists by path through ListDirectory.
+    virtual std::unique_ptr<Directory> OpenDirectory(const std::wstring &path,
+                                                     ERR *err);
+    // Watcher for the paths GetAccessInfo and GetOwnerInfo are asked about,
+    // nullptr if the provider has none. The default one has none.
+    virtual std::unique_ptr<ChangeWatcher> WatchChanges(
+        ChangeWatcher::Changed changed);
+};
+
+// Installs the provider of the host unless one was set before, and the
+// InfoCache over it.
+void init();
+
+inline Provider *g_provider = nullptr;
+
+OSType get_type();
+OSVersion get_version();
+u64 get_uptime_ms();
+u64 get_time_ms();
+i8 get_timezone_hours();
+MemInfo get_meminfo();
+std::vector<DriveInfo> get_drives();
+AccessRightsInfo get_access_info(const std::wstring &path,
+                                 ERR *err = nullptr);
+OwnerInfo get_owner_info(const std::wstring &path, ERR *err = nullptr);
+ERR list_directory(const std::wstring &path, std::vector<DirEntry> *entries);
+std::unique_ptr<Directory> open_directory(const std::wstring &path, ERR *err);
+}  // namespace os_utils
+
+#endif
@@ -0,0 +1,215 @@
+#include "walker.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace os_utils {
+Walker::Walker(u32 workers, usize batch) : m_batch(batch) {
+    // Start and Resume spread over the queues, there has to be one.
+    workers = std::max(workers, 1u);
+    for (u32 i = 0; i < workers; i++) {
+        m_queues.push_back(std::make_unique<Queue>());
+    }
+    for (u32 i = 0; i < workers; i++) {
+        m_workers.emplace_back(&Walker::Work, this, i);
+    }
+}
+
+Walker::~Walker() {
+    {
+        std::lock_guard lock(m_idleLock);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    for (auto &worker : m_workers) {
+        worker.join();
+    }
+}
+
+std::shared_ptr<Walk> Walker::Start(const std::vector<std::wstring> &roots,
+                                    u8 depth, std::shared_ptr<WalkSink> sink) {
+    auto walk = std::make_shared<Walk>();
+    walk->m_sink = std::move(sink);
+    std::vector<DirEntry> entries;
+    entries.reserve(roots.size());
+    for (const auto &root : roots) {
+        entries.push_back({root, true});
+    }
+    std::vector<WalkTask> tasks;
+    Split(walk, nullptr, std::move(entries), depth, &tasks);
+    walk->m_outstanding = tasks.size();
+    if (tasks.empty()) {
+        walk->m_sink->Done();
+        return walk;
+    }
+    // Spread over the queues so every worker starts on a root of its own.
+    for (auto &task : tasks) {
+        std::vector<WalkTask> one;
+        one.push_back(std::move(task));
+        Push(m_next++ % m_queues.size(), std::move(one));
+    }
+    return walk;
+}
+
+void Walker::Resume(Walk &walk) {
+    std::vector<WalkTask> parked;
+    {
+        std::lock_guard lock(walk.m_lock);
+        parked.swap(walk.m_parked);
+    }
+    if (!parked.empty()) {
+        Push(m_next++ % m_queues.size(), std::move(parked));
+    }
+}
+
+void Walker::Cancel(Walk &walk) {
+    walk.m_cancelled = true;
+    std::lock_guard lock(walk.m_lock);
+    walk.m_parked.clear();
+}
+
+u32 Walker::Workers() const { return static_cast<u32>(m_workers.size()); }
+
+void Walker::Push(u32 queue, std::vector<WalkTask> tasks) {
+    if (tasks.empty()) {
+        return;
+    }
+    usize count = tasks.size();
+    {
+        std::lock_guard lock(m_queues[queue]->lock);
+        for (auto &task : tasks) {
+            m_queues[queue]->tasks.push_back(std::move(task));
+        }
+    }
+    m_queued += count;
+    // A worker going to sleep counts itself idle before it checks m_queued
+    // one last time, so one of both sides sees the other.
+    if (m_idle == 0) {
+        return;
+    }
+    {
+        std::lock_guard lock(m_idleLock);
+    }
+    if (count > 1) {
+        m_wake.notify_all();
+    } else {
+        m_wake.notify_one();
+    }
+}
+
+bool Walker::Pop(u32 worker, WalkTask *task) {
+    {
+        Queue &own = *m_queues[worker];
+        std::lock_guard lock(own.lock);
+        if (!own.tasks.empty()) {
+            *task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            m_queued--;
+            return true;
+        }
+    }
+    for (usize i = 1; i < m_queues.size(); i++) {
+        Queue &other = *m_queues[(worker + i) % m_queues.size()];
+        std::lock_guard lock(other.lock);
+        if (!other.tasks.empty()) {
+            *task = std::move(other.tasks.front());
+            other.tasks.pop_front();
+            m_queued--;
+            return true;
+        }
+    }
+    return false;
+}
+
+void Walker::Work(u32 worker) {
+    while (true) {
+        WalkTask task;
+        if (Pop(worker, &task)) {
+            Run(worker, std::move(task));
+            continue;
+        }
+        std::unique_lock lock(m_idleLock);
+        m_idle++;
+        m_wake.wait(lock, [this] { return m_stopping || m_queued > 0; });
+        m_idle--;
+        if (m_stopping) {
+            return;
+        }
+    }
+}
+
+void Walker::Run(u32 worker, WalkTask task) {
+    Walk &walk = *task.walk;
+    if (walk.m_cancelled) {
+        return;
+    }
+    {
+        // Checked under the lock Resume takes, so a sink that becomes ready
+        // in between still gets this path back.
+        std::lock_guard lock(walk.m_lock);
+        if (!walk.m_sink->Ready()) {
+            walk.m_parked.push_back(std::move(task));
+            return;
+        }
+    }
+
+    std::vector<WalkTask> children;
+    if (task.depth == 0) {
+        for (const auto &entry : task.entries) {
+            if (walk.m_cancelled) {
+                return;
+            }
+            walk.m_sink->Visit({entry.path, ERR_Ok});
+        }
+    } else {
+        const DirEntry &entry = task.entries.front();
+        ERR err = ERR_Ok;
+        std::unique_ptr<Directory> dir =
+            task.parent ? task.parent->Open(entry, &err)
+                        : open_directory(entry.path, &err);
+        std::vector<DirEntry> entries;
+        if (dir) {
+            err = dir->List(&entries);
+        }
+        // The parent stays open only as long as some of its children still
+        // have to be opened.
+        task.parent.reset();
+        walk.m_sink->Visit({entry.path, err});
+        Split(task.walk, std::move(dir), std::move(entries), task.depth - 1,
+              &children);
+    }
+
+    walk.m_outstanding += children.size();
+    Push(worker, std::move(children));
+    if (--walk.m_outstanding == 0 && !walk.m_cancelled) {
+        walk.m_sink->Done();
+    }
+}
+
+void Walker::Split(const std::shared_ptr<Walk> &walk,
+                   std::unique_ptr<Directory> dir,
+                   std::vector<DirEntry> entries, u8 depth,
+                   std::vector<WalkTask> *tasks) const {
+    std::shared_ptr<Directory> parent;
+    std::vector<DirEntry> leaves;
+    for (auto &entry : entries) {
+        if (!entry.directory || depth == 0) {
+            leaves.push_back(std::move(entry));
+            if (leaves.size() >= m_batch) {
+                tasks->push_back({walk, nullptr, std::move(leaves), 0});
+                leaves.clear();
+            }
+            continue;
+        }
+        if (dir && !parent) {
+            parent = std::move(dir);
+        }
+        std::vector<DirEntry> one;
+        one.push_back(std::move(entry));
+        tasks->push_back({walk, parent, std::move(one), depth});
+    }
+    if (!leaves.empty()) {
+        tasks->push_back({walk, nullptr, std::move(leaves), 0});
+    }
+}
+}  // namespace os_utils
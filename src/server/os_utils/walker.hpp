@@ -0,0 +1,138 @@
+#ifndef BSIT_3_WALKER_HPP
+#define BSIT_3_WALKER_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../../common/alias.hpp"
+#include "../../common/errors.hpp"
+#include "os_utils.hpp"
+
+namespace os_utils {
+// Paths not to be listed are queued in batches of this many by default, to
+// keep the queue cost per path low while still spreading a large directory
+// over the workers.
+constexpr usize WALK_BATCH = 64;
+
+// Path reached by a walk.
+struct WalkEntry {
+    const std::wstring &path;
+    // Why the directory at path could not be opened or listed, its children
+    // are missing then.
+    ERR err;
+};
+
+// Receives the paths of a walk, from several worker threads at once.
+class WalkSink {
+public:
+    virtual ~WalkSink() = default;
+
+    // Whether more paths may be visited now. Paths of a sink that is not
+    // ready wait until Walker::Resume.
+    virtual bool Ready() = 0;
+
+    virtual void Visit(const WalkEntry &entry) = 0;
+
+    // After the last Visit, not called for a cancelled walk.
+    virtual void Done() = 0;
+};
+
+class Walk;
+
+// Either a single directory to be listed, depth levels deep, or a batch of
+// paths to be visited only.
+struct WalkTask {
+    std::shared_ptr<Walk> walk;
+    // Opened directory the entry was listed in, set for directories to be
+    // opened relative to it.
+    std::shared_ptr<Directory> parent;
+    std::vector<DirEntry> entries;
+    u8 depth = 0;
+};
+
+// One walk started by Walker::Start.
+class Walk {
+private:
+    friend class Walker;
+
+    std::shared_ptr<WalkSink> m_sink;
+    std::atomic<bool> m_cancelled = false;
+    // Tasks queued, parked or running.
+    std::atomic<usize> m_outstanding = 0;
+
+    std::mutex m_lock;
+    // Paths that found the sink not ready.
+    std::vector<WalkTask> m_parked;
+};
+
+// Worker threads walking directory trees, every path of a walk is visited
+// on whichever worker gets to it first. Each worker takes from the back of
+// its own queue, so a walk goes depth first and only keeps the directories
+// above it open, and steals from the front of the others when it runs dry,
+// which takes the largest subtrees left.
+//
+// A directory is opened relative to the one it was listed in, see
+// Provider::OpenDirectory.
+class Walker {
+public:
+    // Runs at least one worker, also for 0. Sinks that spend long on every
+    // path want a small batch, so the paths of one directory are visited in
+    // parallel.
+    explicit Walker(u32 workers, usize batch = WALK_BATCH);
+    ~Walker();
+
+    Walker(const Walker &) = delete;
+    Walker &operator=(const Walker &) = delete;
+
+    // Visits the roots and everything up to depth levels below the
+    // directories among them. Links to directories are not followed.
+    std::shared_ptr<Walk> Start(const std::vector<std::wstring> &roots,
+                                u8 depth, std::shared_ptr<WalkSink> sink);
+
+    // Requeues the paths parked since the sink of walk was last ready.
+    void Resume(Walk &walk);
+
+    // Stops walk, paths still queued are dropped as the workers reach them.
+    // A Visit that already started may still finish.
+    void Cancel(Walk &walk);
+
+    [[nodiscard]] u32 Workers() const;
+
+private:
+    struct Queue {
+        std::mutex lock;
+        std::deque<WalkTask> tasks;
+    };
+
+    usize m_batch;
+    std::vector<std::unique_ptr<Queue>> m_queues;
+    std::vector<std::thread> m_workers;
+    // Queue the next path from outside of the workers goes to.
+    std::atomic<u32> m_next = 0;
+
+    // Tasks in all queues, and workers sleeping until there are some.
+    std::atomic<usize> m_queued = 0;
+    std::atomic<u32> m_idle = 0;
+    std::mutex m_idleLock;
+    std::condition_variable m_wake;
+    bool m_stopping = false;
+
+    void Push(u32 queue, std::vector<WalkTask> tasks);
+    bool Pop(u32 worker, WalkTask *task);
+    void Work(u32 worker);
+    void Run(u32 worker, WalkTask task);
+    // Appends the tasks for entries of walk found depth levels deep.
+    void Split(const std::shared_ptr<Walk> &walk,
+                      std::unique_ptr<Directory> dir,
+                      std::vector<DirEntry> entries, u8 depth,
+                      std::vector<WalkTask> *tasks) const;
+};
+}  // namespace os_utils
+
+#endif
@@ -1,4 +1,4 @@
-#include "os_utils.hpp"
+#include "win.hpp"
 
 #include <windows.h>
 #include <AclAPI.h>
@@ -7,6 +7,8 @@
 #include <chrono>
 #include <iostream>
 
+#include "../../common/utf/utf.hpp"
+
 std::string GetLastErrorStdStr() {
     DWORD error = GetLastError();
     if (error) {
@@ -29,7 +31,9 @@ std::string GetLastErrorStdStr() {
 }
 
 namespace os_utils {
-OSType get_type() {
+const char *WinProvider::Name() const { return "windows"; }
+
+OSType WinProvider::GetType() {
     HMODULE hModule = GetModuleHandle(TEXT("kernel32.dll"));
     if (!hModule) return OS_UNKNOWN;
 
@@ -79,7 +83,7 @@ OSType get_type() {
     return OS_UNKNOWN;
 }
 
-OSVersion get_version() {
+OSVersion WinProvider::GetVersion() {
     OSVersion version = {0, 0};
 
     typedef LONG(WINAPI * RtlGetVersionPtr)(PRTL_OSVERSIONINFOW);
@@ -97,9 +101,9 @@ OSVersion get_version() {
     return version;
 }
 
-u64 get_uptime_ms() { return static_cast<u64>(GetTickCount64()); }
+u64 WinProvider::GetUptimeMs() { return static_cast<u64>(GetTickCount64()); }
 
-u64 get_time_ms() {
+u64 WinProvider::GetTimeMs() {
     auto now = std::chrono::system_clock::now();
     auto duration = now.time_since_epoch();
 
@@ -108,13 +112,13 @@ u64 get_time_ms() {
             .count());
 }
 
-i8 get_timezone_hours() {
+i8 WinProvider::GetTimezoneHours() {
     TIME_ZONE_INFORMATION res;
     GetTimeZoneInformation(&res);
     return -1 * res.Bias / 60;
 }
 
-MemInfo get_meminfo() {
+MemInfo WinProvider::GetMeminfo() {
     MemInfo memInfo = {0};
     MEMORYSTATUSEX status;
     status.dwLength = sizeof(status);
@@ -128,78 +132,90 @@ MemInfo get_meminfo() {
     return memInfo;
 }
 
-std::vector<DriveInfo> get_drives() {
-    std::vector<DriveInfo> drives;
+namespace {
+// Both calls block for as long as an unreachable network share does.
+bool ProbeDrive(DriveInfo *drive) {
+    UINT type = GetDriveTypeA(drive->name.c_str());
+    switch (type) {
+        case DRIVE_FIXED:
+            drive->type = DRIVE_TYPE_LOCAL;
+            break;
+        case DRIVE_REMOTE:
+            drive->type = DRIVE_TYPE_NET;
+            break;
+        case DRIVE_REMOVABLE:
+        case DRIVE_CDROM:
+            drive->type = DRIVE_TYPE_REMOVABLE;
+            break;
+        case DRIVE_RAMDISK:
+            drive->type = DRIVE_TYPE_FS;
+            break;
+        default:
+            drive->type = DRIVE_TYPE_UNKNOWN;
+    }
 
+    ULARGE_INTEGER freeBytesAvailable, totalNumberOfBytes,
+        totalNumberOfFreeBytes;
+    BOOL success =
+        GetDiskFreeSpaceExA(drive->name.c_str(), &freeBytesAvailable,
+                            &totalNumberOfBytes, &totalNumberOfFreeBytes);
+
+    if (success) {
+        drive->free_bytes =
+            static_cast<uint64_t>(totalNumberOfFreeBytes.QuadPart);
+    } else {
+        std::cerr << "GetDiskFreeSpaceExA() failed for " << drive->name
+                  << " with error " << GetLastError() << std::endl;
+    }
+    return true;
+}
+}  // namespace
+
+std::vector<DriveInfo> WinProvider::GetDrives() {
     DWORD driveMask = GetLogicalDrives();
     if (driveMask == 0) {
         std::cerr << "GetLogicalDrives() failed with error " << GetLastError()
                   << std::endl;
-        return drives;
+        return {};
     }
 
+    std::vector<MountProbe> mounts;
     for (char drive = 'A'; drive <= 'Z'; ++drive) {
         if (driveMask & (1 << (drive - 'A'))) {
-            std::string driveName = std::string(1, drive) + ":\\";
-            UINT type = GetDriveTypeA(driveName.c_str());
-
-            DriveType driveType = DRIVE_TYPE_UNKNOWN;
-            switch (type) {
-                case DRIVE_FIXED:
-                    driveType = DRIVE_TYPE_LOCAL;
-                    break;
-                case DRIVE_REMOTE:
-                    driveType = DRIVE_TYPE_NET;
-                    break;
-                case DRIVE_REMOVABLE:
-                case DRIVE_CDROM:
-                    driveType = DRIVE_TYPE_REMOVABLE;
-                    break;
-                case DRIVE_RAMDISK:
-                    driveType = DRIVE_TYPE_FS;
-                    break;
-                default:
-                    driveType = DRIVE_TYPE_UNKNOWN;
-            }
-
-            ULARGE_INTEGER freeBytesAvailable, totalNumberOfBytes,
-                totalNumberOfFreeBytes;
-            BOOL success = GetDiskFreeSpaceExA(
-                driveName.c_str(), &freeBytesAvailable, &totalNumberOfBytes,
-                &totalNumberOfFreeBytes);
-
-            uint64_t freeBytes = 0;
-            if (success) {
-                freeBytes =
-                    static_cast<uint64_t>(totalNumberOfFreeBytes.QuadPart);
-            } else {
-                std::cerr << "GetDiskFreeSpaceExA() failed for " << driveName
-                          << " with error " << GetLastError() << std::endl;
-            }
-
-            drives.emplace_back(DriveInfo{driveType, driveName, freeBytes});
+            mounts.push_back({std::string(1, drive) + ":\\", ProbeDrive});
         }
     }
 
-    return drives;
+    return m_drives.Probe(std::move(mounts));
 }
 
-AccessRightsInfo get_access_info(const std::wstring &path) {
+AccessRightsInfo WinProvider::GetAccessInfo(const std::wstring &path,
+                                            ERR *err) {
     AccessRightsInfo rightsInfo = {};
 
     PSECURITY_DESCRIPTOR securityDescriptor = nullptr;
     PACL dacl = nullptr;
 
-    if (GetNamedSecurityInfoW(
-            path.c_str(), SE_FILE_OBJECT, DACL_SECURITY_INFORMATION, nullptr,
-            nullptr, &dacl, nullptr, &securityDescriptor) != ERROR_SUCCESS) {
+    // Paths that are neither files nor registry keys report why the file
+    // lookup failed.
+    DWORD res = GetNamedSecurityInfoW(
+        path.c_str(), SE_FILE_OBJECT, DACL_SECURITY_INFORMATION, nullptr,
+        nullptr, &dacl, nullptr, &securityDescriptor);
+    if (res != ERROR_SUCCESS) {
         if (GetNamedSecurityInfoW(path.c_str(), SE_REGISTRY_KEY,
                                   DACL_SECURITY_INFORMATION, nullptr, nullptr,
                                   &dacl, nullptr,
                                   &securityDescriptor) != ERROR_SUCCESS) {
+            *err = winCodeToErr(res);
             return rightsInfo;
         }
     }
+    *err = ERR_Ok;
+    // A null DACL grants everyone full access and has no entries to report.
+    if (!dacl) {
+        LocalFree(securityDescriptor);
+        return rightsInfo;
+    }
 
     for (DWORD i = 0; i < dacl->AceCount; i++) {
         PACE_HEADER aceHeader = nullptr;
@@ -244,42 +260,102 @@ AccessRightsInfo get_access_info(const std::wstring &path) {
     return rightsInfo;
 }
 
-OwnerInfo get_owner_info(const std::wstring &path) {
+namespace {
+// Can be a round trip to a domain controller, see NameCache.
+bool ResolveSid(const Sid &sid, AccountName *res) {
+    // Wide API so that non-ASCII account names survive, sent as UTF-8.
+    wchar_t name[256], domain[256];
+    DWORD nameSize = ARRAYSIZE(name);
+    DWORD domainSize = ARRAYSIZE(domain);
+    SID_NAME_USE sidType;
+
+    if (!LookupAccountSidW(nullptr, const_cast<u8 *>(sid.data()), name,
+                           &nameSize, domain, &domainSize, &sidType)) {
+        return false;
+    }
+    utils::utf::ToUtf8(std::wstring_view(name, nameSize), &res->name,
+                       utils::utf::UTF_REPLACE);
+    utils::utf::ToUtf8(std::wstring_view(domain, domainSize), &res->domain,
+                       utils::utf::UTF_REPLACE);
+    return true;
+}
+}  // namespace
+
+WinProvider::WinProvider() : m_names(ResolveSid) {}
+
+OwnerInfo WinProvider::GetOwnerInfo(const std::wstring &path, ERR *err) {
     OwnerInfo ownerInfo = {};
     PSECURITY_DESCRIPTOR securityDescriptor = nullptr;
     PSID ownerSid = nullptr;
 
-    if (GetNamedSecurityInfoW(
-            path.c_str(), SE_FILE_OBJECT, OWNER_SECURITY_INFORMATION, &ownerSid,
-            nullptr, nullptr, nullptr, &securityDescriptor) != ERROR_SUCCESS) {
+    DWORD res = GetNamedSecurityInfoW(
+        path.c_str(), SE_FILE_OBJECT, OWNER_SECURITY_INFORMATION, &ownerSid,
+        nullptr, nullptr, nullptr, &securityDescriptor);
+    if (res != ERROR_SUCCESS) {
         if (GetNamedSecurityInfoW(path.c_str(), SE_REGISTRY_KEY,
                                   OWNER_SECURITY_INFORMATION, &ownerSid,
                                   nullptr, nullptr, nullptr,
                                   &securityDescriptor) != ERROR_SUCCESS) {
+            *err = winCodeToErr(res);
             return ownerInfo;
         }
     }
 
     if (!IsValidSid(ownerSid)) {
         LocalFree(securityDescriptor);
+        *err = ERR_Unknown;
         return ownerInfo;
     }
+    *err = ERR_Ok;
 
-    char name[256], domain[256];
-    DWORD nameSize = sizeof(name);
-    DWORD domainSize = sizeof(domain);
-    SID_NAME_USE sidType;
-
-    if (LookupAccountSidA(nullptr, ownerSid, name, &nameSize, domain,
-                          &domainSize, &sidType)) {
-        ownerInfo.ownerName = name;
-        ownerInfo.ownerDomain = domain;
-    }
     DWORD sidLength = GetLengthSid(ownerSid);
     memcpy(ownerInfo.sid.data(), ownerSid, sidLength);
-
     LocalFree(securityDescriptor);
 
+    AccountName account;
+    if (m_names.Lookup(ownerInfo.sid, &account)) {
+        ownerInfo.ownerName = std::move(account.name);
+        ownerInfo.ownerDomain = std::move(account.domain);
+    }
+
     return ownerInfo;
 }
+
+ERR WinProvider::ListDirectory(const std::wstring &path,
+                               std::vector<DirEntry> *entries) {
+    std::wstring base = path;
+    if (!base.empty() && base.back() != L'\\' && base.back() != L'/') {
+        base += L'\\';
+    }
+    WIN32_FIND_DATAW data;
+    // Short names are not needed, and skipping them makes the listing
+    // faster on large directories.
+    HANDLE find = FindFirstFileExW((base + L'*').c_str(), FindExInfoBasic,
+                                   &data, FindExSearchNameMatch, nullptr,
+                                   FIND_FIRST_EX_LARGE_FETCH);
+    if (find == INVALID_HANDLE_VALUE) {
+        DWORD res = GetLastError();
+        DWORD attrs = GetFileAttributesW(path.c_str());
+        if (attrs != INVALID_FILE_ATTRIBUTES &&
+            !(attrs & FILE_ATTRIBUTE_DIRECTORY)) {
+            return ERR_Ok;
+        }
+        return winCodeToErr(res);
+    }
+    do {
+        if (!wcscmp(data.cFileName, L".") || !wcscmp(data.cFileName, L"..")) {
+            continue;
+        }
+        DWORD attrs = data.dwFileAttributes;
+        entries->push_back({
+            .path = base + data.cFileName,
+            .directory = (attrs & FILE_ATTRIBUTE_DIRECTORY) &&
+                         !(attrs & FILE_ATTRIBUTE_REPARSE_POINT),
+        });
+    } while (FindNextFileW(find, &data));
+    DWORD last = GetLastError();
+    FindClose(find);
+
+    return last == ERROR_NO_MORE_FILES ? ERR_Ok : winCodeToErr(last);
+}
 }  // namespace os_utils
@@ -0,0 +1,35 @@
+#ifndef BSIT_3_WIN_HPP
+#define BSIT_3_WIN_HPP
+
+#include "drive_probe.hpp"
+#include "name_cache.hpp"
+#include "os_utils.hpp"
+
+namespace os_utils {
+// Asks the Windows API on every call, drives go through a DriveProber.
+class WinProvider : public Provider {
+public:
+    WinProvider();
+
+    const char *Name() const override;
+
+    OSType GetType() override;
+    OSVersion GetVersion() override;
+    u64 GetUptimeMs() override;
+    u64 GetTimeMs() override;
+    i8 GetTimezoneHours() override;
+    MemInfo GetMeminfo() override;
+    std::vector<DriveInfo> GetDrives() override;
+    AccessRightsInfo GetAccessInfo(const std::wstring &path,
+                                   ERR *err) override;
+    OwnerInfo GetOwnerInfo(const std::wstring &path, ERR *err) override;
+    ERR ListDirectory(const std::wstring &path,
+                      std::vector<DirEntry> *entries) override;
+
+private:
+    DriveProber m_drives;
+    NameCache m_names;
+};
+}  // namespace os_utils
+
+#endif
@@ -0,0 +1,57 @@
+#include "acl_table.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace server::tcp {
+namespace {
+constexpr u64 HASH_SEED = 0xcbf29ce484222325ull;
+constexpr u64 HASH_PRIME = 0x100000001b3ull;
+
+// FNV-1a over 64-bit words instead of bytes, an ACE is five of them.
+void HashWord(u64 word, u64 *hash) {
+    *hash = (*hash ^ word) * HASH_PRIME;
+    *hash ^= *hash >> 32;
+}
+
+u64 Hash(const AccessRightsInfo &info) {
+    u64 hash = HASH_SEED;
+    for (const auto &entry : info.entries) {
+        for (usize i = 0; i < entry.sid.size(); i += sizeof(u64)) {
+            u64 word;
+            std::memcpy(&word, entry.sid.data() + i, sizeof(word));
+            HashWord(word, &hash);
+        }
+        HashWord(static_cast<u64>(entry.accessMask) << 16 |
+                     static_cast<u64>(entry.aceType) << 8 | entry.scope,
+                 &hash);
+    }
+    return hash;
+}
+
+bool Equal(const AccessControlEntry &a, const AccessControlEntry &b) {
+    return a.sid == b.sid && a.aceType == b.aceType && a.scope == b.scope &&
+           a.accessMask == b.accessMask;
+}
+}  // namespace
+
+u32 AclTable::Intern(const AccessRightsInfo &info, bool *added) {
+    u64 hash = Hash(info);
+    auto [first, last] = m_ids.equal_range(hash);
+    for (auto it = first; it != last; ++it) {
+        const auto &known = m_acls[it->second].entries;
+        if (std::equal(known.begin(), known.end(), info.entries.begin(),
+                       info.entries.end(), Equal)) {
+            *added = false;
+            return it->second;
+        }
+    }
+    auto id = static_cast<u32>(m_acls.size());
+    m_acls.push_back({{info.entries.begin(), info.entries.end()}});
+    m_ids.emplace(hash, id);
+    *added = true;
+    return id;
+}
+
+usize AclTable::Size() const { return m_acls.size(); }
+}  // namespace server::tcp
@@ -0,0 +1,28 @@
+#ifndef BSIT_3_ACL_TABLE_HPP
+#define BSIT_3_ACL_TABLE_HPP
+
+#include <unordered_map>
+#include <vector>
+
+#include "../../common/alias.hpp"
+#include "../../common/data.hpp"
+
+namespace server::tcp {
+// Hash-consed ACLs of one bulk rights stream. Equal ACLs get the same id,
+// ids are handed out from 0 in the order the ACLs are first seen, see
+// proto::BulkRightsResponse.
+class AclTable {
+public:
+    // Id of info, *added is set if it was not seen before.
+    u32 Intern(const AccessRightsInfo &info, bool *added);
+
+    [[nodiscard]] usize Size() const;
+
+private:
+    std::vector<AccessRightsInfo> m_acls;
+    // Ids by the hash of their ACL.
+    std::unordered_multimap<u64, u32> m_ids;
+};
+}  // namespace server::tcp
+
+#endif
@@ -0,0 +1,173 @@
+#include "bulk_pool.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+#include "../../common/utf/utf.hpp"
+#include "../os_utils/os_utils.hpp"
+
+namespace server::tcp {
+namespace {
+// Moves the last BULK_BATCH results, or all of them, from one vector to the
+// other. Order does not matter, every result carries its path.
+template <typename T>
+void TakeBatch(std::vector<T> *from, std::vector<T> *to) {
+    if (from->size() <= BULK_BATCH) {
+        to->swap(*from);
+        return;
+    }
+    to->assign(std::make_move_iterator(from->end() - BULK_BATCH),
+               std::make_move_iterator(from->end()));
+    from->resize(from->size() - BULK_BATCH);
+}
+}  // namespace
+
+bool BulkJob::Ready() {
+    std::lock_guard lock(m_lock);
+    return Buffered() < BULK_BUFFER_LIMIT;
+}
+
+void BulkJob::Visit(const os_utils::WalkEntry &entry) {
+    ERR err = ERR_Ok;
+    AccessRightsInfo rights;
+    OwnerInfo owner;
+    if (m_type == proto::REQ_RIGHTS_BULK) {
+        rights = os_utils::get_access_info(entry.path, &err);
+    } else {
+        owner = os_utils::get_owner_info(entry.path, &err);
+    }
+    // Paths left without a matching entry are not sent, ones that failed
+    // are, so the client learns what it missed.
+    if (err == ERR_Ok && !m_filter.empty()) {
+        if (m_type == proto::REQ_RIGHTS_BULK) {
+            std::erase_if(rights.entries,
+                          [this](const AccessControlEntry &ace) {
+                              return !m_filter.Match(ace);
+                          });
+            if (rights.entries.empty() && entry.err == ERR_Ok) {
+                return;
+            }
+        } else if (!m_filter.Match(owner) && entry.err == ERR_Ok) {
+            return;
+        }
+    }
+    // A directory that could not be listed reports why next to its own
+    // info, its children are simply missing.
+    if (err == ERR_Ok) {
+        err = entry.err;
+    }
+
+    std::string utf8;
+    utils::utf::ToUtf8(entry.path, &utf8, utils::utf::UTF_REPLACE);
+    bool notify;
+    {
+        std::lock_guard lock(m_lock);
+        if (m_type == proto::REQ_RIGHTS_BULK) {
+            bool added;
+            u32 acl = m_acls.Intern(rights, &added);
+            if (added) {
+                m_newAcls.push_back({acl, std::move(rights)});
+            }
+            m_rights.push_back({std::move(utf8), err, acl});
+        } else {
+            m_owners.push_back({std::move(utf8), err, std::move(owner)});
+        }
+        notify = Notify();
+    }
+    if (notify) {
+        m_notify();
+    }
+}
+
+void BulkJob::Done() {
+    bool notify;
+    {
+        std::lock_guard lock(m_lock);
+        m_walked = true;
+        notify = Notify();
+    }
+    if (notify) {
+        m_notify();
+    }
+}
+
+usize BulkJob::Buffered() const { return m_rights.size() + m_owners.size(); }
+
+bool BulkJob::Notify() {
+    if (m_notified) {
+        return false;
+    }
+    m_notified = true;
+    return true;
+}
+
+// Every path costs a lookup, which is worth a queue round trip of its own.
+BulkPool::BulkPool(u32 workers) : m_walker(workers, 1) {}
+
+BulkJob *BulkPool::Submit(const proto::Request &req,
+                          std::function<void()> notify) {
+    auto job = std::make_shared<BulkJob>();
+    job->m_type = req.type;
+    job->m_filter = req.filter;
+    job->m_notify = std::move(notify);
+    m_jobs.emplace(job.get(), job);
+    // The walk outlives the arena the request was parsed into. An empty
+    // request is done right away, its empty response is ready.
+    std::vector<std::wstring> roots(req.paths.begin(), req.paths.end());
+    job->m_walk = m_walker.Start(roots, req.depth, job);
+
+    return job.get();
+}
+
+proto::Response *BulkPool::Take(BulkJob *job, proto::Arena *arena,
+                                bool *done) {
+    std::vector<SharedAcl> acls;
+    std::vector<PathAclInfo> rights;
+    std::vector<PathOwnerInfo> owners;
+    bool resume;
+    {
+        std::lock_guard lock(job->m_lock);
+        job->m_notified = false;
+        // All new ACLs go along, so none is sent after a path using it.
+        acls.swap(job->m_newAcls);
+        TakeBatch(&job->m_rights, &rights);
+        TakeBatch(&job->m_owners, &owners);
+        // The last response is always an empty one, so a result that can
+        // not be sent never takes the end of the stream with it.
+        *done = job->m_walked && acls.empty() && rights.empty() &&
+                owners.empty();
+        resume = job->Buffered() < BULK_BUFFER_LIMIT;
+    }
+    if (resume) {
+        m_walker.Resume(*job->m_walk);
+    }
+
+    if (acls.empty() && rights.empty() && owners.empty() && !*done) {
+        return nullptr;
+    }
+    proto::Response *resp;
+    if (job->m_type == proto::REQ_RIGHTS_BULK) {
+        resp = arena->make<proto::BulkRightsResponse>(
+            std::move(acls), std::move(rights), arena->resource());
+    } else {
+        resp = arena->make<proto::BulkOwnerResponse>(std::move(owners),
+                                                     arena->resource());
+    }
+    resp->more = !*done;
+
+    return resp;
+}
+
+void BulkPool::Release(BulkJob *job) {
+    m_walker.Cancel(*job->m_walk);
+    // The walk goes once the workers have dropped its queued paths.
+    job->m_walk.reset();
+    m_jobs.erase(job);
+}
+
+u32 BulkPool::Workers() const { return m_walker.Workers(); }
+
+u32 BulkPool::DefaultWorkers() {
+    return std::max(4u, 2 * std::thread::hardware_concurrency());
+}
+}  // namespace server::tcp
@@ -0,0 +1,97 @@
+#ifndef BSIT_3_BULK_POOL_HPP
+#define BSIT_3_BULK_POOL_HPP
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "../../common/alias.hpp"
+#include "../../common/data.hpp"
+#include "../../common/proto/arena.hpp"
+#include "../../common/proto/request.hpp"
+#include "../../common/proto/response.hpp"
+#include "../os_utils/walker.hpp"
+#include "acl_table.hpp"
+
+namespace server::tcp {
+// Results handed to the I/O loop at once.
+constexpr usize BULK_BATCH = 256;
+// Results a job buffers at most, give or take one per worker. Further paths
+// wait until the connection has caught up, so a slow client does not make
+// the server hold a whole tree.
+constexpr usize BULK_BUFFER_LIMIT = 16 * BULK_BATCH;
+
+// One REQ_RIGHTS_BULK or REQ_OWNER_BULK request being answered. The walk
+// visits its paths, each is looked up on the worker that reached it.
+class BulkJob : public os_utils::WalkSink {
+public:
+    bool Ready() override;
+    void Visit(const os_utils::WalkEntry &entry) override;
+    void Done() override;
+
+private:
+    friend class BulkPool;
+
+    proto::RequestType m_type;
+    // Compiled by the request, applied on the workers.
+    proto::Filter m_filter;
+    std::function<void()> m_notify;
+    // Only touched by the I/O loop.
+    std::shared_ptr<os_utils::Walk> m_walk;
+
+    std::mutex m_lock;
+    std::vector<PathAclInfo> m_rights;
+    std::vector<PathOwnerInfo> m_owners;
+    // ACLs of the stream so far, and the ones not yet taken.
+    AclTable m_acls;
+    std::vector<SharedAcl> m_newAcls;
+    bool m_walked = false;
+    // m_notify has been called and the results were not taken since.
+    bool m_notified = false;
+
+    [[nodiscard]] usize Buffered() const;
+    // Calls m_notify unless it is pending, with m_lock held.
+    bool Notify();
+};
+
+// Answers bulk requests on an os_utils::Walker, so a request over thousands
+// of paths costs the longest lookup chain rather than the sum of all
+// lookups. Lookups mostly wait on the file system or a domain controller,
+// hence more workers than cores.
+//
+// The I/O loop is woken through the notify callback of a job and collects
+// its results with Take.
+class BulkPool {
+public:
+    explicit BulkPool(u32 workers);
+
+    // Starts looking up the paths of req. notify is called from a worker
+    // once there are results or the job is done, and not again until the
+    // results have been taken, so wake-ups coalesce while the I/O loop is
+    // busy sending.
+    BulkJob *Submit(const proto::Request &req, std::function<void()> notify);
+
+    // Moves up to BULK_BATCH results of job into a response built in arena,
+    // nullptr if there are none yet. Once the job is done an empty response
+    // without Response::more ends the stream and *done is set.
+    proto::Response *Take(BulkJob *job, proto::Arena *arena, bool *done);
+
+    // Stops job and frees it once no worker uses it any more. A worker that
+    // was about to call notify may still do so once.
+    void Release(BulkJob *job);
+
+    [[nodiscard]] u32 Workers() const;
+
+    static u32 DefaultWorkers();
+
+private:
+    os_utils::Walker m_walker;
+    // Jobs by the pointer handed out, the walk of a job holds another
+    // reference while workers may still visit paths for it.
+    std::unordered_map<BulkJob *, std::shared_ptr<BulkJob>> m_jobs;
+};
+}  // namespace server::tcp
+
+#endif
@@ -0,0 +1,183 @@
+#include "crypto_pool.hpp"
+
+#include <cstring>
+
+#include "../../common/logging.hpp"
+#include "../../common/proto/handshake.hpp"
+
+namespace server::tcp {
+namespace {
+void KeyExchange(Handshake *hs) {
+    INFO("Received key request");
+    auto mgr = proto::encryption::g_instance;
+    proto::KeyRequest key_req(hs->request.buf(), hs->request.payloadSize());
+    if (!key_req.valid) {
+        // The empty response makes the I/O loop drop the connection.
+        WARN("Malformed key request");
+        return;
+    }
+    hs->features = proto::NegotiateFeatures(key_req.features);
+    bool x25519 = key_req.features & proto::FEATURE_X25519;
+
+    std::unique_ptr<proto::encryption::KeyShare> share;
+    std::unique_ptr<proto::encryption::Session> session;
+    if (hs->features & proto::FEATURE_X25519) {
+        share = mgr->CreateKeyShare();
+    }
+    if (share) {
+        session = mgr->AgreeSession(*share, key_req.key.data(),
+                                    key_req.key.size(), true);
+    }
+    if (session) {
+        hs->session = std::move(session);
+    } else if (x25519) {
+        // The empty key without the feature bit makes the client retry with
+        // RSA, the session created on accept is still unused. Nothing is
+        // negotiated yet, the retry is framed in network order like this
+        // request was.
+        WARN("Rejected X25519 key request");
+        hs->features = 0;
+    }
+    bool keyed = !x25519 || (hs->features & proto::FEATURE_X25519);
+
+    usize size = 0;
+    const u8 *buf = nullptr;
+    auto encryption = proto::MESSAGE_ENCRYPTION_NONE;
+    if (!x25519) {
+        buf = mgr->ExportSessionKey(*hs->session, &size, key_req.key.data(),
+                                    key_req.key.size());
+        encryption = proto::MESSAGE_ENCRYPTION_ASYMMETRIC;
+    } else if (keyed) {
+        size = proto::encryption::X25519_KEY_SIZE;
+    }
+    usize ticket_size = 0;
+    const u8 *ticket = nullptr;
+    if (keyed && (hs->features & proto::FEATURE_SESSION_TICKET)) {
+        ticket = mgr->IssueTicket(*hs->session, &ticket_size);
+    }
+    proto::KeyResponse key_resp(hs->features,
+                                share && keyed ? share->PublicKey() : buf,
+                                size, ticket, ticket_size);
+    delete[] buf;
+    delete[] ticket;
+    usize packed_size;
+    auto packed = key_resp.pack(&packed_size, proto::BYTE_ORDER_NETWORK);
+    hs->response = proto::Message(proto::MESSAGE_KEY_RESPONSE, packed.get(),
+                                  packed_size, encryption);
+    INFO("Negotiated features 0x%x", hs->features);
+    if (keyed) {
+        hs->session->SetCipher(proto::NegotiatedCipher(hs->features));
+    }
+}
+
+void Resume(Handshake *hs) {
+    INFO("Received resume request");
+    auto mgr = proto::encryption::g_instance;
+    proto::ResumeRequest resume_req(hs->request.buf(),
+                                    hs->request.payloadSize());
+    if (!resume_req.valid) {
+        // The empty response makes the I/O loop drop the connection.
+        WARN("Malformed resume request");
+        return;
+    }
+    u32 features = proto::NegotiateFeatures(resume_req.features);
+    u8 random[proto::encryption::RESUMPTION_RANDOM_SIZE];
+    mgr->Random(random, sizeof(random));
+    std::unique_ptr<proto::encryption::Session> session;
+    if ((features & proto::FEATURE_SESSION_TICKET) &&
+        resume_req.random.size() == sizeof(random)) {
+        session = mgr->ResumeFromTicket(resume_req.ticket.data(),
+                                        resume_req.ticket.size(),
+                                        resume_req.random.data(), random);
+    }
+    // Rejected tickets get an empty response, the client then runs the key
+    // exchange on the fresh session created on accept.
+    proto::ResumeResponse resume_resp;
+    if (session) {
+        hs->session = std::move(session);
+        hs->features = features;
+        usize ticket_size;
+        auto ticket = mgr->IssueTicket(*hs->session, &ticket_size);
+        resume_resp =
+            proto::ResumeResponse(features, random, ticket, ticket_size);
+        delete[] ticket;
+        INFO("Resumed session, features 0x%x", hs->features);
+    } else {
+        WARN("Rejected session ticket");
+    }
+    usize packed_size;
+    auto packed = resume_resp.pack(&packed_size, proto::BYTE_ORDER_NETWORK);
+    hs->response = proto::Message(proto::MESSAGE_RESUME_RESPONSE, packed.get(),
+                                  packed_size, proto::MESSAGE_ENCRYPTION_NONE);
+    if (resume_resp.accepted()) {
+        hs->session->SetCipher(proto::NegotiatedCipher(hs->features));
+    }
+}
+}  // namespace
+
+void RunHandshake(Handshake *hs) {
+    if (hs->request.type() == proto::MESSAGE_RESUME_REQUEST) {
+        Resume(hs);
+    } else {
+        KeyExchange(hs);
+    }
+}
+
+CryptoPool::CryptoPool(HANDLE io_port, ULONG_PTR key, u32 workers)
+    : m_ioPort(io_port), m_key(key) {
+    m_queue = CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, workers);
+    if (!m_queue) {
+        PRINT_ERROR("CreateIoCompletionPort", GetLastError());
+        return;
+    }
+    for (u32 i = 0; i < workers; i++) {
+        m_workers.emplace_back(&CryptoPool::Work, this);
+    }
+}
+
+CryptoPool::~CryptoPool() {
+    // A null overlap tells a worker to stop.
+    for (usize i = 0; i < m_workers.size(); i++) {
+        PostQueuedCompletionStatus(m_queue, 0, 0, nullptr);
+    }
+    for (auto &worker : m_workers) {
+        worker.join();
+    }
+    if (m_queue) {
+        CloseHandle(m_queue);
+    }
+}
+
+void CryptoPool::Submit(Handshake *hs) {
+    std::memset(&hs->overlap, 0, sizeof(hs->overlap));
+    if (m_workers.empty() ||
+        !PostQueuedCompletionStatus(m_queue, 0, 0, &hs->overlap)) {
+        // Better late than never, run it on the caller.
+        RunHandshake(hs);
+        PostQueuedCompletionStatus(m_ioPort, 0, m_key, &hs->overlap);
+    }
+}
+
+u32 CryptoPool::Workers() const { return static_cast<u32>(m_workers.size()); }
+
+u32 CryptoPool::DefaultWorkers() {
+    u32 cores = std::thread::hardware_concurrency();
+    return cores > 1 ? cores - 1 : 1;
+}
+
+void CryptoPool::Work() {
+    while (true) {
+        DWORD transferred = 0;
+        ULONG_PTR key = 0;
+        OVERLAPPED *overlap = nullptr;
+        GetQueuedCompletionStatus(m_queue, &transferred, &key, &overlap,
+                                  INFINITE);
+        if (!overlap) {
+            return;
+        }
+        auto hs = CONTAINING_RECORD(overlap, Handshake, overlap);
+        RunHandshake(hs);
+        PostQueuedCompletionStatus(m_ioPort, 0, m_key, &hs->overlap);
+    }
+}
+}  // namespace server::tcp
@@ -0,0 +1,66 @@
+#ifndef BSIT_3_CRYPTO_POOL_HPP
+#define BSIT_3_CRYPTO_POOL_HPP
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "../../common/alias.hpp"
+#include "../../common/proto/encryption/encryption.hpp"
+#include "../../common/proto/message.hpp"
+
+namespace server::tcp {
+// Key or resume request of one connection. While it is in flight the worker
+// owns everything in here, including the session of the connection, so the
+// connection can go away without waiting for it.
+struct Handshake {
+    // Completion posted back to the I/O port, see CryptoPool.
+    OVERLAPPED overlap = {};
+    u32 client = 0;
+    // Set by the I/O loop if the connection was closed in the meantime.
+    bool cancelled = false;
+
+    proto::Message request;
+    std::unique_ptr<proto::encryption::Session> session;
+
+    // Filled in by the worker. A response left empty drops the connection.
+    u32 features = 0;
+    proto::Message response;
+};
+
+// Answers hs->request: agrees on or resumes a session and seals the
+// response. The new cipher is in effect for everything after the response.
+void RunHandshake(Handshake *hs);
+
+// Worker threads running the asymmetric part of handshakes, so a reconnect
+// storm does not stall the I/O loop. Jobs are queued on a completion port of
+// their own and finished ones posted to io_port with completion key.
+class CryptoPool {
+public:
+    CryptoPool(HANDLE io_port, ULONG_PTR key, u32 workers);
+    ~CryptoPool();
+
+    CryptoPool(const CryptoPool &) = delete;
+    CryptoPool &operator=(const CryptoPool &) = delete;
+
+    void Submit(Handshake *hs);
+
+    [[nodiscard]] u32 Workers() const;
+
+    // One worker per core, the I/O loop keeps one for itself.
+    static u32 DefaultWorkers();
+
+private:
+    HANDLE m_queue = nullptr;
+    HANDLE m_ioPort;
+    ULONG_PTR m_key;
+    std::vector<std::thread> m_workers;
+
+    void Work();
+};
+}  // namespace server::tcp
+
+#endif
@@ -1,6 +1,9 @@
 #include "handlers.hpp"
 
-#include "../os_utils.hpp"
+#include <algorithm>
+
+#include "../os_utils/info_cache.hpp"
+#include "../os_utils/os_utils.hpp"
 
 namespace server::handlers {
 void Init(tcp::Server *srv) {
@@ -13,35 +16,58 @@ void Init(tcp::Server *srv) {
     srv->RegisterHandler(proto::REQ_OWNER, HandleGetOwner);
 }
 
-proto::Response *HandleGetOsInfo(proto::Request *req) {
-    return new proto::OsInfoResponse({
-        .type = os_utils::get_type(),
-        .version = os_utils::get_version(),
-    });
+proto::Response *HandleGetOsInfo(proto::Request *req, proto::Arena *arena) {
+    return arena->make<proto::OsInfoResponse>(
+        OSInfo{
+            .type = os_utils::get_type(),
+            .version = os_utils::get_version(),
+        },
+        arena->resource());
 }
 
-proto::Response *HandleGetUptime(proto::Request *req) {
-    return new proto::TimeResponse(os_utils::get_uptime_ms());
+proto::Response *HandleGetUptime(proto::Request *req, proto::Arena *arena) {
+    return arena->make<proto::TimeResponse>(os_utils::get_uptime_ms(), 0,
+                                            arena->resource());
 }
 
-proto::Response *HandleGetTime(proto::Request *req) {
-    return new proto::TimeResponse(os_utils::get_time_ms(),
-                                   os_utils::get_timezone_hours());
+proto::Response *HandleGetTime(proto::Request *req, proto::Arena *arena) {
+    return arena->make<proto::TimeResponse>(os_utils::get_time_ms(),
+                                            os_utils::get_timezone_hours(),
+                                            arena->resource());
 }
 
-proto::Response *HandleGetDrives(proto::Request *req) {
-    return new proto::DrivesResponse(os_utils::get_drives());
+// List-shaped answers are filtered before they are packed, only matching
+// entries go over the wire.
+proto::Response *HandleGetDrives(proto::Request *req, proto::Arena *arena) {
+    auto drives = os_utils::get_drives();
+    std::erase_if(drives, [req](const DriveInfo &drive) {
+        return !req->filter.Match(drive);
+    });
+    return arena->make<proto::DrivesResponse>(drives, arena->resource());
 }
 
-proto::Response *HandleGetMemory(proto::Request *req) {
-    return new proto::MemoryResponse(os_utils::get_meminfo());
+proto::Response *HandleGetMemory(proto::Request *req, proto::Arena *arena) {
+    return arena->make<proto::MemoryResponse>(os_utils::get_meminfo(),
+                                              arena->resource());
 }
 
-proto::Response *HandleGetRights(proto::Request *req) {
-    return new proto::RightsResponse(os_utils::get_access_info(req->arg));
+// Clients tend to ask about the same paths again and again, these are
+// answered from the cache.
+proto::Response *HandleGetRights(proto::Request *req, proto::Arena *arena) {
+    ERR err;
+    // The cache keeps its own copy of the path, the arg lives on the arena.
+    auto rights =
+        os_utils::g_info_cache->GetAccessInfo(std::wstring(req->arg), &err);
+    std::erase_if(rights.entries, [req](const AccessControlEntry &ace) {
+        return !req->filter.Match(ace);
+    });
+    return arena->make<proto::RightsResponse>(rights, arena->resource());
 }
 
-proto::Response *HandleGetOwner(proto::Request *req) {
-    return new proto::OwnerResponse(os_utils::get_owner_info(req->arg));
+proto::Response *HandleGetOwner(proto::Request *req, proto::Arena *arena) {
+    ERR err;
+    return arena->make<proto::OwnerResponse>(
+        os_utils::g_info_cache->GetOwnerInfo(std::wstring(req->arg), &err),
+        arena->resource());
 }
 }  // namespace server::handlers
@@ -7,13 +7,13 @@
 #include "tcp.hpp"
 
 namespace server::handlers {
-proto::Response *HandleGetOsInfo(proto::Request *req);
-proto::Response *HandleGetUptime(proto::Request *req);
-proto::Response *HandleGetTime(proto::Request *req);
-proto::Response *HandleGetDrives(proto::Request *req);
-proto::Response *HandleGetMemory(proto::Request *req);
-proto::Response *HandleGetRights(proto::Request *req);
-proto::Response *HandleGetOwner(proto::Request *req);
+proto::Response *HandleGetOsInfo(proto::Request *req, proto::Arena *arena);
+proto::Response *HandleGetUptime(proto::Request *req, proto::Arena *arena);
+proto::Response *HandleGetTime(proto::Request *req, proto::Arena *arena);
+proto::Response *HandleGetDrives(proto::Request *req, proto::Arena *arena);
+proto::Response *HandleGetMemory(proto::Request *req, proto::Arena *arena);
+proto::Response *HandleGetRights(proto::Request *req, proto::Arena *arena);
+proto::Response *HandleGetOwner(proto::Request *req, proto::Arena *arena);
 
 void Init(tcp::Server *srv);
 }  // namespace server::handlers
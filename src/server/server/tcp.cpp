@@ -2,7 +2,8 @@
 #include "tcp.hpp"
 
 #include "../../common/logging.hpp"
-#include "../../common/proto/encryption/encryption.hpp"
+#include "../../common/proto/handshake.hpp"
+#include "../os_utils/info_cache.hpp"
 
 namespace server::tcp {
 std::vector<Server *> servers;
@@ -42,6 +43,11 @@ void Server::RegisterHandler(proto::RequestType type, HandlerFunc handler) {
 
 void Server::TimeoutCheck() {
     INFO("Timeout check triggered");
+    auto stats = os_utils::g_info_cache->GetStats();
+    INFO("Info cache: %llu hits, %llu negative hits, %llu misses, "
+         "%llu invalidations, %llu evictions, %llu bytes",
+         stats.hits, stats.negativeHits, stats.misses, stats.invalidations,
+         stats.evictions, stats.bytes);
     auto now = std::chrono::steady_clock::now();
     for (const auto &client : m_clients) {
         // First "client" is acutally the accept socket so skip it
@@ -90,6 +96,17 @@ ERR Server::Start() {
     m_clients[0].socket = s;
     ScheduleAccept();
 
+    m_cryptoPool = std::make_unique<CryptoPool>(m_ioPort, HANDSHAKE_KEY,
+                                                CryptoPool::DefaultWorkers());
+    m_handshakeLimit = m_cryptoPool->Workers() * HANDSHAKES_PER_WORKER;
+    // Handshakes run inline if no worker could be started.
+    if (!m_handshakeLimit) {
+        m_handshakeLimit = 1;
+    }
+    OKAY("Started %u crypto workers", m_cryptoPool->Workers());
+    m_bulkPool = std::make_unique<BulkPool>(BulkPool::DefaultWorkers());
+    OKAY("Started %u bulk workers", m_bulkPool->Workers());
+
     OKAY("Server started");
     while (true) {
         DWORD transferred = 0;
@@ -110,6 +127,16 @@ ERR Server::Start() {
             continue;
         }
 
+        if (key == HANDSHAKE_KEY) {
+            FinishHandshake(CONTAINING_RECORD(overlap, Handshake, overlap));
+            continue;
+        }
+
+        if (key == BULK_KEY) {
+            PumpBulk(m_clients[transferred]);
+            continue;
+        }
+
         ProcessEvent(key, overlap, transferred);
     }
 
@@ -157,7 +184,14 @@ void Server::AddAcceptedConnection() {
                 PRINT_ERROR("CreateIoCompletionPort", WSAGetLastError());
                 break;
             }
-            proto::encryption::g_instance->CreateSymmetricKey(client.id);
+            client.session =
+                proto::encryption::g_instance->CreateSession().release();
+            if (!client.session) {
+                WARN("Failed to create session for client %d", key);
+                client.socket = INVALID_SOCKET;
+                break;
+            }
+            client.arena = new proto::Arena();
             ScheduleRead(key);
             return;
         }
@@ -198,16 +232,33 @@ void Server::ProcessEvent(ULONG_PTR key, OVERLAPPED *overlap,
             return;
         }
         client.recvBufSize += transferred;
-        if (!proto::Message::ValidateBuff(client.recvBuf, client.recvBufSize)) {
+        // A size no frame can have would never complete, the client goes.
+        if (client.recvBufSize >= sizeof(usize)) {
+            usize frame_size =
+                proto::Message::FrameSize(client.recvBuf, client.features);
+            if (frame_size < proto::Message::HeaderSize() ||
+                frame_size > MAX_MSG_SIZE) {
+                WARN("Invalid frame size %llu", frame_size);
+                CancelIo(reinterpret_cast<HANDLE>(client.socket));
+                PostQueuedCompletionStatus(m_ioPort, 0, key,
+                                           &client.cancelOverlap);
+                return;
+            }
+        }
+        if (!proto::Message::ValidateBuff(client.recvBuf, client.recvBufSize,
+                                          client.features)) {
             INFO("Message invalid");
             ScheduleRead(key);
             return;
         }
-        ProcessMessage(client, proto::Message(client.id, client.recvBuf));
+        ProcessMessage(client, proto::Message(client.session, client.recvBuf,
+                                              client.features));
         INFO("ProcessMessage done");
         client.recvBufSize = 0;
     } else if (&client.sendOverlap == overlap) {
         INFO("Send overlap triggered");
+        // A long bulk response keeps the connection busy without reading.
+        client.last_activity = std::chrono::steady_clock::now();
         client.sentSize += transferred;
         if (client.sentSize < client.sendBufSize && transferred > 0) {
             INFO("Written %lu bytes. %llu more to be sent", transferred,
@@ -216,6 +267,14 @@ void Server::ProcessEvent(ULONG_PTR key, OVERLAPPED *overlap,
             return;
         }
         INFO("Written %lu bytes. That's it", transferred);
+        if (client.pending) {
+            SendNextFrame(client);
+            return;
+        }
+        if (client.bulk) {
+            PumpBulk(client);
+            return;
+        }
         ScheduleRead(client.id, true);
     } else if (&client.cancelOverlap == overlap) {
         INFO("Cancel overlap triggered");
@@ -223,6 +282,16 @@ void Server::ProcessEvent(ULONG_PTR key, OVERLAPPED *overlap,
             return;
         }
         closesocket(client.socket);
+        ReleasePending(client);
+        if (client.bulk) {
+            m_bulkPool->Release(client.bulk);
+        }
+        if (client.handshake) {
+            // Freed along with the session once the worker is done.
+            client.handshake->cancelled = true;
+        }
+        delete client.arena;
+        delete client.session;
         std::memset(&m_clients[key], 0, sizeof(m_clients[key]));
         client.socket = INVALID_SOCKET;
         LOG("Client %lu disconnected", key);
@@ -230,39 +299,176 @@ void Server::ProcessEvent(ULONG_PTR key, OVERLAPPED *overlap,
 }
 
 void Server::ProcessMessage(Client &client, const proto::Message &message) {
-    if (message.type() == proto::MESSAGE_KEY_REQUEST) {
-        INFO("Received key request");
-        DWORD size;
-        auto buf = proto::encryption::g_instance->ExportSymmetricKey(
-            client.id, &size, message.buf(), message.size());
-        proto::Message msg(proto::MESSAGE_KEY_RESPONSE, buf, size,
-                           proto::MESSAGE_ENCRYPTION_ASYMMETRIC);
-
-        client.sendBufSize = msg.size();
-        client.sentSize = 0;
-        std::memcpy(client.sendBuf, msg.buf(), msg.size());
-        INFO("Sent message with key of size %llu", msg.size());
-        utils::dump_memory(msg.buf(), msg.size());
-        ScheduleWrite(client);
-        INFO("Schedule write key done.");
-        ScheduleRead(client.id, true);
-        INFO("Schedule read next message done.");
+    if (message.type() == proto::MESSAGE_KEY_REQUEST ||
+        message.type() == proto::MESSAGE_RESUME_REQUEST) {
+        QueueHandshake(client);
         return;
     }
 
-    proto::Request req(message.buf());
+    if (!message.buf()) {
+        // Sequence numbers of an AEAD session cannot recover from a message
+        // that failed to decrypt, so the connection is dropped.
+        WARN("Malformed message");
+        ScheduleDisconnect(client.id);
+        return;
+    }
+    // Nothing of the previous request is alive at this point, this also
+    // covers requests that were dropped without a response.
+    client.arena->reset();
+    proto::Request req(message.buf(), message.order(),
+                       client.arena->resource());
     INFO("Received request %d", req.type);
+    if (req.malformed) {
+        WARN("Malformed request");
+        ScheduleDisconnect(client.id);
+        return;
+    }
+    if (req.bulk()) {
+        StartBulk(client, req);
+        return;
+    }
     if (!m_handlers.contains(req.type)) {
         WARN("Unknown request");
         return;
     }
-    proto::Response *resp = m_handlers[req.type](&req);
-    SendResponse(client, resp);
-    delete resp;
+    proto::Response *resp = m_handlers[req.type](&req, client.arena);
+    SendResponse(client, resp, req.layout);
+}
+
+void Server::QueueHandshake(Client &client) {
+    client.handshakeQueued = true;
+    m_handshakeBacklog.push_back(client.id);
+    StartHandshakes();
+}
+
+void Server::StartHandshakes() {
+    while (m_handshakesInFlight < m_handshakeLimit &&
+           !m_handshakeBacklog.empty()) {
+        Client &client = m_clients[m_handshakeBacklog.front()];
+        m_handshakeBacklog.pop_front();
+        // The slot may have been closed, and even reused, since it was
+        // queued.
+        if (!client.handshakeQueued) {
+            continue;
+        }
+        client.handshakeQueued = false;
+
+        // Handshake messages are never encrypted, so the request can be
+        // parsed again from recvBuf, which is left alone until it is
+        // answered.
+        auto hs = new Handshake();
+        hs->client = client.id;
+        hs->request = proto::Message(nullptr, client.recvBuf, client.features);
+        hs->session.reset(client.session);
+        client.session = nullptr;
+        client.handshake = hs;
+        m_handshakesInFlight++;
+        m_cryptoPool->Submit(hs);
+    }
+}
+
+void Server::FinishHandshake(Handshake *hs) {
+    m_handshakesInFlight--;
+    if (!hs->cancelled) {
+        Client &client = m_clients[hs->client];
+        client.handshake = nullptr;
+        client.session = hs->session.release();
+        client.features = hs->features;
+        if (hs->response.size() == 0) {
+            ScheduleDisconnect(client.id);
+        } else {
+            INFO("Sent message with key of size %llu", hs->response.size());
+            SendHandshake(client, hs->response);
+        }
+    }
+    delete hs;
+    StartHandshakes();
+}
+
+void Server::SendHandshake(Client &client, const proto::Message &msg) {
+    client.sendBufSize = msg.size();
+    client.sentSize = 0;
+    std::memcpy(client.sendBuf, msg.buf(), msg.size());
+    utils::dump_memory(msg.buf(), msg.size());
+    ScheduleWrite(client);
+    INFO("Schedule write handshake done.");
+    ScheduleRead(client.id, true);
+    INFO("Schedule read next message done.");
+}
+
+void Server::SendResponse(Client &client, proto::Response *resp,
+                          proto::ResponseLayout layout) {
+    client.pending = resp;
+    client.pendingCursor = 0;
+    client.pendingLayout = layout;
+    SendNextFrame(client);
+}
+
+void Server::StartBulk(Client &client, const proto::Request &req) {
+    INFO("Bulk request over %llu paths, depth %u", req.paths.size(),
+         req.depth);
+    client.pendingLayout = req.layout;
+    client.bulk = m_bulkPool->Submit(req, [this, id = client.id] {
+        PostQueuedCompletionStatus(m_ioPort, id, BULK_KEY, nullptr);
+    });
+}
+
+void Server::PumpBulk(Client &client) {
+    // The slot may have been closed, or a frame is still being written and
+    // its completion pumps again.
+    if (!client.bulk || client.pending ||
+        client.sentSize < client.sendBufSize) {
+        return;
+    }
+    bool done;
+    proto::Response *resp =
+        m_bulkPool->Take(client.bulk, client.arena, &done);
+    if (!resp) {
+        return;
+    }
+    if (done) {
+        m_bulkPool->Release(client.bulk);
+        client.bulk = nullptr;
+    }
+    SendResponse(client, resp, client.pendingLayout);
 }
 
-void Server::SendResponse(Client &client, proto::Response *resp) {
-    proto::Message msg(resp, proto::MESSAGE_ENCRYPTION_SYMMETRIC, client.id);
+void Server::SendNextFrame(Client &client) {
+    auto encryption = proto::NegotiatedEncryption(client.features);
+    proto::Message msg(client.pending, encryption, client.session,
+                       client.features, MAX_SEND_SIZE, &client.pendingCursor,
+                       client.pendingLayout);
+    if (msg.size() > sizeof(client.sendBuf)) {
+        WARN("Response entry does not fit a frame (%llu bytes)", msg.size());
+        if (client.pendingCursor < client.pending->entryCount()) {
+            // Only this entry is lost, the response goes on.
+            SendNextFrame(client);
+            return;
+        }
+        if (client.pending->more) {
+            // So does a bulk stream with slices still to come.
+            ReleasePending(client);
+            PumpBulk(client);
+            return;
+        }
+        // The lost entry was the last one. The client still waits for a
+        // frame without MESSAGE_FLAG_CONTINUED, packing from the end gives
+        // one without entries.
+        msg = proto::Message(client.pending, encryption, client.session,
+                             client.features, MAX_SEND_SIZE,
+                             &client.pendingCursor, client.pendingLayout);
+        if (msg.size() > sizeof(client.sendBuf)) {
+            // A scalar response has nothing to leave out.
+            ReleasePending(client);
+            ScheduleDisconnect(client.id);
+            return;
+        }
+    }
+    // A slice of a bulk stream is done with once its entries are out, even
+    // though the frame is marked continued.
+    if (client.pendingCursor >= client.pending->entryCount()) {
+        ReleasePending(client);
+    }
     client.sendBufSize = msg.size();
     client.sentSize = 0;
     std::memcpy(client.sendBuf, msg.buf(), msg.size());
@@ -271,6 +477,16 @@ void Server::SendResponse(Client &client, proto::Response *resp) {
     ScheduleWrite(client);
 }
 
+void Server::ReleasePending(Client &client) {
+    if (client.pending) {
+        std::destroy_at(client.pending);
+        client.pending = nullptr;
+    }
+    if (client.arena) {
+        client.arena->reset();
+    }
+}
+
 void Server::ScheduleWrite(Client &client) {
     WSABUF buf{
         .len = static_cast<ULONG>(client.sendBufSize - client.sentSize),
@@ -8,19 +8,43 @@
 
 #include <unordered_map>
 #include <chrono>
+#include <deque>
+#include <memory>
 
 #include "../../common/alias.hpp"
+#include "../../common/proto/arena.hpp"
+#include "../../common/proto/encryption/encryption.hpp"
 #include "../../common/proto/message.hpp"
 #include "../../common/proto/request.hpp"
 #include "../../common/proto/response.hpp"
+#include "bulk_pool.hpp"
+#include "crypto_pool.hpp"
 
 #pragma comment(lib, "ws2_32.lib")
 #pragma comment(lib, "mswsock.lib")
 
 #define MAX_CLIENTS (100)
-#define MAX_BUF_SIZE 512
-
-typedef proto::Response *(*HandlerFunc)(proto::Request *);
+#define MAX_BUF_SIZE MAX_REQUEST_SIZE
+// Responses larger than this are streamed as several frames.
+#define MAX_SEND_SIZE 2048
+
+// Completion key of handshakes finished by the crypto workers, the ones
+// below are indices into the client table.
+#define HANDSHAKE_KEY (MAX_CLIENTS + 1)
+// Completion key of bulk jobs with results to send, the number of bytes
+// transferred is the index of the client.
+#define BULK_KEY (MAX_CLIENTS + 2)
+// Handshakes queued on the crypto workers per worker. More have to wait in
+// the backlog, so a reconnect storm cannot take every core from the
+// established connections.
+#define HANDSHAKES_PER_WORKER 2
+
+static_assert(MAX_SEND_SIZE <= MAX_MSG_SIZE,
+              "Frames must fit the client receive buffer");
+
+// Handlers construct the response in the arena of the connection, it is
+// destroyed and the arena reset once the last frame has been sealed.
+typedef proto::Response *(*HandlerFunc)(proto::Request *, proto::Arena *);
 
 namespace server::tcp {
 struct Client {
@@ -28,7 +52,9 @@ struct Client {
     u32 id = 0;
     SOCKET socket = INVALID_SOCKET;
     u8 recvBuf[MAX_BUF_SIZE] = {};
-    u8 sendBuf[MAX_BUF_SIZE] = {};
+    // Frames are packed to MAX_SEND_SIZE, a single entry that does not fit
+    // goes out alone in a larger one.
+    u8 sendBuf[MAX_MSG_SIZE] = {};
 
     usize recvBufSize = 0;
     usize sendBufSize = 0;
@@ -39,6 +65,31 @@ struct Client {
     OVERLAPPED cancelOverlap = {};
 
     DWORD recvFlags = 0;
+
+    u32 features = 0;
+
+    // Response being streamed and the first entry of its next frame.
+    proto::Response *pending = nullptr;
+    usize pendingCursor = 0;
+    proto::ResponseLayout pendingLayout = proto::LAYOUT_PACKED;
+
+    // Backs the request being served, see proto::Arena. Heap-allocated since
+    // the slot is cleared with memset on disconnect.
+    proto::Arena *arena = nullptr;
+
+    // Cipher state of the connection, created on accept and destroyed with
+    // the arena.
+    proto::encryption::Session *session = nullptr;
+
+    // Handshake being run by the crypto workers, it owns the session
+    // meanwhile. Nothing is read from the connection until it is answered.
+    Handshake *handshake = nullptr;
+    // Handshake request in recvBuf waiting in the backlog.
+    bool handshakeQueued = false;
+
+    // Bulk request being answered, its results go out as they come in and
+    // nothing is read from the connection until the last one has.
+    BulkJob *bulk = nullptr;
 };
 
 class Server {
@@ -62,6 +113,12 @@ private:
 
     WSADATA m_wsaData = {};
 
+    std::unique_ptr<CryptoPool> m_cryptoPool;
+    std::unique_ptr<BulkPool> m_bulkPool;
+    std::deque<u32> m_handshakeBacklog;
+    u32 m_handshakesInFlight = 0;
+    u32 m_handshakeLimit = 0;
+
     void ScheduleAccept();
 
     void ScheduleRead(u32 key, bool reset = false);
@@ -72,7 +129,25 @@ private:
 
     void ProcessMessage(Client &client, const proto::Message &message);
 
-    void SendResponse(Client &client, proto::Response *resp);
+    // Key and resume requests go to the backlog and from there to the
+    // crypto workers, at most m_handshakeLimit at a time.
+    void QueueHandshake(Client &client);
+    void StartHandshakes();
+    void FinishHandshake(Handshake *hs);
+
+    // Sends a key or resume response and waits for the next message.
+    void SendHandshake(Client &client, const proto::Message &msg);
+
+    void SendResponse(Client &client, proto::Response *resp,
+                      proto::ResponseLayout layout);
+
+    void StartBulk(Client &client, const proto::Request &req);
+    // Sends the results of the bulk job of client collected so far, unless
+    // a frame is still on its way.
+    void PumpBulk(Client &client);
+
+    void SendNextFrame(Client &client);
+    void ReleasePending(Client &client);
 
     void ScheduleWrite(Client &client);
 
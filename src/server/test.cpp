@@ -5,11 +5,12 @@
 #include <locale>
 #include <codecvt>
 
-#include "os_utils.hpp"
+#include "os_utils/os_utils.hpp"
 #include "../common/utils.hpp"
 
 namespace test {
     void PrintTestOutput(char **argv) {
+        os_utils::init();
         int len = MultiByteToWideChar(CP_UTF8, 0, argv[0], -1, nullptr, 0);
         std::wstring programPath(len, L'\0');
         MultiByteToWideChar(CP_UTF8, 0, argv[0], -1, &programPath[0], len);
@@ -27,7 +28,7 @@ namespace test {
         std::cout << "Free memory: " << utils::format_bytes(mem.free_bytes) << std::endl;
         auto drives = os_utils::get_drives();
         std::cout << "Mounted drives:\n";
-        for (const auto &[type, name, free_bytes]: drives) {
+        for (const auto &[type, name, free_bytes, stale]: drives) {
             std::cout << "\t" << name << " [" << DriveTypeName[type] << "] Free space: "
                       << utils::format_bytes(free_bytes)
                       << std::endl;